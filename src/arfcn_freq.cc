@@ -82,7 +82,7 @@ int str_to_bi(char *s) {
 	if(!strcmp(s, "GSM850") || !strcmp(s, "GSM-850") || !strcmp(s, "850"))
 		return GSM_850;
 
-	if(!strcmp(s, "GSM-R") || !strcmp(s, "R-GSM"))
+	if(!strcmp(s, "GSM-R") || !strcmp(s, "R-GSM") || !strcmp(s, "GSM-R-900"))
 		return GSM_R_900;
 
 	if(!strcmp(s, "GSM900") || !strcmp(s, "GSM-900") || !strcmp(s, "900"))
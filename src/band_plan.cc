@@ -0,0 +1,78 @@
+/**
+ * @file band_plan.cc
+ * @brief Implementation of the per band channel tables.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <algorithm>
+#include <mutex>
+
+#include "arfcn_freq.h"
+#include "wideband_scan.h"
+#include "band_plan.h"
+
+static std::mutex s_mutex;
+static band_plan s_plans[PCS_1900 + 1];
+static bool s_built[PCS_1900 + 1];
+
+static bool by_freq(const band_chan &a, const band_chan &b)
+{
+	return a.freq < b.freq;
+}
+
+static void build(band_plan *p, int bi)
+{
+	band_chan c;
+	int max_arfcn = 0;
+
+	p->bi = bi;
+	for (int n = first_chan(bi); n >= 0; n = next_chan(n, bi)) {
+		int b = bi;
+
+		c.arfcn = n;
+		c.freq = arfcn_to_freq(n, &b);
+		c.block = 0;
+		p->chans.push_back(c);
+		max_arfcn = std::max(max_arfcn, n);
+	}
+	std::sort(p->chans.begin(), p->chans.end(), by_freq);
+
+	p->arfcn_index.assign(max_arfcn + 1, -1);
+	for (size_t i = 0; i < p->chans.size(); i++)
+		p->arfcn_index[p->chans[i].arfcn] = (int)i;
+
+	// Tolerance: channel frequencies are rounded to 1 Hz
+	for (size_t i = 0; i < p->chans.size(); ) {
+		band_block b;
+
+		b.tune_freq = p->chans[i].freq + WB_SPAN_HZ;
+		b.first = (unsigned int)i;
+		b.count = 0;
+		for (; i < p->chans.size() && p->chans[i].freq - b.tune_freq <= WB_SPAN_HZ + 1.0; i++) {
+			p->chans[i].block = (unsigned int)p->blocks.size();
+			b.count++;
+		}
+		p->blocks.push_back(b);
+	}
+}
+
+const band_plan *get_band_plan(int bi)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (bi <= BI_NOT_DEFINED || bi > PCS_1900)
+		return NULL;
+	if (!s_built[bi]) {
+		build(&s_plans[bi], bi);
+		s_built[bi] = true;
+	}
+	return &s_plans[bi];
+}
@@ -0,0 +1,67 @@
+/**
+ * @file band_plan.h
+ * @brief Precomputed channel tables of the GSM bands.
+ *
+ * A band scan used to walk the band with first_chan()/next_chan() and
+ * call arfcn_to_freq() for every channel at every step. The plan of a
+ * band is built once per process instead: its channels in frequency
+ * order (E-GSM-900 starts at ARFCN 975, below ARFCN 0) with their
+ * downlink frequency, and the grid of wideband captures covering them.
+ *
+ * A tuning block starts at the lowest channel not yet covered and holds
+ * every channel within 2 * WB_SPAN_HZ of it: one capture tuned WB_SPAN_HZ
+ * above that channel measures them all (ten channels at 200 kHz spacing).
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __BAND_PLAN_H__
+#define __BAND_PLAN_H__
+
+#include <vector>
+
+/** @brief One channel of a band_plan. */
+struct band_chan {
+	int arfcn;
+	double freq;          /**< Downlink frequency (Hz) */
+	unsigned int block;   /**< Index of its tuning block in band_plan::blocks */
+};
+
+/** @brief Channels sharing one wideband capture. */
+struct band_block {
+	double tune_freq;     /**< Capture center frequency (Hz) */
+	unsigned int first;   /**< First channel (index in band_plan::chans) */
+	unsigned int count;   /**< Channels in the block */
+};
+
+/** @brief Channel table and tuning grid of one band. */
+struct band_plan {
+	int bi;                          /**< Band indicator */
+	std::vector<band_chan> chans;    /**< Frequency order */
+	std::vector<band_block> blocks;  /**< Frequency order */
+	std::vector<int> arfcn_index;    /**< ARFCN to index in chans, -1 if not in the band */
+
+	/** @brief Index of an ARFCN in chans, -1 if not in the band. */
+	int index(int arfcn) const {
+		return (arfcn >= 0 && arfcn < (int)arfcn_index.size()) ? arfcn_index[arfcn] : -1;
+	}
+};
+
+/**
+ * @brief Returns the plan of a band, built on first use.
+ *
+ * Plans are never freed and safe to share between threads.
+ *
+ * @param bi Band indicator.
+ * @return Plan, or NULL for an undefined band.
+ */
+const band_plan *get_band_plan(int bi);
+
+#endif /* __BAND_PLAN_H__ */
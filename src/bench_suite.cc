@@ -0,0 +1,905 @@
+/**
+ * @file bench_suite.cc
+ * @brief Implementation of the named benchmark scenarios.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "bench_suite.h"
+#include "kal_types.h"
+#include "kal_globals.h"
+#include "util.h"
+#include "dsp_resampler.h"
+#include "dsp_simd.h"
+#include "fcch_detector.h"
+#include "spsc_buffer.h"
+#include "sample_source.h"
+#include "replay_source.h"
+#include "iq_file.h"
+#include "arfcn_freq.h"
+#include "offset.h"
+#include "c0_detect.h"
+#include "kal_state.h"
+
+/** @brief Resampler input per timed call (one USB transfer). */
+#define BENCH_TRANSFER 65536
+
+/** @brief Synthetic recording length for the replay scenarios (s). */
+#define BENCH_IQ_SECONDS 2.0
+
+/** @brief Center of the synthetic recording (E-GSM ARFCN 60). */
+#define BENCH_IQ_CENTER 947.0e6
+
+/** @brief Clock error of the synthetic recording (ppm). */
+#define BENCH_IQ_PPM -0.05
+
+typedef std::chrono::high_resolution_clock bench_clock;
+
+static double elapsed_us(bench_clock::time_point t0, bench_clock::time_point t1)
+{
+	return std::chrono::duration<double, std::micro>(t1 - t0).count();
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Results
+ * ---------------------------------------------------------------------------
+ */
+
+/** @brief One timed case: a time per iteration plus named figures. */
+struct bench_case {
+	std::string scenario;
+	std::string name;
+	std::vector<double> us;
+	std::vector<std::pair<std::string, double> > metrics;
+
+	void metric(const char *key, double value) {
+		metrics.push_back(std::make_pair(std::string(key), value));
+	}
+};
+
+struct bench_summary {
+	double min, mean, p50, p90, p99, max;
+};
+
+/* Linear interpolation between the closest ranks of a sorted set */
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	const double pos = p / 100.0 * (sorted.size() - 1);
+	const size_t i = (size_t)pos;
+	const double f = pos - i;
+
+	if (i + 1 >= sorted.size())
+		return sorted.back();
+	return sorted[i] + f * (sorted[i + 1] - sorted[i]);
+}
+
+static bench_summary summarize(const std::vector<double> &us)
+{
+	std::vector<double> s(us);
+	bench_summary r;
+	double sum = 0.0;
+
+	memset(&r, 0, sizeof(r));
+	if (s.empty())
+		return r;
+
+	std::sort(s.begin(), s.end());
+	for (size_t i = 0; i < s.size(); i++)
+		sum += s[i];
+
+	r.min = s.front();
+	r.max = s.back();
+	r.mean = sum / s.size();
+	r.p50 = percentile(s, 50.0);
+	r.p90 = percentile(s, 90.0);
+	r.p99 = percentile(s, 99.0);
+	return r;
+}
+
+struct bench_ctx {
+	const char *iq_path;       // -r recording, or NULL
+	std::string synth_path;    // Synthetic recording, once written
+	double truth_ppm;          // Clock error of the recording, NAN if unknown
+	std::vector<bench_case> results;
+};
+
+/* Prints the case and keeps it for the JSON report */
+static void report(bench_ctx *ctx, bench_case &c)
+{
+	bench_summary s = summarize(c.us);
+
+	printf("  %-26s %6zu  %10.1f %10.1f %10.1f %10.1f", c.name.c_str(), c.us.size(),
+	       s.p50, s.p90, s.p99, s.max);
+	for (size_t i = 0; i < c.metrics.size(); i++)
+		printf("  %s %.4g", c.metrics[i].first.c_str(), c.metrics[i].second);
+	printf("\n");
+
+	ctx->results.push_back(c);
+}
+
+static void print_header(const char *title)
+{
+	printf("--------------------------------------------------------\n");
+	printf("%s\n", title);
+	printf("  %-26s %6s  %10s %10s %10s %10s\n", "case", "iters", "p50 us", "p90 us", "p99 us", "max us");
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Synthetic GSM signal
+ * ---------------------------------------------------------------------------
+ */
+
+struct synth_station {
+	double offset;  // From the center of the capture (Hz)
+	double err;     // Clock error seen on this carrier (Hz)
+	float amp;
+};
+
+/* Uniform in [0, 1) from a 32-bit LCG */
+static inline double lcg_uniform(uint32_t *s)
+{
+	*s = *s * 1664525u + 1013904223u;
+	return (*s >> 8) / 16777216.0;
+}
+
+/*
+ * Crude GSM downlink at sample rate fs: each carrier is MSK at GSM_RATE
+ * (+-GSM_RATE/4 by random bit) with an FCCH, a constant +GSM_RATE/4
+ * tone, in timeslot 0 of frames 0, 10, 20, 30 and 40 of every
+ * 51-multiframe. Adds complex Gaussian noise of variance noise_var.
+ */
+static void synth_gsm(complex *out, size_t n, double fs, const synth_station *st,
+		      unsigned int st_count, double noise_var, uint32_t seed)
+{
+	const double sigma = sqrt(noise_var / 2.0);
+	std::vector<double> phase(st_count, 0.0);
+	std::vector<uint32_t> bits(st_count);
+	uint32_t rng = seed;
+
+	for (unsigned int k = 0; k < st_count; k++)
+		bits[k] = seed * 2654435761u + k;
+
+	for (size_t i = 0; i < n; i++) {
+		// Box-Muller, one complex sample per pair
+		double u1 = lcg_uniform(&rng), u2 = lcg_uniform(&rng);
+		double r = sigma * sqrt(-2.0 * log(1.0 - u1));
+		std::complex<double> x(r * cos(2.0 * M_PI * u2), r * sin(2.0 * M_PI * u2));
+
+		const double sym = i * GSM_RATE / fs;
+		const uint64_t si = (uint64_t)sym;
+		const uint64_t frame = si / 1250;
+		const unsigned int fn = (unsigned int)(frame % 51);
+		const bool fcch = (fn % 10 == 0 && fn != 50) && (si % 1250) < 148;
+
+		for (unsigned int k = 0; k < st_count; k++) {
+			double fi = GSM_RATE / 4;
+
+			if (!fcch) {
+				uint32_t h = (uint32_t)(si * 2654435761u) ^ bits[k];
+				h ^= h >> 15;
+				h *= 0x2c1b3c6du;
+				h ^= h >> 12;
+				fi = (h & 1) ? GSM_RATE / 4 : -GSM_RATE / 4;
+			}
+			phase[k] += 2.0 * M_PI * (fi + st[k].offset + st[k].err) / fs;
+			if (phase[k] > 1e4)
+				phase[k] = fmod(phase[k], 2.0 * M_PI);
+			x += std::polar((double)st[k].amp, phase[k]);
+		}
+		out[i] = complex((float)x.real(), (float)x.imag());
+	}
+}
+
+/* Directory for the files the replay scenarios write */
+static std::string tmp_dir()
+{
+	const char *tmp = getenv("TMPDIR");
+
+#ifdef _WIN32
+	if (!tmp)
+		tmp = getenv("TEMP");
+	if (!tmp)
+		tmp = ".";
+#else
+	if (!tmp)
+		tmp = "/tmp";
+#endif
+	return tmp;
+}
+
+/*
+ * Writes the synthetic 2.5 MSPS recording of the replay scenarios: three
+ * carriers around BENCH_IQ_CENTER sharing a BENCH_IQ_PPM clock error.
+ */
+static int write_synth_recording(bench_ctx *ctx)
+{
+	const double fs = SAMPLE_SOURCE_INPUT_RATE;
+	const size_t n = (size_t)(BENCH_IQ_SECONDS * fs);
+	const double e = BENCH_IQ_PPM * 1e-6;
+	synth_station st[3] = {
+		{ -800e3, (BENCH_IQ_CENTER - 800e3) * e, 0.03f },
+		{ -400e3, (BENCH_IQ_CENTER - 400e3) * e, 0.08f },
+		{ +600e3, (BENCH_IQ_CENTER + 600e3) * e, 0.02f },
+	};
+	std::vector<complex> buf(n);
+	iq_meta m;
+	FILE *f;
+
+	ctx->synth_path = tmp_dir() + "/kal_bench.cf32";
+
+	printf("Writing %.1f s synthetic recording to '%s'...\n", BENCH_IQ_SECONDS, ctx->synth_path.c_str());
+	synth_gsm(&buf[0], n, fs, st, 3, 1e-5, 1234);
+
+	f = fopen(ctx->synth_path.c_str(), "wb");
+	if (!f) {
+		fprintf(stderr, "error: cannot create '%s'\n", ctx->synth_path.c_str());
+		ctx->synth_path.clear();
+		return -1;
+	}
+	if (fwrite(&buf[0], sizeof(complex), n, f) != n) {
+		fprintf(stderr, "error: write to '%s' failed\n", ctx->synth_path.c_str());
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	memset(&m, 0, sizeof(m));
+	m.format = IQ_FORMAT_CF32;
+	m.sample_rate = fs;
+	m.center_freq = BENCH_IQ_CENTER;
+	m.samples = n;
+	ctx->truth_ppm = BENCH_IQ_PPM;
+
+	return iq_meta_write(ctx->synth_path.c_str(), &m);
+}
+
+/* Opens the recording of the replay scenarios, writing it if needed */
+static replay_source *open_recording(bench_ctx *ctx, unsigned int sps = 1)
+{
+	replay_source *rs;
+
+	if (!ctx->iq_path && ctx->synth_path.empty() && write_synth_recording(ctx))
+		return NULL;
+
+	rs = new replay_source(ctx->iq_path ? ctx->iq_path : ctx->synth_path.c_str(), 0.0f);
+	rs->set_oversampling(sps);
+	if (rs->open()) {
+		delete rs;
+		return NULL;
+	}
+	return rs;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Scenarios
+ * ---------------------------------------------------------------------------
+ */
+
+/* Resampler: per engine and input format, one time per USB transfer */
+static int bench_resampler(bench_ctx *ctx)
+{
+	const double fs = SAMPLE_SOURCE_INPUT_RATE;
+	const size_t n = (size_t)fs;
+	const int PASSES = 3;
+	synth_station st[2] = { { -300e3, 0.0, 0.3f }, { 50e3, 0.0, 0.5f } };
+	std::vector<complex> in(n), out(BENCH_TRANSFER);
+	std::vector<int16_t> in16(2 * n);
+
+	print_header("Resampler (2.5 MSPS -> 270.833 kSPS, per 65536-sample transfer)");
+	synth_gsm(&in[0], n, fs, st, 2, 1e-3, 1);
+	for (size_t i = 0; i < n; i++) {
+		in16[2 * i] = (int16_t)lrintf(in[i].real() * 32767.0f * 0.9f);
+		in16[2 * i + 1] = (int16_t)lrintf(in[i].imag() * 32767.0f * 0.9f);
+	}
+
+	for (int e = DSP_ENGINE_TWO_STAGE; e < DSP_ENGINE_COUNT; e++) {
+		for (int fmt = 0; fmt < 2; fmt++) {
+			dsp_resampler rs;
+			bench_case c;
+			double total = 0.0;
+
+			rs.set_engine((dsp_engine_id)e);
+			c.scenario = "resampler";
+			c.name = std::string(dsp_engine_name((dsp_engine_id)e)) + (fmt ? "/int16" : "/float32");
+
+			for (int p = 0; p < PASSES; p++) {
+				for (size_t off = 0; off + BENCH_TRANSFER <= n; off += BENCH_TRANSFER) {
+					bench_clock::time_point t0 = bench_clock::now();
+					if (fmt)
+						rs.process_int16(&in16[2 * off], BENCH_TRANSFER, &out[0], out.size());
+					else
+						rs.process(&in[off], BENCH_TRANSFER, &out[0], out.size());
+					double us = elapsed_us(t0, bench_clock::now());
+					c.us.push_back(us);
+					total += us;
+				}
+			}
+
+			const double samples = (double)c.us.size() * BENCH_TRANSFER;
+			c.metric("msps", samples / total);
+			c.metric("realtime", samples / fs / (total * 1e-6));
+			c.metric("macs_per_output", rs.macs_per_output());
+			report(ctx, c);
+		}
+	}
+	return 0;
+}
+
+/* fcch_detector::scan() per 12-frame window, across SNR, offset and oversampling */
+static int bench_fcch(bench_ctx *ctx)
+{
+	const unsigned int WINDOWS = 100;
+	const double snrs[] = { 0.0, 5.0, 10.0, 20.0 };
+	const double offsets[] = { -20e3, 0.0, 25e3 };
+	const unsigned int spss[] = { 1, 2, 4 };
+
+	print_header("FCCH scan (12-frame windows at 270.833 kSPS x sps, one burst or more each)");
+
+	/* Detector setup cost: the c0 and offset flows create one per job */
+	{
+		const unsigned int RUNS = 200;
+		bench_case c;
+
+		c.scenario = "fcch";
+		c.name = "construct + destroy";
+		for (unsigned int r = 0; r < RUNS; r++) {
+			bench_clock::time_point t0 = bench_clock::now();
+			fcch_detector *det = new fcch_detector((float)GSM_RATE);
+			delete det;
+			c.us.push_back(elapsed_us(t0, bench_clock::now()));
+		}
+		report(ctx, c);
+	}
+
+	for (size_t p = 0; p < sizeof(spss) / sizeof(spss[0]); p++) {
+		const unsigned int sps = spss[p];
+		const double fs = GSM_RATE * sps;
+		const unsigned int FRAME_LEN = (unsigned int)ceil((12 * 8 * 156.25 + 156.25) * sps);
+		std::vector<complex> buf((size_t)FRAME_LEN * WINDOWS);
+
+		for (size_t s = 0; s < sizeof(snrs) / sizeof(snrs[0]); s++) {
+			for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+				/* Oversampled: one offset is enough to compare against 1 sps */
+				if (sps > 1 && offsets[o] != 25e3)
+					continue;
+
+				synth_station st = { 0.0, offsets[o], 1.0f };
+				fcch_detector det((float)fs);
+				unsigned int found = 0, bad = 0, pre_pass = 0, pre_miss = 0;
+				double sum_err = 0.0;
+				char name[64];
+				bench_case c;
+
+				synth_gsm(&buf[0], buf.size(), fs, &st, 1, pow(10.0, -snrs[s] / 10.0),
+					  (uint32_t)(s * 16 + o + 7));
+
+				if (sps > 1)
+					snprintf(name, sizeof(name), "%u sps, snr %+.0f dB, %+.0f kHz", sps,
+						 snrs[s], offsets[o] / 1e3);
+				else
+					snprintf(name, sizeof(name), "snr %+.0f dB, %+.0f kHz", snrs[s],
+						 offsets[o] / 1e3);
+				c.scenario = "fcch";
+				c.name = name;
+
+				for (unsigned int w = 0; w < WINDOWS; w++) {
+					float offset = 0.0f;
+					bench_clock::time_point t0 = bench_clock::now();
+					unsigned int r = det.scan(&buf[(size_t)w * FRAME_LEN], FRAME_LEN,
+								  &offset, NULL);
+					c.us.push_back(elapsed_us(t0, bench_clock::now()));
+
+					// Pre-detector false negatives: bursts scan() finds that it drops
+					bool pre = det.prescreen(&buf[(size_t)w * FRAME_LEN], FRAME_LEN);
+					pre_pass += pre;
+					if (!r)
+						continue;
+					pre_miss += !pre;
+					found++;
+					// The tone itself, as offset_detect() sees it
+					double err = fabs(offset - GSM_RATE / 4 - offsets[o]);
+					if (err > 500.0)
+						bad++;
+					else
+						sum_err += err;
+				}
+
+				c.metric("detect", (double)found / WINDOWS);
+				c.metric("false", found ? (double)bad / found : 0.0);
+				c.metric("mean_err_hz", found > bad ? sum_err / (found - bad) : 0.0);
+				c.metric("pre_pass", (double)pre_pass / WINDOWS);
+				c.metric("pre_miss", found ? (double)pre_miss / found : 0.0);
+				c.metric("workspace_kb", fcch_detector::workspace_bytes() / 1024.0);
+				report(ctx, c);
+			}
+		}
+	}
+
+	/* Bursts per window: first hit of scan() vs every burst of scan_all() */
+	for (size_t s = 2; s < sizeof(snrs) / sizeof(snrs[0]); s++) {
+		const unsigned int FRAME_LEN = (unsigned int)ceil(12 * 8 * 156.25 + 156.25);
+		std::vector<complex> buf((size_t)FRAME_LEN * WINDOWS);
+		synth_station st = { 0.0, 0.0, 1.0f };
+
+		synth_gsm(&buf[0], buf.size(), GSM_RATE, &st, 1, pow(10.0, -snrs[s] / 10.0),
+			  (uint32_t)(s * 16 + 41));
+		for (int all = 0; all < 2; all++) {
+			fcch_detector det((float)GSM_RATE);
+			fcch_burst bursts[4];
+			unsigned int found = 0, bad = 0;
+			double sum_err = 0.0;
+			char name[64];
+			bench_case c;
+
+			snprintf(name, sizeof(name), "snr %+.0f dB, %s", snrs[s], all ? "scan_all()" : "scan()");
+			c.scenario = "fcch";
+			c.name = name;
+			for (unsigned int w = 0; w < WINDOWS; w++) {
+				const complex *b = &buf[(size_t)w * FRAME_LEN];
+				unsigned int n;
+				bench_clock::time_point t0 = bench_clock::now();
+				if (all) {
+					n = det.scan_all(b, FRAME_LEN, bursts, 4, NULL);
+				} else {
+					n = det.scan(b, FRAME_LEN, &bursts[0].offset, NULL);
+				}
+				c.us.push_back(elapsed_us(t0, bench_clock::now()));
+
+				for (unsigned int i = 0; i < n; i++) {
+					double err = fabs(bursts[i].offset - GSM_RATE / 4);
+					found++;
+					if (err > 500.0)
+						bad++;
+					else
+						sum_err += err;
+				}
+			}
+			c.metric("bursts", (double)found / WINDOWS);
+			c.metric("false", found ? (double)bad / found : 0.0);
+			c.metric("mean_err_hz", found > bad ? sum_err / (found - bad) : 0.0);
+			report(ctx, c);
+		}
+	}
+
+	/* Empty channel, as most c0_detect() candidates: NLMS passes vs prescreen() first */
+	{
+		const unsigned int FRAME_LEN = (unsigned int)ceil(12 * 8 * 156.25 + 156.25);
+		std::vector<complex> buf((size_t)FRAME_LEN * WINDOWS);
+		synth_station st = { 0.0, 0.0, 0.0f };
+
+		synth_gsm(&buf[0], buf.size(), GSM_RATE, &st, 1, 1.0, 99);
+		for (int pre = 0; pre < 2; pre++) {
+			fcch_detector det((float)GSM_RATE);
+			unsigned int found = 0, passed = 0;
+			bench_case c;
+
+			c.scenario = "fcch";
+			c.name = pre ? "noise only, prescreen" : "noise only, train + scan";
+			for (unsigned int w = 0; w < WINDOWS; w++) {
+				const complex *b = &buf[(size_t)w * FRAME_LEN];
+				bench_clock::time_point t0 = bench_clock::now();
+				if (!pre || det.prescreen(b, FRAME_LEN)) {
+					passed++;
+					det.reset();
+					det.train(b, FRAME_LEN);
+					found += det.scan(b, FRAME_LEN, NULL, NULL);
+				}
+				c.us.push_back(elapsed_us(t0, bench_clock::now()));
+			}
+			c.metric("detect", (double)found / WINDOWS);
+			c.metric("pre_pass", (double)passed / WINDOWS);
+			report(ctx, c);
+		}
+	}
+	return 0;
+}
+
+/*
+ * spsc_buffer handoff: the producer publishes resampled transfer sized
+ * blocks, the consumer reads frames as fill() does. Latency is taken
+ * from just before a block is written to when the consumer has read it.
+ */
+static int ring_case(bench_ctx *ctx, const char *name, unsigned int blocks, double pace_us)
+{
+	const unsigned int BLOCK = 7100;   // 65536-sample transfer after resampling
+	const unsigned int READ = 4096;
+	spsc_buffer *cb;
+	std::vector<complex> src(BLOCK), dst(READ);
+	std::vector<bench_clock::time_point> t_pub(blocks);
+	std::atomic<unsigned int> stalls(0);
+	bench_case c;
+
+	try {
+		cb = new spsc_buffer(SAMPLE_SOURCE_RING_SAMPLES, sizeof(complex));
+	} catch (const std::exception &e) {
+		fprintf(stderr, "error: bench ring: %s\n", e.what());
+		return -1;
+	}
+	for (unsigned int i = 0; i < BLOCK; i++)
+		src[i] = complex((float)i, 0.0f);
+
+	c.scenario = "ring";
+	c.name = name;
+	c.us.reserve(blocks);
+
+	bench_clock::time_point start = bench_clock::now();
+	std::thread producer([&] {
+		for (unsigned int b = 0; b < blocks; b++) {
+			if (pace_us > 0.0)
+				std::this_thread::sleep_until(start + std::chrono::microseconds((long long)(b * pace_us)));
+			while (cb->space_available() < BLOCK) {
+				stalls++;
+				std::this_thread::yield();
+			}
+			// Published by the write below
+			t_pub[b] = bench_clock::now();
+			cb->write(&src[0], BLOCK);
+		}
+		cb->notify();
+	});
+
+	const uint64_t total = (uint64_t)blocks * BLOCK;
+	uint64_t got = 0;
+	unsigned int next = 0;
+	while (got < total) {
+		unsigned int want = (unsigned int)(std::min)((uint64_t)READ, total - got);
+		if (!cb->wait(want, 100))
+			continue;
+		got += cb->read(&dst[0], want);
+
+		bench_clock::time_point now = bench_clock::now();
+		while (next < blocks && got >= (uint64_t)(next + 1) * BLOCK)
+			c.us.push_back(elapsed_us(t_pub[next++], now));
+	}
+	double total_us = elapsed_us(start, bench_clock::now());
+	producer.join();
+	delete cb;
+
+	c.metric("msps", total / total_us);
+	c.metric("stalls", stalls.load());
+	report(ctx, c);
+	return 0;
+}
+
+static int bench_ring(bench_ctx *ctx)
+{
+	print_header("Ring handoff (spsc_buffer, 7100-sample blocks, latency per block)");
+
+	if (ring_case(ctx, "flat out", 20000, 0.0))
+		return -1;
+	// 20x the real-time block rate: the consumer sleeps in wait() between blocks
+	return ring_case(ctx, "paced 20x realtime", 400, 7100 / GSM_RATE * 1e6 / 20.0);
+}
+
+/* offset_detect() flow (100 bursts) over the recording */
+static int bench_offset(bench_ctx *ctx)
+{
+	const int RUNS = 5;
+	/*
+	 * Fixed count per sps, then -E at 1 sps, then a target the 1 sps
+	 * run needs more than the minimum for, per sps: bursts to get there
+	 */
+	static const struct {
+		unsigned int sps;
+		offset_precision prec;
+	} cases[] = {
+		{ 1, { 0.0, OFFSET_MIN_BURSTS, false } },
+		{ 2, { 0.0, OFFSET_MIN_BURSTS, false } },
+		{ 4, { 0.0, OFFSET_MIN_BURSTS, false } },
+		{ 1, { 1.0, OFFSET_MIN_BURSTS, false } },
+		{ 1, { 1.0, OFFSET_MIN_BURSTS, true } },
+		{ 1, { 0.2, OFFSET_MIN_BURSTS, false } },
+		{ 2, { 0.2, OFFSET_MIN_BURSTS, false } },
+		{ 4, { 0.2, OFFSET_MIN_BURSTS, false } },
+	};
+	const offset_precision user_prec = offset_get_precision();
+
+	print_header("Offset measurement over a replayed recording (100 bursts per run, per sps, or to a standard error)");
+
+	for (size_t p = 0; p < sizeof(cases) / sizeof(cases[0]) && !g_kal_exit_req; p++) {
+		const unsigned int sps = cases[p].sps;
+		const offset_precision &prec = cases[p].prec;
+		replay_source *rs = open_recording(ctx, sps);
+		double freq, sum_ppm = 0.0, sum_bursts = 0.0, sum_windows = 0.0;
+		unsigned int ok = 0;
+		char name[256];
+		bench_case c;
+
+		if (!rs)
+			return -1;
+		// A recording already at the GSM rate has one oversampling only
+		if (rs->oversampling() != sps) {
+			delete rs;
+			continue;
+		}
+
+		freq = rs->file().meta().center_freq;
+		if (!ctx->iq_path)
+			freq -= 400e3;   // The strongest synthetic carrier, off DC
+
+		snprintf(name, sizeof(name), "%s", ctx->iq_path ? ctx->iq_path : "synthetic");
+		if (sps > 1)
+			snprintf(name + strlen(name), sizeof(name) - strlen(name), ", %u sps", sps);
+		if (prec.ppb > 0.0)
+			snprintf(name + strlen(name), sizeof(name) - strlen(name), ", -E %g%s", prec.ppb,
+				 prec.pm_weight ? ",pm" : "");
+		c.scenario = "offset";
+		c.name = name;
+		offset_set_precision(&prec);
+
+		for (int r = 0; r < RUNS && !g_kal_exit_req; r++) {
+			offset_result res;
+
+			if (rs->tune(freq))
+				break;
+			bench_clock::time_point t0 = bench_clock::now();
+			int e = offset_measure(rs, 0, 0.0f, true, &res);
+			c.us.push_back(elapsed_us(t0, bench_clock::now()));
+
+			if (e || !res.bursts)
+				continue;
+			ok++;
+			sum_ppm += res.ppm;
+			sum_bursts += res.bursts;
+			sum_windows += res.iterations;
+		}
+		delete rs;
+		offset_set_precision(&user_prec);
+
+		c.metric("found", (double)ok / RUNS);
+		if (ok) {
+			c.metric("ppb", sum_ppm / ok * 1000.0);
+			if (!std::isnan(ctx->truth_ppm))
+				c.metric("err_ppb", (sum_ppm / ok - ctx->truth_ppm) * 1000.0);
+			c.metric("bursts", sum_bursts / ok);
+			c.metric("windows", sum_windows / ok);
+		}
+		report(ctx, c);
+	}
+	return 0;
+}
+
+/* c0_detect() flow over the recording, per scan mode */
+static int bench_scan(bench_ctx *ctx)
+{
+	const int RUNS = 2;
+	replay_source *rs = open_recording(ctx);
+	int bi = BI_NOT_DEFINED;
+
+	if (!rs)
+		return -1;
+	if (freq_to_arfcn(rs->file().meta().center_freq, &bi) < 0 || bi == BI_NOT_DEFINED) {
+		printf("Band scan: recording is not on a GSM channel, skipped\n");
+		delete rs;
+		return 0;
+	}
+
+	/* Cold runs start without a state file, warm ones visit what they found first */
+	const std::string user_state = kal_state_path();
+	const std::string state = tmp_dir() + "/kal_bench.state";
+	kal_state_set_path(state.c_str());
+
+	printf("--------------------------------------------------------\n");
+	printf("Band scan over a replayed recording (%s, results below each run)\n", bi_to_str(bi));
+	std::vector<bench_case> cases;
+	int r = 0;
+	for (int m = C0_SCAN_NARROW; m < C0_SCAN_COUNT && !g_kal_exit_req && !r; m++) {
+		for (int warm = 0; warm < 2 && !r; warm++) {
+			bench_case c;
+			char name[64];
+
+			snprintf(name, sizeof(name), "%s, %s", c0_scan_mode_name((c0_scan_mode)m),
+				 warm ? "warm" : "cold");
+			c.scenario = "scan";
+			c.name = name;
+			for (int i = 0; i < RUNS && !g_kal_exit_req; i++) {
+				if (!warm)
+					remove(state.c_str());
+				bench_clock::time_point t0 = bench_clock::now();
+				if ((r = c0_detect(rs, bi, 1, (c0_scan_mode)m)))
+					break;
+				c.us.push_back(elapsed_us(t0, bench_clock::now()));
+			}
+			cases.push_back(c);
+		}
+	}
+	delete rs;
+	remove(state.c_str());
+	kal_state_set_path(user_state.c_str());
+	if (r)
+		return -1;
+
+	printf("  %-26s %6s  %10s %10s %10s %10s\n", "case", "iters", "p50 us", "p90 us", "p99 us", "max us");
+	for (size_t i = 0; i < cases.size(); i++)
+		report(ctx, cases[i]);
+	return 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Driver
+ * ---------------------------------------------------------------------------
+ */
+
+struct bench_scenario {
+	const char *name;
+	const char *desc;
+	int (*run)(bench_ctx *ctx);
+};
+
+static const bench_scenario scenarios[] = {
+	{ "resampler", "resampler per engine and input format, per USB transfer", bench_resampler },
+	{ "fcch",      "FCCH scan() latency, detection and error across SNR and offset", bench_fcch },
+	{ "ring",      "spsc_buffer producer/consumer handoff latency and throughput", bench_ring },
+	{ "offset",    "offset measurement flow over a replayed recording", bench_offset },
+	{ "scan",      "band scan flow over a replayed recording, per scan mode", bench_scan },
+};
+static const size_t scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+
+static void json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", *s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+/* Non-finite values are not JSON numbers */
+static void json_number(FILE *f, double v)
+{
+	if (std::isfinite(v))
+		fprintf(f, "%.6g", v);
+	else
+		fprintf(f, "null");
+}
+
+static int write_json(const bench_ctx *ctx, const char *path, const char *version)
+{
+	FILE *f = fopen(path, "w");
+	char utc[32] = "";
+	time_t now = time(NULL);
+
+	if (!f) {
+		fprintf(stderr, "error: cannot write '%s'\n", path);
+		return -1;
+	}
+	strftime(utc, sizeof(utc), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(f, "{\n  \"version\": ");
+	json_string(f, version);
+	fprintf(f, ",\n  \"time\": \"%s\",\n  \"kernel\": ", utc);
+	json_string(f, dsp_kernel_name(dsp_best_kernel()));
+	fprintf(f, ",\n  \"threads\": %u,\n  \"unit\": \"us\",\n  \"results\": [",
+		std::thread::hardware_concurrency());
+
+	for (size_t i = 0; i < ctx->results.size(); i++) {
+		const bench_case &c = ctx->results[i];
+		bench_summary s = summarize(c.us);
+
+		fprintf(f, "%s\n    {\"scenario\": ", i ? "," : "");
+		json_string(f, c.scenario.c_str());
+		fprintf(f, ", \"case\": ");
+		json_string(f, c.name.c_str());
+		fprintf(f, ", \"iterations\": %zu,\n     \"time\": {", c.us.size());
+		const double v[6] = { s.min, s.mean, s.p50, s.p90, s.p99, s.max };
+		const char *k[6] = { "min", "mean", "p50", "p90", "p99", "max" };
+		for (int j = 0; j < 6; j++) {
+			fprintf(f, "%s\"%s\": ", j ? ", " : "", k[j]);
+			json_number(f, v[j]);
+		}
+		fprintf(f, "},\n     \"metrics\": {");
+		for (size_t j = 0; j < c.metrics.size(); j++) {
+			fprintf(f, "%s", j ? ", " : "");
+			json_string(f, c.metrics[j].first.c_str());
+			fprintf(f, ": ");
+			json_number(f, c.metrics[j].second);
+		}
+		fprintf(f, "}}");
+	}
+	fprintf(f, "\n  ]\n}\n");
+
+	if (fclose(f)) {
+		fprintf(stderr, "error: cannot write '%s'\n", path);
+		return -1;
+	}
+	printf("JSON report written to '%s'\n", path);
+	return 0;
+}
+
+int bench_suite_run(const char *spec, const char *json_path, const char *iq_path,
+		    const char *version)
+{
+	std::vector<const bench_scenario *> run;
+	bench_ctx ctx;
+	int r = 0;
+
+	if (!strcmp(spec, "list")) {
+		printf("Benchmark scenarios (-P name[,name...] or all):\n");
+		for (size_t i = 0; i < scenario_count; i++)
+			printf("  %-10s %s\n", scenarios[i].name, scenarios[i].desc);
+		return 0;
+	}
+
+	if (!strcmp(spec, "all")) {
+		for (size_t i = 0; i < scenario_count; i++)
+			run.push_back(&scenarios[i]);
+	} else {
+		std::string s(spec);
+		size_t pos = 0;
+
+		while (pos <= s.size()) {
+			size_t end = s.find(',', pos);
+			std::string name = s.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+			size_t i;
+
+			for (i = 0; i < scenario_count; i++) {
+				if (name == scenarios[i].name)
+					break;
+			}
+			if (i == scenario_count) {
+				fprintf(stderr, "error: unknown benchmark scenario ``%s'' (-P list)\n", name.c_str());
+				return -1;
+			}
+			run.push_back(&scenarios[i]);
+			if (end == std::string::npos)
+				break;
+			pos = end + 1;
+		}
+	}
+
+	ctx.iq_path = iq_path;
+	ctx.truth_ppm = NAN;
+
+	printf("kal benchmark suite (kernel: %s)\n", dsp_kernel_name(dsp_best_kernel()));
+	for (size_t i = 0; i < run.size() && !g_kal_exit_req; i++) {
+		if (run[i]->run(&ctx)) {
+			fprintf(stderr, "error: benchmark scenario '%s' failed\n", run[i]->name);
+			r = -1;
+		}
+	}
+	printf("--------------------------------------------------------\n");
+
+	if (!ctx.synth_path.empty()) {
+		remove(ctx.synth_path.c_str());
+		remove((ctx.synth_path + IQ_META_SUFFIX).c_str());
+	}
+
+	if (json_path && write_json(&ctx, json_path, version))
+		r = -1;
+	return r;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file bench_suite.h
+ * @brief Named end-to-end benchmark scenarios (-P) with percentiles and JSON.
+ *
+ * Where run_dsp_benchmark() (-B) checks the resampler on one test signal,
+ * the suite times each stage of the pipeline the way kal runs it:
+ *
+ * - **resampler**: per engine and input format, per USB transfer.
+ * - **fcch**: fcch_detector::scan() per 12-frame window on synthetic
+ *   GSM bursts, across SNRs and frequency offsets (with detection rate
+ *   and offset error).
+ * - **ring**: spsc_buffer handoff between a producer and a consumer
+ *   thread, with an idle and a slow consumer (latency per block).
+ * - **offset**: offset_detect() flow over a replayed recording.
+ * - **scan**: c0_detect() flow over a replayed recording, per scan mode.
+ *
+ * The replay scenarios use the -r recording if one is given, otherwise
+ * a synthetic 2.5 MSPS capture written to the temporary directory.
+ * Every case records one time per iteration and reports min, mean, p50,
+ * p90, p99 and max; -J writes all of it as JSON for regression tracking.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __BENCH_SUITE_H__
+#define __BENCH_SUITE_H__
+
+/**
+ * @brief Runs benchmark scenarios.
+ * @param spec      "all", "list" (print the scenarios) or a comma separated
+ *                  list of scenario names.
+ * @param json_path JSON report file, or NULL for none.
+ * @param iq_path   Recording for the replay scenarios, or NULL for a
+ *                  synthetic one.
+ * @param version   Program version recorded in the JSON report.
+ * @return 0 on success, -1 on failure (error printed to stderr).
+ */
+int bench_suite_run(const char *spec, const char *json_path, const char *iq_path,
+		    const char *version);
+
+#endif /* __BENCH_SUITE_H__ */
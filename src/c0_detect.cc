@@ -15,6 +15,13 @@
 #include <string.h>
 #include <math.h>
 #include <signal.h> // For sig_atomic_t
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
 
 #ifdef _WIN32
 #include "win_compat.h"
@@ -23,47 +30,631 @@
 #include <unistd.h>
 #endif
 
-#include "hydrasdr_source.h"
-#include "circular_buffer.h"
+#include "sample_source.h"
+#include "spsc_buffer.h"
 #include "fcch_detector.h"
 #include "arfcn_freq.h"
+#include "band_plan.h"
+#include "kal_state.h"
 #include "util.h"
 #include "kal_globals.h"
 #include "kal_types.h"
+#include "wideband_scan.h"
+#include "dsp_channelizer.h"
+#include "c0_detect.h"
 
-#define MAX_ARFCN 2048
+#define NOTFOUND_MAX 10
+
+// Channelizer outputs dropped at the start of each capture (filter fill), at 1 sps
+#define CHZ_WARMUP 64
+
+// Helper to convert Linear L2 Norm to dBFS
+// Full Scale Reference = 1.0 (Native float32 range -1.0 to 1.0)
+// Accepts l2_norm (sqrt of sum of squares) and sample count
+static double calc_dbfs(double l2_norm, unsigned int len) {
+	if (l2_norm < 1e-9) return -120.0; // Noise floor floor
+	double rms = l2_norm / sqrt((double)len);
+	return 20.0 * log10(rms);
+}
+
+static const char *scan_mode_names[C0_SCAN_COUNT] = { "narrow", "wide", "multi" };
+
+const char *c0_scan_mode_name(c0_scan_mode mode)
+{
+	if (mode < 0 || mode >= C0_SCAN_COUNT)
+		return "unknown";
+	return scan_mode_names[mode];
+}
+
+int str_to_scan_mode(const char *s)
+{
+	for (int i = 0; i < C0_SCAN_COUNT; i++) {
+		if (!strcmp(s, scan_mode_names[i]))
+			return i;
+	}
+	return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Pass 1 power scan
+// ---------------------------------------------------------------------------
+
+/*
+ * Both methods measure the channels of plan blocks [b0, b1) and fill
+ * power[] (indexed like plan->chans) with sqrt(mean power *
+ * power_scan_len), the L2 norm a narrowband capture of power_scan_len
+ * samples would have, so calc_dbfs() and the detection threshold read
+ * the same either way. Channels a replayed recording does not cover are
+ * POWER_NOT_COVERED and left out of the threshold.
+ */
+#define POWER_NOT_COVERED -1.0
+
+// Tunes to every channel and measures the resampler output
+static int power_scan_narrow(sample_source *u, const band_plan *plan, unsigned int b0,
+			     unsigned int b1, unsigned int power_scan_len, double *power) {
+	unsigned int overruns, b_len;
+	double n;
+	complex *b;
+	spsc_buffer *ub = u->get_buffer();
+	const unsigned int end = plan->blocks[b1 - 1].first + plan->blocks[b1 - 1].count;
+
+	for(unsigned int i = plan->blocks[b0].first; i < end; i++) {
+		const band_chan &ch = plan->chans[i];
+
+		if (g_kal_exit_req) break;
+
+		if (!u->covers(ch.freq, WB_CHAN_HALF_BW)) {
+			power[i] = POWER_NOT_COVERED;
+			continue;
+		}
+
+		// Use short capture length
+		if(u->tune_capture(ch.freq, power_scan_len, &overruns)) {
+			if (g_kal_exit_req) break;
+			fprintf(stderr, "error: sample_source::tune_capture\n");
+			return -1;
+		}
+
+		b = (complex *)ub->peek(&b_len);
+		n = sqrt(vectornorm2<double>(b, power_scan_len)); // Calculate norm over short length
+		power[i] = n;
+		if(g_verbosity > 2) {
+			fprintf(stderr, "\tchan %d (%.1fMHz):\tpower: %6.1f dBFS\n",
+			   ch.arfcn, ch.freq / 1e6, calc_dbfs(n, power_scan_len));
+		}
+	}
+	return 0;
+}
+
+/*
+ * Tunes once per plan block and measures all its channels from one
+ * native rate capture (see band_plan.h): ten channels per tune, and DC
+ * falls halfway between two channels.
+ */
+static int power_scan_wide(sample_source *u, const band_plan *plan, unsigned int b0,
+			   unsigned int b1, unsigned int power_scan_len, double *power) {
+	unsigned int overruns, b_len, capture_len, tunes = 0;
+	wideband_scan *wb;
+	complex *b;
+	spsc_buffer *ub = u->get_buffer();
+	int r = 0;
+
+	try {
+		wb = new wideband_scan(u->native_rate());
+	} catch (const std::exception &e) {
+		fprintf(stderr, "error: c0_detect: %s\n", e.what());
+		return -1;
+	}
+
+	// One GSM frame, as in the narrowband scan, rounded up to whole segments
+	capture_len = wideband_scan::capture_len(
+		(unsigned int)ceil((8 * 156.25) * u->native_rate() / GSM_RATE));
+	if (g_debug) {
+		printf("debug: wideband power scan: %u samples, %.0f Hz bins\n",
+		       capture_len, u->native_rate() / WB_FFT_SIZE);
+	}
+
+	u->set_wideband(true);
+	for (unsigned int k = b0; k < b1; k++) {
+		const band_block &blk = plan->blocks[k];
+
+		if (g_kal_exit_req) break;
+
+		if(u->tune_capture(blk.tune_freq, capture_len, &overruns)) {
+			if (!g_kal_exit_req) {
+				fprintf(stderr, "error: sample_source::tune_capture\n");
+				r = -1;
+			}
+			break;
+		}
+		tunes++;
+
+		b = (complex *)ub->peek(&b_len);
+		wb->process(b, capture_len);
+
+		for (unsigned int i = blk.first; i < blk.first + blk.count; i++) {
+			const double offset = plan->chans[i].freq - blk.tune_freq;
+
+			if (u->covers(plan->chans[i].freq, WB_CHAN_HALF_BW))
+				power[i] = sqrt(wb->band_power(offset, WB_CHAN_HALF_BW) * power_scan_len);
+			else
+				power[i] = POWER_NOT_COVERED;
+		}
+	}
+	u->set_wideband(false);
+	u->flush();
+	delete wb;
+
+	if (g_debug)
+		printf("debug: wideband power scan: %u channels in %u tunes\n",
+		       plan->blocks[b1 - 1].first + plan->blocks[b1 - 1].count - plan->blocks[b0].first,
+		       tunes);
+
+	if(g_verbosity > 2 && !r && !g_kal_exit_req) {
+		for (unsigned int i = plan->blocks[b0].first;
+		     i < plan->blocks[b1 - 1].first + plan->blocks[b1 - 1].count; i++) {
+			if (power[i] == POWER_NOT_COVERED)
+				continue;
+			fprintf(stderr, "\tchan %d (%.1fMHz):\tpower: %6.1f dBFS\n",
+			   plan->chans[i].arfcn, plan->chans[i].freq / 1e6,
+			   calc_dbfs(power[i], power_scan_len));
+		}
+	}
+	return r;
+}
+
+// ---------------------------------------------------------------------------
+// Pass 2 scan pool
+// ---------------------------------------------------------------------------
+
+/*
+ * Pass 2 is pipelined: the main thread tunes and captures one snapshot per
+ * attempt into a free slot, and worker threads (one fcch_detector each)
+ * scan the snapshots meanwhile. Each detector is reset and trained on the
+ * snapshot before every scan, so a result only depends on its snapshot,
+ * not on which worker ran it or what it ran before. Results are reported
+ * in channel order.
+ */
+struct scan_job {
+	unsigned int cand;   // Index into the candidate list
+	unsigned int slot;   // Snapshot slot holding the capture
+	unsigned int found;
+	float offset;        // Offset from GSM_RATE / 4 (Hz)
+	double dbfs;
+};
+
+class scan_pool {
+public:
+	scan_pool(unsigned int workers, unsigned int slots, float sample_rate,
+		  unsigned int snap_len);
+	~scan_pool();
+
+	unsigned int slot_count() const { return (unsigned int)m_slots.size(); }
+	complex *slot(unsigned int i) { return &m_slots[i][0]; }
+
+	void submit(const scan_job &j);
+
+	/** @brief Pops a finished job; blocks if wait is set. */
+	bool result(scan_job *j, bool wait);
+
+private:
+	void worker_loop(fcch_detector *det);
+
+	unsigned int m_snap_len;
+	std::vector<std::vector<complex>> m_slots;
+	std::vector<fcch_detector *> m_detectors;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_job_cv;
+	std::condition_variable m_done_cv;
+	std::deque<scan_job> m_jobs;
+	std::deque<scan_job> m_done;
+	bool m_exit;
+};
+
+scan_pool::scan_pool(unsigned int workers, unsigned int slots, float sample_rate,
+		     unsigned int snap_len)
+{
+	m_snap_len = snap_len;
+	m_exit = false;
+	m_slots.resize(slots, std::vector<complex>(snap_len));
+
+	// Detectors are built up front so a constructor failure throws here
+	try {
+		for (unsigned int i = 0; i < workers; i++) {
+			fcch_detector *det = new fcch_detector(sample_rate);
+			det->set_peak_mode((fcch_peak_mode)g_peak_mode);
+			m_detectors.push_back(det);
+		}
+	} catch (...) {
+		for (size_t i = 0; i < m_detectors.size(); i++)
+			delete m_detectors[i];
+		throw;
+	}
+	for (unsigned int i = 0; i < workers; i++)
+		m_threads.push_back(std::thread(&scan_pool::worker_loop, this, m_detectors[i]));
+}
+
+scan_pool::~scan_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_job_cv.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+	for (size_t i = 0; i < m_detectors.size(); i++)
+		delete m_detectors[i];
+}
+
+void scan_pool::submit(const scan_job &j)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(j);
+	}
+	m_job_cv.notify_one();
+}
+
+bool scan_pool::result(scan_job *j, bool wait)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (wait)
+		m_done_cv.wait(lock, [this] { return !m_done.empty(); });
+	if (m_done.empty())
+		return false;
+
+	*j = m_done.front();
+	m_done.pop_front();
+	return true;
+}
+
+void scan_pool::worker_loop(fcch_detector *det)
+{
+	for (;;) {
+		scan_job j;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_job_cv.wait(lock, [this] { return m_exit || !m_jobs.empty(); });
+			if (m_exit)
+				return;
+			j = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		const complex *b = slot(j.slot);
+		float offset = 0.0f;
+
+		// Most candidates are empty: skip both NLMS passes when no window is tone-like
+		j.found = 0;
+		if (det->prescreen(b, m_snap_len)) {
+			det->reset();
+			det->train(b, m_snap_len);
+			j.found = det->scan(b, m_snap_len, &offset, 0);
+		}
+		j.offset = offset - (float)(GSM_RATE / 4);
+		if (j.found && !(fabsf(j.offset) < FCCH_OFFSET_MAX))
+			j.found = 0;
+		j.dbfs = j.found ? calc_dbfs(sqrt(vectornorm2<double>(b, m_snap_len)), m_snap_len) : 0.0;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done.push_back(j);
+		}
+		m_done_cv.notify_one();
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Pass 2
+// ---------------------------------------------------------------------------
+
+struct cand_state {
+	int chan;
+	double freq;                   // Downlink frequency (Hz)
+	unsigned int block;            // Tuning block in the band plan
+	bool known;                    // Found by the last scan of the band
+	unsigned int attempts;
+	int done;                      // 0 pending, 1 found, 2 not found
+	float offset;
+	double dbfs;
+	std::vector<complex> spectrum; // Kept for -A when found
+};
+
+static void print_channel(const cand_state &c) {
+
+	printf(" chan: %4d (%.1fMHz ", c.chan, c.freq / 1e6);
+	display_freq(c.offset);
+	printf(") power: %6.1f dBFS\n", c.dbfs);
+
+	if (g_show_fft && !c.spectrum.empty()) {
+		// Found a channel, show its spectrum!
+		draw_ascii_fft((std::complex<float>*)&c.spectrum[0], (int)c.spectrum.size(), 70);
+	}
+}
+
+/*
+ * FCCH search of the candidates on one source. cand is in frequency
+ * order; known carriers are visited first, then the others upwards, and
+ * among pending retries the one closest to the current tuning goes
+ * first, so the tuner mostly steps to a neighbour. With report set,
+ * found channels are printed in order as soon as they are final;
+ * otherwise the caller prints cand afterwards.
+ */
+static int fcch_pass(sample_source *u, const band_plan *plan, std::vector<cand_state> &cand,
+		     unsigned int workers, bool multi, unsigned int frames_len, bool report) {
+
+	unsigned int overruns, b_len;
+	double freq;
+	complex *b;
+	spsc_buffer *ub = u->get_buffer();
+	int r;
+
+	/*
+	 * One slot being captured while every worker scans one. In multi
+	 * mode a capture fills one slot per candidate it covers.
+	 */
+	const unsigned int block_max = (unsigned int)(2 * WB_SPAN_HZ / 200e3) + 1;
+	scan_pool *pool;
+	dsp_channelizer *chz = NULL;
+	try {
+		pool = new scan_pool(workers, workers + (multi ? block_max : 1),
+				     (float)u->sample_rate(), frames_len);
+	} catch (const std::exception &e) {
+		fprintf(stderr, "error: c0_detect: %s\n", e.what());
+		return -1;
+	}
+	if (multi) {
+		try {
+			chz = new dsp_channelizer(u->oversampling());
+		} catch (const std::exception &e) {
+			fprintf(stderr, "error: c0_detect: %s\n", e.what());
+			delete pool;
+			return -1;
+		}
+		u->set_wideband(true);
+	}
+
+	// Multi mode: native rate capture giving frames_len after the warm-up
+	const unsigned int chz_warmup = CHZ_WARMUP * u->oversampling();
+	const unsigned int chz_len = frames_len + chz_warmup;
+	const unsigned int wide_len = (unsigned int)ceil((chz_len + 2) * u->native_rate() / u->sample_rate());
+	std::vector<std::vector<complex>> chz_out(multi ? block_max : 0, std::vector<complex>(chz_len));
+	std::vector<complex *> chz_ptr(chz_out.size());
+	for (size_t k = 0; k < chz_out.size(); k++)
+		chz_ptr[k] = &chz_out[k][0];
+
+	std::vector<unsigned int> free_slots;
+	for (unsigned int s = 0; s < pool->slot_count(); s++)
+		free_slots.push_back(s);
+
+	// Visit order: carriers found by the last scan first
+	std::vector<unsigned int> order;
+	for (int known = 1; known >= 0; known--) {
+		for (unsigned int c = 0; c < cand.size(); c++) {
+			if (cand[c].known == (known != 0))
+				order.push_back(c);
+		}
+	}
+
+	// Where a candidate is captured from
+	auto tune_of = [&](unsigned int c) {
+		return multi ? plan->blocks[cand[c].block].tune_freq : cand[c].freq;
+	};
+
+	std::deque<unsigned int> retry;   // Candidates waiting for another capture
+	unsigned int next_new = 0, in_flight = 0, reported = 0;
+	double tuned = -1.0;
+	int result = 0;
+	const unsigned int spectrum_len = 2048;
+
+	while (reported < cand.size()) {
+		if (g_kal_exit_req) break;
+
+		// Multi mode captures ride-along candidates ahead of their turn
+		while (next_new < order.size() && cand[order[next_new]].attempts)
+			next_new++;
+
+		// Collect finished scans; block only when there is nothing to capture
+		scan_job j;
+		bool can_capture = !free_slots.empty() && (!retry.empty() || next_new < order.size());
+		while (in_flight && pool->result(&j, !can_capture)) {
+			cand_state &c = cand[j.cand];
+
+			in_flight--;
+			if (j.found) {
+				c.done = 1;
+				c.offset = j.offset;
+				c.dbfs = j.dbfs;
+				if (g_show_fft) {
+					const complex *snap = pool->slot(j.slot);
+					c.spectrum.assign(snap, snap + (std::min)(spectrum_len, frames_len));
+				}
+			} else if (c.attempts >= NOTFOUND_MAX) {
+				c.done = 2;
+			} else {
+				retry.push_back(j.cand);
+			}
+			free_slots.push_back(j.slot);
+			can_capture = !retry.empty() || next_new < order.size();
+		}
+
+		// Report finished channels in order
+		while (reported < cand.size() && cand[reported].done) {
+			cand_state &c = cand[reported++];
+			if (c.done == 1 && report)
+				print_channel(c);
+		}
+
+		if (!can_capture || free_slots.empty())
+			continue;
+
+		// Capture the next attempt: the nearest pending retry first, then new channels
+		std::vector<unsigned int> members;
+		if (!retry.empty()) {
+			size_t q_best = 0;
+			for (size_t q = 1; q < retry.size(); q++) {
+				if (fabs(tune_of(retry[q]) - tuned) < fabs(tune_of(retry[q_best]) - tuned))
+					q_best = q;
+			}
+			members.push_back(retry[q_best]);
+			retry.erase(retry.begin() + q_best);
+		} else {
+			members.push_back(order[next_new++]);
+		}
+		freq = cand[members[0]].freq;
+
+		// Multi mode: every waiting candidate of the block rides along
+		const double tune_freq = tune_of(members[0]);
+		if (multi) {
+			const unsigned int block = cand[members[0]].block;
+			for (size_t q = 0; q < retry.size() && members.size() < free_slots.size(); ) {
+				if (cand[retry[q]].block == block) {
+					members.push_back(retry[q]);
+					retry.erase(retry.begin() + q);
+				} else {
+					q++;
+				}
+			}
+			for (unsigned int c = 0; c < cand.size() && members.size() < free_slots.size(); c++) {
+				if (cand[c].block == block && !cand[c].attempts &&
+				    std::find(members.begin(), members.end(), c) == members.end())
+					members.push_back(c);
+			}
+		}
+
+		if (report && isatty(1)) {
+			printf("...chan %d (%.1fMHz)\r", cand[members[0]].chan, freq / 1e6);
+			fflush(stdout);
+		}
+
+		// Use full capture length for detection; a retry reuses the tune
+		const unsigned int capture_len = multi ? wide_len : frames_len;
+		if (tuned != tune_freq) {
+			r = u->tune_capture(tune_freq, capture_len, &overruns);
+			tuned = tune_freq;
+		} else {
+			u->flush();
+			r = u->capture(capture_len, &overruns);
+		}
+		if (r) {
+			if (!g_kal_exit_req) {
+				fprintf(stderr, "error: sample_source::tune_capture\n");
+				result = -1;
+			}
+			break;
+		}
+
+		b = (complex *)ub->peek(&b_len);
+		if (multi) {
+			std::vector<double> offsets;
+			for (size_t m = 0; m < members.size(); m++)
+				offsets.push_back(cand[members[m]].freq - tune_freq);
+			if (chz->set_channels(&offsets[0], (unsigned int)offsets.size()) ||
+			    chz->process(b, capture_len, &chz_ptr[0], chz_len) < chz_len) {
+				fprintf(stderr, "error: c0_detect: channelizer failed\n");
+				result = -1;
+				break;
+			}
+		}
+
+		for (size_t m = 0; m < members.size(); m++) {
+			j.cand = members[m];
+			j.slot = free_slots.back();
+			free_slots.pop_back();
+			if (multi)
+				memcpy(pool->slot(j.slot), &chz_out[m][chz_warmup], frames_len * sizeof(complex));
+			else
+				memcpy(pool->slot(j.slot), b, frames_len * sizeof(complex));
+
+			cand[j.cand].attempts++;
+			pool->submit(j);
+			in_flight++;
+		}
+	}
+
+	if (multi) {
+		u->set_wideband(false);
+		u->flush();
+	}
+	delete chz;
+	delete pool;
+	return result;
+}
+
+/*
+ * Runs fn(k) for every source k, on one thread each when there are
+ * several. Returns -1 if any call failed.
+ */
+template <typename F>
+static int for_each_source(unsigned int count, F fn) {
+
+	std::vector<int> r(count, -1);
+	std::vector<std::thread> threads;
+	int result = 0;
+
+	if (count == 1)
+		return fn(0u);
+
+	try {
+		for (unsigned int k = 0; k < count; k++)
+			threads.push_back(std::thread([&r, &fn, k] { r[k] = fn(k); }));
+	} catch (const std::exception &e) {
+		fprintf(stderr, "error: c0_detect: %s\n", e.what());
+	}
+	for (size_t k = 0; k < threads.size(); k++)
+		threads[k].join();
+
+	for (unsigned int k = 0; k < count; k++) {
+		if (r[k])
+			result = -1;
+	}
+	return result;
+}
+
+/*
+ * Splits n items in count contiguous runs, the first ones longer by one:
+ * run k is [split_begin(n, count, k), split_begin(n, count, k + 1)).
+ */
+static size_t split_begin(size_t n, unsigned int count, unsigned int k) {
+
+	return k * (n / count) + (std::min)((size_t)k, n % count);
+}
 
 /**
  * @brief Scans for a Base Station (C0 channel) in the specified band.
- * @param u Pointer to the HydraSDR source.
+ * @param u Opened sources; the band is split between them.
+ * @param count Number of sources.
  * @param bi Band Indicator.
+ * @param workers Number of pass 2 scan threads per source.
+ * @param mode Pass 1 power scan method.
  * @return 0 on success, -1 on failure.
  */
-int c0_detect(hydrasdr_source *u, int bi) {
-
-#define NOTFOUND_MAX 10
+int c0_detect(sample_source **u, unsigned int count, int bi, unsigned int workers,
+	      c0_scan_mode mode, std::vector<kal_c0> *found_out) {
 
-	int i, chan_count;
-	unsigned int overruns, b_len, frames_len, found_count, notfound_count, r;
+	unsigned int chan_count;
+	unsigned int frames_len;
 	unsigned int power_scan_len; // Short capture for power scan
+	const band_plan *plan;
+	std::vector<kal_c0> known;
 	
-	float offset, effective_offset, min_offset, max_offset;
-	
-	float spower[MAX_ARFCN];
-	double power[MAX_ARFCN];
-	
-	double freq, sps, n, a;
-	complex *b;
-	circular_buffer *ub;
-	fcch_detector *detector = new fcch_detector((float)u->sample_rate());
+	double sps, a;
 
-	if(bi == BI_NOT_DEFINED) {
+	if (found_out)
+		found_out->clear();
+	if(bi == BI_NOT_DEFINED || !(plan = get_band_plan(bi))) {
 		fprintf(stderr, "error: c0_detect: band not defined\n");
-		delete detector;
 		return -1;
 	}
+	if (workers < 1)
+		workers = 1;
 
-	sps = u->sample_rate() / GSM_RATE;
+	sps = u[0]->sample_rate() / GSM_RATE;
 	
 	// 12 frames for FCCH detection (approx 55ms)
 	frames_len = (unsigned int)ceil((12 * 8 * 156.25 + 156.25) * sps);
@@ -73,81 +664,60 @@ int c0_detect(hydrasdr_source *u, int bi) {
 	power_scan_len = (unsigned int)ceil((8 * 156.25) * sps); 
 	if (power_scan_len < 1024) power_scan_len = 1024; // Minimum safe size
 
-	// Helper to convert Linear L2 Norm to dBFS
-	// Full Scale Reference = 1.0 (Native float32 range -1.0 to 1.0)
-	// Accepts l2_norm (sqrt of sum of squares) and sample count
-	auto calc_dbfs = [&](double l2_norm, unsigned int len) -> double {
-		if (l2_norm < 1e-9) return -120.0; // Noise floor floor
-		double rms = l2_norm / sqrt((double)len);
-		return 20.0 * log10(rms);
-	};
-
-	ub = u->get_buffer();
-
-	memset(power, 0, sizeof(power));
-	memset(spower, 0, sizeof(spower));
+	// Indexed like plan->chans
+	std::vector<double> power(plan->chans.size(), 0.0);
 
 	if(g_verbosity > 2) {
 		fprintf(stderr, "calculate power in each channel:\n");
 	}
-	u->start();
-	u->flush();
-	
-	// --- PASS 1: Power Scan (Fast) ---
-	for(i = first_chan(bi); i >= 0; i = next_chan(i, bi)) {
-		if (g_kal_exit_req) break;
+	for (unsigned int k = 0; k < count; k++) {
+		if (u[k]->start())
+			return -1;
 
-		// Safety check for array bounds
-		if (i >= MAX_ARFCN) {
-			fprintf(stderr, "warning: ARFCN %d exceeds array size, skipping.\n", i);
-			continue;
+		// A GSM rate recording has no bandwidth to spare for a wideband scan
+		if (mode != C0_SCAN_NARROW && u[k]->native_rate() < 2 * (WB_SPAN_HZ + WB_CHAN_HALF_BW)) {
+			if (g_verbosity > 0)
+				fprintf(stderr, "source too narrow for a wideband scan, scanning per channel\n");
+			mode = C0_SCAN_NARROW;
 		}
 
-		freq = arfcn_to_freq(i, &bi);
-		if(u->tune(freq) != 0) {
-			if (g_kal_exit_req) break;
-			fprintf(stderr, "error: hydrasdr_source::tune\n");
-			delete detector;
-			return -1;
+		// The channelizer bank is laid out for the default native rate only
+		if (mode == C0_SCAN_MULTI && fabs(u[k]->native_rate() - DSP_RESAMPLER_INPUT_RATE) >= 1.0) {
+			if (g_verbosity > 0)
+				fprintf(stderr, "multi scan needs %.1f MSPS, using a wide scan\n",
+					DSP_RESAMPLER_INPUT_RATE / 1e6);
+			mode = C0_SCAN_WIDE;
 		}
+	}
 
-		do {
-			u->flush();
-			// Use short capture length
-			if(u->fill(power_scan_len, &overruns)) {
-				if (g_kal_exit_req) break;
-				fprintf(stderr, "error: hydrasdr_source::fill\n");
-				delete detector;
-				return -1;
-			}
-		} while(overruns);
-		
-		if (g_kal_exit_req) break;
+	// --- PASS 1: Power Scan (Fast), whole tuning blocks of the band per source ---
+	const bool wide = (mode == C0_SCAN_WIDE || mode == C0_SCAN_MULTI);
+	if (for_each_source(count, [&](unsigned int k) {
+		const unsigned int b0 = (unsigned int)split_begin(plan->blocks.size(), count, k);
+		const unsigned int b1 = (unsigned int)split_begin(plan->blocks.size(), count, k + 1);
+		if (b0 == b1)
+			return 0;
+		return wide ? power_scan_wide(u[k], plan, b0, b1, power_scan_len, &power[0]) :
+			      power_scan_narrow(u[k], plan, b0, b1, power_scan_len, &power[0]);
+	}))
+		return -1;
 
-		b = (complex *)ub->peek(&b_len);
-		n = sqrt(vectornorm2<double>(b, power_scan_len)); // Calculate norm over short length
-		power[i] = n;
-		if(g_verbosity > 2) {
-			fprintf(stderr, "\tchan %d (%.1fMHz):\tpower: %6.1f dBFS\n",
-			   i, freq / 1e6, calc_dbfs(n, power_scan_len));
-		}
-	}
-	
-	if (g_kal_exit_req) {
-		delete detector;
+	if (g_kal_exit_req)
 		return 0;
-	}
 
-	chan_count = 0;
-	for(i = first_chan(bi); i >= 0; i = next_chan(i, bi)) {
-		if (i < MAX_ARFCN) {
-		    spower[chan_count++] = (float)power[i];
-		}
+	// Threshold: mean of the weakest 60% of the measured channels
+	std::vector<float> spower;
+	for (size_t c = 0; c < power.size(); c++) {
+		if (power[c] != POWER_NOT_COVERED)
+			spower.push_back((float)power[c]);
 	}
-	sort(spower, chan_count);
+	chan_count = (unsigned int)spower.size();
 
-	if (chan_count > 0) {
-		a = avg(spower, chan_count - 4 * chan_count / 10, 0);
+	// A single measured channel (e.g. a GSM rate recording) has no floor
+	if (chan_count > 1) {
+		const unsigned int low = chan_count - 4 * chan_count / 10;
+		std::nth_element(spower.begin(), spower.begin() + low - 1, spower.end());
+		a = avg(&spower[0], (int)low, 0);
 	} else {
 		a = 0.0;
 	}
@@ -159,84 +729,85 @@ int c0_detect(hydrasdr_source *u, int bi) {
 
 	// --- PASS 2: FCCH Scan (Precise, on candidates only) ---
 	printf("%s:\n", bi_to_str(bi));
-	found_count = 0;
-	notfound_count = 0;
-	i = first_chan(bi);
-	do {
-		if (g_kal_exit_req) break;
 
-		if (i >= MAX_ARFCN) {
-			i = next_chan(i, bi);
-			continue;
-		}
+	// Carriers found last time are candidates even if they faded below the threshold
+	std::vector<char> is_known(plan->chans.size(), 0);
+	kal_state_load_c0(bi, &known);
+	for (size_t i = 0; i < known.size(); i++) {
+		const int c = plan->index(known[i].chan);
+		if (c >= 0)
+			is_known[c] = 1;
+	}
 
-		if(power[i] <= a) {
-			i = next_chan(i, bi);
-			continue;
+	std::vector<cand_state> cand;
+	unsigned int known_count = 0;
+	for (size_t c = 0; c < plan->chans.size(); c++) {
+		if (power[c] > a || (is_known[c] && power[c] != POWER_NOT_COVERED)) {
+			cand_state cs;
+			cs.chan = plan->chans[c].arfcn;
+			cs.freq = plan->chans[c].freq;
+			cs.block = plan->chans[c].block;
+			cs.known = is_known[c] != 0;
+			cs.attempts = 0;
+			cs.done = 0;
+			cs.offset = 0.0f;
+			cs.dbfs = 0.0;
+			cand.push_back(cs);
+			known_count += cs.known;
 		}
+	}
+	if (g_verbosity > 0 && known_count)
+		fprintf(stderr, "%u candidates, %u known from the last scan first\n",
+			(unsigned int)cand.size(), known_count);
 
-		freq = arfcn_to_freq(i, &bi);
-		if (isatty(1)) {
-			printf("...chan %d (%.1fMHz)\r", i, freq / 1e6);
-			fflush(stdout);
-		}
-		
-		if(u->tune(freq) != 0) {
-			if (g_kal_exit_req) break;
-			fprintf(stderr, "error: hydrasdr_source::tune\n");
-			delete detector;
-			return -1;
-		}
+	// Several sources: each takes a contiguous part, results are printed at the end
+	std::vector<std::vector<cand_state>> parts(count);
+	for (unsigned int k = 0; k < count; k++) {
+		parts[k].assign(cand.begin() + split_begin(cand.size(), count, k),
+				cand.begin() + split_begin(cand.size(), count, k + 1));
+	}
 
-		do {
-			u->flush();
-			// Use full capture length for detection
-			if(u->fill(frames_len, &overruns)) {
-				if (g_kal_exit_req) break;
-				fprintf(stderr, "error: hydrasdr_source::fill\n");
-				delete detector;
-				return -1;
-			}
-		} while(overruns);
-		
-		if (g_kal_exit_req) break;
+	int result = for_each_source(count, [&](unsigned int k) {
+		if (parts[k].empty())
+			return 0;
+		return fcch_pass(u[k], plan, parts[k], workers, mode == C0_SCAN_MULTI,
+				 frames_len, count == 1);
+	});
 
-		b = (complex *)ub->peek(&b_len);
-		r = detector->scan(b, b_len, &offset, 0);
-		effective_offset = offset - (float)(GSM_RATE / 4);
-		if(r && (fabsf(effective_offset) < FCCH_OFFSET_MAX)) {
-			if (found_count) {
-				min_offset = fmin(min_offset, effective_offset);
-				max_offset = fmax(max_offset, effective_offset);
-			} else {
-				min_offset = max_offset = effective_offset;
-			}
-			found_count++;
-			
-			// Recalculate power for the current buffer to match FFT display
-			double current_norm = sqrt(vectornorm2<double>(b, b_len));
-			double current_dbfs = calc_dbfs(current_norm, b_len);
-
-			printf(" chan: %4d (%.1fMHz ", i, freq / 1e6);
-			display_freq(effective_offset);
-			printf(") power: %6.1f dBFS\n", current_dbfs);
-
-			if (g_show_fft) {
-				// Found a channel, show its spectrum!
-				draw_ascii_fft((std::complex<float>*)b, 2048, 70);
+	if (count > 1 && !g_kal_exit_req) {
+		for (unsigned int k = 0; k < count; k++) {
+			for (size_t c = 0; c < parts[k].size(); c++) {
+				if (parts[k][c].done == 1)
+					print_channel(parts[k][c]);
 			}
+		}
+	}
 
-			notfound_count = 0;
-			i = next_chan(i, bi);
-		} else {
-			notfound_count += 1;
-			if(notfound_count >= NOTFOUND_MAX) {
-				notfound_count = 0;
-				i = next_chan(i, bi);
+	// A complete scan replaces the band's known carriers for the next one
+	if (!result && !g_kal_exit_req) {
+		std::vector<kal_c0> found;
+		for (unsigned int k = 0; k < count; k++) {
+			for (size_t c = 0; c < parts[k].size(); c++) {
+				if (parts[k][c].done != 1)
+					continue;
+				kal_c0 e;
+				e.chan = parts[k][c].chan;
+				e.dbfs = parts[k][c].dbfs;
+				e.offset = parts[k][c].offset;
+				found.push_back(e);
 			}
 		}
-	} while(i >= 0);
+		if (kal_state_save_c0(bi, found) && g_verbosity > 0)
+			fprintf(stderr, "warning: cannot save the scan results to '%s'\n", kal_state_path());
+		if (found_out)
+			found_out->swap(found);
+	}
 
-	delete detector;
-	return 0;
+	return result;
+}
+
+int c0_detect(sample_source *u, int bi, unsigned int workers, c0_scan_mode mode,
+	      std::vector<kal_c0> *found) {
+
+	return c0_detect(&u, 1, bi, workers, mode, found);
 }
@@ -33,8 +33,58 @@
 #ifndef C0_DETECT_H
 #define C0_DETECT_H
 
-class hydrasdr_source;
+#include <vector>
 
-int c0_detect(hydrasdr_source *u, int bi);
+class sample_source;
+struct kal_c0;
+
+/**
+ * @brief How the pass 1 power scan measures each channel.
+ */
+enum c0_scan_mode {
+	C0_SCAN_NARROW = 0,  /**< Tune and resample once per ARFCN */
+	C0_SCAN_WIDE,        /**< Pass 1 tunes once per ~2 MHz (FFT power) */
+	C0_SCAN_MULTI,       /**< As wide, and pass 2 channelizes each capture
+	                          to scan every candidate in the block at once */
+	C0_SCAN_COUNT
+};
+
+/** @brief Returns a printable scan mode name ("narrow", "wide", "multi"). */
+const char *c0_scan_mode_name(c0_scan_mode mode);
+
+/**
+ * @brief Parses a scan mode name.
+ * @return Mode identifier, or -1 if the name is unknown.
+ */
+int str_to_scan_mode(const char *s);
+
+/**
+ * @brief Scans a band for GSM base stations (C0 carriers).
+ * @param u       Opened HydraSDR source.
+ * @param bi      Band indicator.
+ * @param workers Threads running the FCCH detector in pass 2 while the
+ *                next candidate is captured (at least 1).
+ * @param mode    Pass 1 power scan method.
+ * @param found   Output: carriers found by a complete scan, in frequency
+ *                order (may be NULL).
+ * @return 0 on success, -1 on failure.
+ */
+int c0_detect(sample_source *u, int bi, unsigned int workers = 1,
+	      c0_scan_mode mode = C0_SCAN_NARROW, std::vector<kal_c0> *found = 0);
+
+/**
+ * @brief Scans a band with several sources at once.
+ *
+ * Both passes split the channel list in count contiguous parts, one per
+ * source, each on its own thread (pass 2 with its own workers). The
+ * detect threshold is taken over the whole band and the results are
+ * printed in channel order once every source is done.
+ *
+ * @param u     Opened sources, all on the same antenna.
+ * @param count Number of sources (1 is the same as c0_detect() above).
+ * @return 0 on success, -1 on failure.
+ */
+int c0_detect(sample_source **u, unsigned int count, int bi, unsigned int workers = 1,
+	      c0_scan_mode mode = C0_SCAN_NARROW, std::vector<kal_c0> *found = 0);
 
 #endif /* C0_DETECT_H */
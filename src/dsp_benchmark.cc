@@ -3,7 +3,8 @@
  * @brief DSP pipeline benchmark implementation.
  *
  * Extracted from util.cc to decouple utility functions from
- * HydraSDR hardware dependencies.
+ * HydraSDR hardware dependencies. The pipeline is driven through a
+ * sample_source mock, so no device library is needed.
  *
  * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
  * @copyright 2025 Benjamin Vernoux
@@ -21,13 +22,51 @@
 #include <iomanip>
 
 #include "util.h"
-#include "hydrasdr_source.h"
+#include "sample_source.h"
+#include "fcch_detector.h"
+#include "dsp_channelizer.h"
+#include "dsp_two_stage.h"
+#include "offset_stats.h"
 #include "kal_types.h"
 
 #ifdef _WIN32
 #include "win_compat.h"
 #endif
 
+// ---------------------------------------------------------------------------
+// Mock source: synthetic input pushed in USB transfer sized blocks
+// ---------------------------------------------------------------------------
+class benchmark_source : public sample_source {
+public:
+	benchmark_source() : sample_source(0.0f) {}
+	~benchmark_source() { close(); }
+
+	int open() { return alloc_ring(); }
+	int tune(double freq) { retuned(freq); return 0; }
+	int set_gain(float gain) { m_gain = gain; return 0; }
+
+	int start() {
+		if (!cb)
+			return -1;
+		reset_stream();
+		streaming.store(true, std::memory_order_release);
+		return 0;
+	}
+
+	int stop() {
+		streaming.store(false, std::memory_order_release);
+		if (cb)
+			cb->notify();
+		return 0;
+	}
+
+	/** @brief Runs one block through the pipeline, as the USB callback would. */
+	void feed(const std::complex<float> *samples, size_t count) {
+		process_samples(samples, count, SAMPLE_FORMAT_CF32,
+				m_segment.load(std::memory_order_acquire));
+	}
+};
+
 // ---------------------------------------------------------------------------
 // DSP BENCHMARK IMPLEMENTATION
 // ---------------------------------------------------------------------------
@@ -79,17 +118,10 @@ void run_dsp_benchmark() {
 	printf("\nGenerated input data 2.5 MSPS draw_ascii_fft() %zu samples:\n", input_data.size());
 	draw_ascii_fft(input_data.data(), (int)input_data.size(), 120, (float)FS_IN);
 
-	printf("\nRunning DSP Pipeline...\n");
+	printf("\nRunning DSP Pipeline (kernel: %s)...\n", dsp_kernel_name(dsp_best_kernel()));
 
 	// Instantiate source
-	hydrasdr_source* sim_src = new hydrasdr_source(10.0);
-
-	// Mock transfer struct
-	hydrasdr_transfer_t transfer;
-	transfer.device = NULL;
-	transfer.ctx = sim_src;
-	transfer.dropped_samples = 0;
-	transfer.sample_type = HYDRASDR_SAMPLE_FLOAT32_IQ;
+	benchmark_source* sim_src = new benchmark_source();
 
 	// Container to collect ALL processed samples
 	std::vector<std::complex<float>> output_data;
@@ -98,19 +130,20 @@ void run_dsp_benchmark() {
 	// Simulate realistic USB Transfer chunks
 	const size_t CHUNK_SIZE = 65536;
 
-	sim_src->start_benchmark();
+	if (sim_src->open() || sim_src->start()) {
+		fprintf(stderr, "error: benchmark source failed to start\n");
+		delete sim_src;
+		exit(1);
+	}
 
 	auto start = std::chrono::high_resolution_clock::now();
 
 	for (size_t offset = 0; offset < NUM_SAMPLES; offset += CHUNK_SIZE) {
 		size_t current_chunk = (std::min)(CHUNK_SIZE, NUM_SAMPLES - offset);
 
-		transfer.samples = (float*)&input_data[offset];
-		transfer.sample_count = (int)current_chunk;
-
-		sim_src->fill_buffer_callback(&transfer);
+		sim_src->feed(&input_data[offset], current_chunk);
 
-		circular_buffer *cb = sim_src->get_buffer();
+		spsc_buffer *cb = sim_src->get_buffer();
 		unsigned int avail = cb->data_available();
 		if (avail > 0) {
 			size_t current_size = output_data.size();
@@ -128,6 +161,473 @@ void run_dsp_benchmark() {
 	printf("Throughput: %.2f MSPS\n", (NUM_SAMPLES / 1e6) / elapsed.count());
 	printf("--------------------------------------------------------\n");
 
+	// Per-engine/kernel resampler throughput. Two-stage kernels are
+	// checked against the reference path; the fused engine uses its own
+	// filter (different delay and response) so it only reports cost.
+	printf("Resampler engines / kernels:\n");
+	std::vector<std::complex<float>> ref_out;
+	std::vector<std::complex<float>> kern_out(output_data.capacity());
+
+	for (int e = DSP_ENGINE_TWO_STAGE; e < DSP_ENGINE_COUNT; e++) {
+		dsp_engine_id eng = (dsp_engine_id)e;
+
+		for (int k = DSP_KERNEL_REFERENCE; k < DSP_KERNEL_COUNT; k++) {
+			dsp_kernel_id id = (dsp_kernel_id)k;
+			dsp_resampler* rs = new dsp_resampler();
+
+			// The fused engine has no per-sample path
+			if (eng == DSP_ENGINE_FUSED && id == DSP_KERNEL_REFERENCE) {
+				delete rs;
+				continue;
+			}
+
+			if (rs->set_kernel(id) != id) {
+				printf("  %-9s %-10s not supported on this CPU/build\n",
+				       dsp_engine_name(eng), dsp_kernel_name(id));
+				delete rs;
+				continue;
+			}
+			rs->set_engine(eng);
+
+			size_t produced = 0;
+			auto k_start = std::chrono::high_resolution_clock::now();
+
+			for (size_t offset = 0; offset < NUM_SAMPLES; offset += CHUNK_SIZE) {
+				size_t current_chunk = (std::min)(CHUNK_SIZE, NUM_SAMPLES - offset);
+				produced += rs->process(&input_data[offset], current_chunk,
+							&kern_out[produced], kern_out.size() - produced);
+			}
+
+			auto k_end = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double> k_elapsed = k_end - k_start;
+			double macs = rs->macs_per_output();
+			delete rs;
+
+			printf("  %-9s %-10s %8.4f s  %7.2f MSPS  %7.2fx realtime  %6.1f MACs/out",
+			       dsp_engine_name(eng), dsp_kernel_name(id), k_elapsed.count(),
+			       (NUM_SAMPLES / 1e6) / k_elapsed.count(),
+			       DURATION / k_elapsed.count(), macs);
+
+			if (eng != DSP_ENGINE_TWO_STAGE) {
+				printf("\n");
+				continue;
+			}
+
+			if (id == DSP_KERNEL_REFERENCE)
+				ref_out.assign(kern_out.begin(), kern_out.begin() + produced);
+
+			double max_err = 0.0;
+			size_t cmp_len = (std::min)(produced, ref_out.size());
+			for (size_t i = 0; i < cmp_len; i++)
+				max_err = (std::max)(max_err, (double)std::abs(kern_out[i] - ref_out[i]));
+
+			printf("  max err vs reference: %.2e\n", max_err);
+		}
+	}
+	printf("--------------------------------------------------------\n");
+
+	// int16 I/Q input path vs float32 on the same (quantized) signal.
+	// Test signal peaks above 1.0, so it is normalized to int16 full scale.
+	printf("Input format (kernel: %s):\n", dsp_kernel_name(dsp_best_kernel()));
+	float peak = 0.0f;
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		peak = (std::max)(peak, (std::max)(std::fabs(input_data[i].real()), std::fabs(input_data[i].imag())));
+
+	std::vector<int16_t> input_i16(2 * NUM_SAMPLES);
+	std::vector<std::complex<float>> input_q(NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		input_i16[2 * i] = (int16_t)lrintf(input_data[i].real() / peak * 32767.0f);
+		input_i16[2 * i + 1] = (int16_t)lrintf(input_data[i].imag() / peak * 32767.0f);
+		input_q[i] = std::complex<float>(input_i16[2 * i] * INT16_IQ_SCALE,
+						 input_i16[2 * i + 1] * INT16_IQ_SCALE);
+	}
+
+	std::vector<std::complex<float>> f32_out(kern_out.size());
+	for (int e = DSP_ENGINE_TWO_STAGE; e < DSP_ENGINE_COUNT; e++) {
+		dsp_engine_id eng = (dsp_engine_id)e;
+
+		for (int fmt = 0; fmt < 2; fmt++) {
+			dsp_resampler* rs = new dsp_resampler();
+			std::vector<std::complex<float>>& out = fmt ? kern_out : f32_out;
+			size_t produced = 0;
+
+			rs->set_engine(eng);
+			auto f_start = std::chrono::high_resolution_clock::now();
+
+			for (size_t offset = 0; offset < NUM_SAMPLES; offset += CHUNK_SIZE) {
+				size_t current_chunk = (std::min)(CHUNK_SIZE, NUM_SAMPLES - offset);
+				if (fmt)
+					produced += rs->process_int16(&input_i16[2 * offset], current_chunk,
+								      &out[produced], out.size() - produced);
+				else
+					produced += rs->process(&input_q[offset], current_chunk,
+								&out[produced], out.size() - produced);
+			}
+
+			auto f_end = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double> f_elapsed = f_end - f_start;
+			delete rs;
+
+			printf("  %-9s %-7s %8.4f s  %7.2f MSPS  %7.2fx realtime  %2d bytes/sample",
+			       dsp_engine_name(eng), fmt ? "int16" : "float32", f_elapsed.count(),
+			       (NUM_SAMPLES / 1e6) / f_elapsed.count(),
+			       DURATION / f_elapsed.count(), fmt ? 4 : 8);
+
+			if (fmt) {
+				double max_err = 0.0;
+				for (size_t i = 0; i < produced; i++)
+					max_err = (std::max)(max_err, (double)std::abs(kern_out[i] - f32_out[i]));
+				printf("  max err vs float32: %.2e", max_err);
+			}
+			printf("\n");
+		}
+	}
+	printf("--------------------------------------------------------\n");
+
+	// Native rates: every compiled two-stage configuration (rate and
+	// oversampling) on one second of a 67 kHz tone plus a 300 kHz one
+	// that must be rejected, timed per output sample (the figure open()
+	// chooses the rate by).
+	printf("Native rates (kernel: %s, 67 kHz tone + 300 kHz alias):\n",
+	       dsp_kernel_name(dsp_best_kernel()));
+	{
+		unsigned int n_cfg;
+		const dsp_two_stage_config *cfgs = dsp_two_stage_configs(&n_cfg);
+
+		for (unsigned int c = 0; c < n_cfg; c++) {
+			const double fs = cfgs[c].input_rate;
+			const size_t n = (size_t)fs;
+			std::vector<std::complex<float>> in(n), in_pass(n);
+			std::vector<std::complex<float>> out((size_t)(n * FS_OUT * cfgs[c].sps / fs) + 16);
+			dsp_resampler* rs = new dsp_resampler();
+
+			for (size_t i = 0; i < n; i++) {
+				in_pass[i] = std::polar(0.5f, (float)fmod(2.0 * M_PI * 67000.0 * i / fs, 2.0 * M_PI));
+				in[i] = in_pass[i] + std::polar(0.5f, (float)fmod(2.0 * M_PI * 300000.0 * i / fs, 2.0 * M_PI));
+			}
+			rs->set_input_rate(fs);
+			rs->set_output_sps(cfgs[c].sps);
+
+			size_t produced = 0;
+			auto r_start = std::chrono::high_resolution_clock::now();
+			for (size_t offset = 0; offset < n; offset += CHUNK_SIZE) {
+				size_t current_chunk = (std::min)(CHUNK_SIZE, n - offset);
+				produced += rs->process(&in[offset], current_chunk,
+							&out[produced], out.size() - produced);
+			}
+			auto r_end = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double> r_elapsed = r_end - r_start;
+
+			// Alias residue: difference against the 67 kHz tone alone
+			std::vector<std::complex<float>> ref(out.size());
+			rs->reset();
+			size_t ref_n = rs->process(&in_pass[0], n, &ref[0], ref.size());
+			double err = 0.0, sig = 0.0;
+			for (size_t i = rs->warmup_outputs(); i < (std::min)(produced, ref_n); i++) {
+				err += std::norm(out[i] - ref[i]);
+				sig += std::norm(ref[i]);
+			}
+
+			printf("  %5.1f MSPS %u sps  %8.4f s  %7.2fx realtime  %6.2f ns/out  %6.1f MACs/out  alias %6.1f dB\n",
+			       fs / 1e6, cfgs[c].sps, r_elapsed.count(), 1.0 / r_elapsed.count(),
+			       1e9 * r_elapsed.count() / produced, rs->macs_per_output(),
+			       10.0 * log10((err + 1e-30) / sig));
+			delete rs;
+		}
+	}
+	printf("--------------------------------------------------------\n");
+
+	// Channelizer: 10 channels on the 200 kHz grid (tuned between two
+	// channels, as in the multi-channel band scan) against one mixer and
+	// resampler per channel, on the first second of the test signal.
+	printf("Channelizer (10 channels, polyphase FFT vs mixer + resampler per channel):\n");
+	{
+		const unsigned int N_CH = 10;
+		const size_t CHZ_LEN = (std::min)(NUM_SAMPLES, (size_t)FS_IN);
+		const size_t out_cap = (size_t)(CHZ_LEN * FS_OUT / FS_IN) + 16;
+		double offsets[N_CH];
+		std::vector<std::vector<std::complex<float>>> chz_out(N_CH), ddc_out(N_CH);
+		std::vector<std::complex<float>*> out_ptr(N_CH);
+		std::vector<std::complex<float>> mixed(CHUNK_SIZE);
+		size_t chz_n = 0, ddc_n = 0;
+
+		for (unsigned int c = 0; c < N_CH; c++) {
+			offsets[c] = -900000.0 + 200000.0 * c;
+			chz_out[c].resize(out_cap);
+			ddc_out[c].resize(out_cap);
+			out_ptr[c] = &chz_out[c][0];
+		}
+
+		dsp_channelizer* chz = new dsp_channelizer();
+		chz->set_channels(offsets, N_CH);
+		auto c_start = std::chrono::high_resolution_clock::now();
+		for (size_t offset = 0; offset < CHZ_LEN; offset += CHUNK_SIZE) {
+			size_t current_chunk = (std::min)(CHUNK_SIZE, CHZ_LEN - offset);
+			std::vector<std::complex<float>*> dst(N_CH);
+			for (unsigned int c = 0; c < N_CH; c++)
+				dst[c] = out_ptr[c] + chz_n;
+			chz_n += chz->process(&input_data[offset], current_chunk, &dst[0], out_cap - chz_n);
+		}
+		auto c_end = std::chrono::high_resolution_clock::now();
+		delete chz;
+
+		auto d_start = std::chrono::high_resolution_clock::now();
+		for (unsigned int c = 0; c < N_CH; c++) {
+			dsp_resampler* rs = new dsp_resampler();
+			const int k = ((int)lrint(offsets[c] / CHZ_BIN_HZ) + CHZ_BRANCHES) % CHZ_BRANCHES;
+			std::complex<float> lo[CHZ_BRANCHES];
+			size_t produced = 0;
+
+			// Bin frequencies repeat every CHZ_BRANCHES samples
+			for (int i = 0; i < CHZ_BRANCHES; i++)
+				lo[i] = std::polar(1.0f, (float)(-2.0 * M_PI * ((k * i) % CHZ_BRANCHES) / CHZ_BRANCHES));
+
+			for (size_t offset = 0; offset < CHZ_LEN; offset += CHUNK_SIZE) {
+				size_t current_chunk = (std::min)(CHUNK_SIZE, CHZ_LEN - offset);
+				for (size_t i = 0; i < current_chunk; i++)
+					mixed[i] = input_data[offset + i] * lo[(offset + i) % CHZ_BRANCHES];
+				produced += rs->process(&mixed[0], current_chunk,
+							&ddc_out[c][produced], out_cap - produced);
+			}
+			ddc_n = produced;
+			delete rs;
+		}
+		auto d_end = std::chrono::high_resolution_clock::now();
+
+		double max_err = 0.0;
+		for (unsigned int c = 0; c < N_CH; c++) {
+			for (size_t i = 0; i < (std::min)(chz_n, ddc_n); i++)
+				max_err = (std::max)(max_err, (double)std::abs(chz_out[c][i] - ddc_out[c][i]));
+		}
+
+		std::chrono::duration<double> c_elapsed = c_end - c_start;
+		std::chrono::duration<double> d_elapsed = d_end - d_start;
+		printf("  channelizer  %8.4f s  %7.2fx realtime  (%zu samples/channel)\n",
+		       c_elapsed.count(), (CHZ_LEN / FS_IN) / c_elapsed.count(), chz_n);
+		printf("  per channel  %8.4f s  %7.2fx realtime  (%zu samples/channel)\n",
+		       d_elapsed.count(), (CHZ_LEN / FS_IN) / d_elapsed.count(), ddc_n);
+		printf("  max err vs per channel: %.2e\n", max_err);
+	}
+	printf("--------------------------------------------------------\n");
+
+	// FCCH detector NLMS predictor: block kernels vs the per-sample
+	// reference, on the resampled output plus a little noise so the
+	// predictor never fully converges. Frames match offset_detect().
+	printf("FCCH detector NLMS (per-sample reference vs block kernels):\n");
+	const unsigned int FRAME_LEN = (unsigned int)ceil(12 * 8 * 156.25 + 156.25);
+	std::vector<std::complex<float>> nlms_in(output_data.size());
+	unsigned int lcg = 12345;
+	for (size_t i = 0; i < nlms_in.size(); i++) {
+		float n[2];
+		for (int c = 0; c < 2; c++) {
+			lcg = lcg * 1103515245u + 12345u;
+			n[c] = ((float)(lcg >> 8) / 16777216.0f - 0.5f) * 0.1f;
+		}
+		nlms_in[i] = output_data[i] + std::complex<float>(n[0], n[1]);
+	}
+
+	std::vector<float> ref_err;
+	for (int k = DSP_KERNEL_REFERENCE; k < DSP_KERNEL_COUNT && nlms_in.size() >= FRAME_LEN; k++) {
+		dsp_kernel_id id = (dsp_kernel_id)k;
+		fcch_detector* det = new fcch_detector((float)FS_OUT);
+
+		if (det->set_kernel(id) != id) {
+			printf("  %-10s not supported on this CPU/build\n", dsp_kernel_name(id));
+			delete det;
+			continue;
+		}
+
+		size_t frames = 0;
+		double max_err = 0.0;
+		auto n_start = std::chrono::high_resolution_clock::now();
+
+		for (size_t offset = 0; offset + FRAME_LEN <= nlms_in.size(); offset += FRAME_LEN) {
+			unsigned int e_len;
+			det->scan(&nlms_in[offset], FRAME_LEN, NULL, NULL);
+			const float* e = det->dump_e(&e_len);
+
+			// Compare relative error frame by frame (state carries over)
+			if (id == DSP_KERNEL_REFERENCE) {
+				ref_err.insert(ref_err.end(), e, e + e_len);
+			} else {
+				const float* r = &ref_err[frames * e_len];
+				for (unsigned int i = 0; i < e_len; i++)
+					max_err = (std::max)(max_err, (double)fabs(e[i] - r[i]) /
+							     (std::max)((double)fabs(r[i]), 1e-3));
+			}
+			frames++;
+		}
+
+		auto n_end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> n_elapsed = n_end - n_start;
+		delete det;
+
+		printf("  %-10s %8.4f s  %7.2f MSPS  %7.2fx realtime",
+		       dsp_kernel_name(id), n_elapsed.count(),
+		       (frames * FRAME_LEN / 1e6) / n_elapsed.count(),
+		       (frames * FRAME_LEN / FS_OUT) / n_elapsed.count());
+		if (id != DSP_KERNEL_REFERENCE)
+			printf("  max rel err vs reference: %.2e", max_err);
+		printf("\n");
+	}
+	printf("--------------------------------------------------------\n");
+
+	// FFT peak refinement accuracy on synthetic FCCH bursts: 148-sample
+	// tone at GSM_RATE/4 + offset (within +-FCCH_OFFSET_MAX) at 20 dB SNR.
+	printf("FCCH peak refinement (%d synthetic bursts, 20 dB SNR):\n", 500);
+	{
+		const int TRIALS = 500;
+		const unsigned int BURST_LEN = 148;
+		std::vector<std::complex<float>> bursts(TRIALS * BURST_LEN);
+		std::vector<double> truth(TRIALS);
+		std::vector<float> sinc_f(TRIALS);
+		unsigned int rng = 4242;
+
+		for (int t = 0; t < TRIALS; t++) {
+			rng = rng * 1103515245u + 12345u;
+			truth[t] = GSM_RATE / 4 + ((double)(rng >> 8) / 16777216.0 - 0.5) * 2.0 * FCCH_OFFSET_MAX;
+			double ph0 = (double)((rng >> 4) & 0xffff) / 65536.0 * 2.0 * M_PI;
+
+			for (unsigned int i = 0; i < BURST_LEN; i++) {
+				float n[2];
+				for (int c = 0; c < 2; c++) {
+					rng = rng * 1103515245u + 12345u;
+					// Uniform noise, variance 0.01 per component (20 dB SNR)
+					n[c] = ((float)(rng >> 8) / 16777216.0f - 0.5f) * 0.3464f;
+				}
+				double ph = fmod(ph0 + 2.0 * M_PI * truth[t] * i / FS_OUT, 2.0 * M_PI);
+				bursts[t * BURST_LEN + i] = std::complex<float>((float)cos(ph) + n[0],
+										(float)sin(ph) + n[1]);
+			}
+		}
+
+		fcch_detector* det = new fcch_detector((float)FS_OUT);
+		for (int m = FCCH_PEAK_SINC; m < FCCH_PEAK_COUNT; m++) {
+			double sum_err = 0.0, max_err = 0.0, max_dev = 0.0;
+			float pm;
+
+			det->set_peak_mode((fcch_peak_mode)m);
+			auto p_start = std::chrono::high_resolution_clock::now();
+
+			for (int t = 0; t < TRIALS; t++) {
+				float f = det->freq_detect(&bursts[t * BURST_LEN], BURST_LEN, &pm);
+				double err = fabs(f - truth[t]);
+
+				sum_err += err;
+				max_err = (std::max)(max_err, err);
+				if (m == FCCH_PEAK_SINC)
+					sinc_f[t] = f;
+				else
+					max_dev = (std::max)(max_dev, (double)fabs(f - sinc_f[t]));
+			}
+
+			auto p_end = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double> p_elapsed = p_end - p_start;
+
+			printf("  %-10s mean err %6.2f Hz  max err %7.2f Hz  max dev vs sinc %6.2f Hz  %7.2f us/burst\n",
+			       fcch_peak_mode_name((fcch_peak_mode)m), sum_err / TRIALS, max_err, max_dev,
+			       p_elapsed.count() * 1e6 / TRIALS);
+		}
+
+		// Tracking (offset_detect() after the first burst): track() on the
+		// predicted window, 8 symbols trimmed at each end, against a full
+		// scan() of one 12-frame window. Misfires are counted on windows
+		// of random MSK bits (a normal burst, no FCCH) at the same SNR.
+		const unsigned int W_LEN = BURST_LEN - 16;
+		unsigned int hits = 0, misfires = 0;
+		double t_scan = 0.0, ph = 0.0;
+		std::vector<std::complex<float>> msk(TRIALS * W_LEN);
+
+		for (size_t i = 0; i < msk.size(); i++) {
+			float n[2];
+			rng = rng * 1103515245u + 12345u;
+			ph += ((rng >> 16) & 1) ? M_PI / 2 : -M_PI / 2;
+			for (int c = 0; c < 2; c++) {
+				rng = rng * 1103515245u + 12345u;
+				n[c] = ((float)(rng >> 8) / 16777216.0f - 0.5f) * 0.3464f;
+			}
+			msk[i] = std::complex<float>((float)cos(ph) + n[0], (float)sin(ph) + n[1]);
+		}
+
+		det->set_peak_mode(FCCH_PEAK_TABLE);
+		auto t_start = std::chrono::high_resolution_clock::now();
+		for (int t = 0; t < TRIALS; t++)
+			hits += det->track(&bursts[t * BURST_LEN + 8], W_LEN, NULL);
+		auto t_end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> t_elapsed = t_end - t_start;
+
+		for (int t = 0; t < TRIALS; t++)
+			misfires += det->track(&msk[t * W_LEN], W_LEN, NULL);
+
+		if (nlms_in.size() >= FRAME_LEN) {
+			const int SCANS = 20;
+			auto s_start = std::chrono::high_resolution_clock::now();
+			for (int k = 0; k < SCANS; k++)
+				det->scan(&nlms_in[(k * FRAME_LEN) % (nlms_in.size() - FRAME_LEN + 1)],
+					  FRAME_LEN, NULL, NULL);
+			auto s_end = std::chrono::high_resolution_clock::now();
+			t_scan = std::chrono::duration<double>(s_end - s_start).count() / SCANS;
+		}
+
+		printf("  track()    %u/%d bursts, %u/%u misfires, %7.2f us/burst (scan() %.2f us/window, %.0fx)\n",
+		       hits, TRIALS, misfires, TRIALS, t_elapsed.count() * 1e6 / TRIALS, t_scan * 1e6,
+		       t_scan / (t_elapsed.count() / TRIALS));
+		delete det;
+	}
+	printf("--------------------------------------------------------\n");
+
+	// Running offset statistics (monitor mode) against sorting the same
+	// window and trimming it as offset_detect() used to.
+	printf("Offset statistics (100-burst window, 20000 offsets, vs sort + avg):\n");
+	{
+		const unsigned int WINDOW = 100;
+		const unsigned int COUNT = 20000;
+		offset_stats stats(WINDOW, 0.05);
+		std::vector<float> offsets(COUNT), win(WINDOW);
+		double max_dev = 0.0, sum_sq = 0.0, r_stddev, stddev;
+		unsigned int rng = 777;
+
+		for (unsigned int i = 0; i < COUNT; i++) {
+			rng = rng * 1103515245u + 12345u;
+			// Drifting reference plus an occasional false burst
+			offsets[i] = (float)(-70.0 + 5e-4 * i + ((double)(rng >> 8) / 16777216.0 - 0.5) * 6.0);
+			if ((rng & 0xff) == 0)
+				offsets[i] += 2000.0f;
+		}
+
+		auto s_start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < COUNT; i++) {
+			stats.add(offsets[i]);
+			stats.trimmed(&stddev, NULL, NULL);
+			stats.median();
+		}
+		auto s_end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> s_elapsed = s_end - s_start;
+
+		for (unsigned int i = WINDOW - 1; i < COUNT; i += 97) {
+			std::copy(offsets.begin() + (i + 1 - WINDOW), offsets.begin() + (i + 1), win.begin());
+			sort(win.data(), WINDOW);
+			double r_mean = avg(win.data() + WINDOW / 10, WINDOW - 2 * (WINDOW / 10), &r_stddev);
+
+			offset_stats check(WINDOW);
+			for (unsigned int k = 0; k <= i; k++)
+				check.add(offsets[k]);
+			double mean = check.trimmed(&stddev, NULL, NULL);
+			max_dev = (std::max)(max_dev, fabs(mean - r_mean));
+			max_dev = (std::max)(max_dev, fabs(stddev - r_stddev));
+		}
+
+		for (unsigned int i = 0; i < COUNT; i++)
+			sum_sq += (double)offsets[i] * offsets[i];
+		double r_all = sqrt(sum_sq / COUNT - stats.mean() * stats.mean());
+
+		printf("  trimmed mean/stddev max dev %.2e Hz, Welford stddev %.4f Hz (two-pass %.4f Hz)\n",
+		       max_dev, stats.stddev(), r_all);
+		printf("  median %.2f Hz, ema %.2f Hz, %.2f us/burst (add + trimmed + median)\n",
+		       stats.median(), stats.ema(), s_elapsed.count() * 1e6 / COUNT);
+	}
+	printf("--------------------------------------------------------\n");
+
 	// 2. Visualize Output (FULL PROCESSED DATASET)
 	if (!output_data.empty()) {
 		printf("\nGenerated output data 270.833 kSPS draw_ascii_fft() %zu samples:\n", output_data.size());
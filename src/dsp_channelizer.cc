@@ -0,0 +1,174 @@
+/**
+ * @file dsp_channelizer.cc
+ * @brief Implementation of the polyphase FFT channelizer.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "dsp_channelizer.h"
+#include "fft_plan_cache.h"
+
+#define CHZ_HIST (CHZ_TAPS_PER_BRANCH * CHZ_BRANCHES - 1)
+#define CHZ_MID_CAP (CHZ_BLOCK / CHZ_DECIM + 1)
+
+dsp_channelizer::dsp_channelizer(unsigned int sps)
+{
+	const float *h = dsp_resampler::stage1_coeffs();
+
+	for (int r = 0; r < CHZ_BRANCHES; r++) {
+		for (int p = 0; p < CHZ_TAPS_PER_BRANCH; p++) {
+			int n = p * CHZ_BRANCHES + r;
+			m_proto[r][p] = (n < S1_TAPS) ? h[n] : 0.0f;
+		}
+		m_rot[r] = std::polar(1.0f, (float)(-2.0 * M_PI * r / CHZ_BRANCHES));
+	}
+
+	m_buf.assign(CHZ_HIST + CHZ_BLOCK, std::complex<float>(0, 0));
+	m_decim_index = 0;
+	m_t = 0;
+	m_sps = sps;
+
+	m_fft = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * CHZ_BRANCHES);
+	if (!m_fft)
+		throw std::runtime_error("dsp_channelizer: fftwf_malloc failed!");
+
+	m_plan = fft_plan_acquire(CHZ_BRANCHES, m_fft, m_fft);
+	if (!m_plan) {
+		fftwf_free(m_fft);
+		throw std::runtime_error("dsp_channelizer: fftw plan failed!");
+	}
+}
+
+dsp_channelizer::~dsp_channelizer()
+{
+	for (size_t c = 0; c < m_stage2.size(); c++)
+		delete m_stage2[c];
+	if (m_plan)
+		fft_plan_release(m_plan);
+	if (m_fft)
+		fftwf_free(m_fft);
+}
+
+int dsp_channelizer::set_channels(const double *offsets, unsigned int count)
+{
+	std::vector<int> bins;
+
+	if (count > CHZ_BRANCHES)
+		return -1;
+
+	for (unsigned int c = 0; c < count; c++) {
+		double k = offsets[c] / CHZ_BIN_HZ;
+		int ki = (int)lrint(k);
+
+		if (fabs(k - ki) > 1e-6 || 2 * abs(ki) >= CHZ_BRANCHES)
+			return -1;
+		bins.push_back((ki + CHZ_BRANCHES) % CHZ_BRANCHES);
+	}
+
+	m_bins = bins;
+	while (m_stage2.size() < m_bins.size()) {
+		dsp_resampler *r = new dsp_resampler();
+
+		if (m_sps != 1 && r->set_output_sps(m_sps)) {
+			delete r;
+			return -1;
+		}
+		m_stage2.push_back(r);
+	}
+	while (m_stage2.size() > m_bins.size()) {
+		delete m_stage2.back();
+		m_stage2.pop_back();
+	}
+	m_mid.resize(m_bins.size() * CHZ_MID_CAP);
+
+	reset();
+	return 0;
+}
+
+void dsp_channelizer::reset()
+{
+	std::fill(m_buf.begin(), m_buf.end(), std::complex<float>(0, 0));
+	m_decim_index = 0;
+	m_t = 0;
+
+	for (size_t c = 0; c < m_stage2.size(); c++)
+		m_stage2[c]->reset();
+}
+
+size_t dsp_channelizer::process(const std::complex<float>* in, size_t in_count,
+				std::complex<float>* const* out, size_t out_cap)
+{
+	const unsigned int n_ch = channel_count();
+	size_t out_produced = 0;
+
+	while (in_count > 0 && out_produced < out_cap) {
+		int n = (in_count < CHZ_BLOCK) ? (int)in_count : CHZ_BLOCK;
+		int n_mid = 0;
+
+		memcpy(&m_buf[CHZ_HIST], in, n * sizeof(std::complex<float>));
+
+		/*
+		 * Same decimation phase as dsp_resampler Stage 1: an output
+		 * follows the input that brings m_decim_index to CHZ_DECIM.
+		 * Block sample j is m_buf[CHZ_HIST + j].
+		 */
+		for (int j = CHZ_DECIM - 1 - m_decim_index; j < n; j += CHZ_DECIM) {
+			const std::complex<float> *x = &m_buf[CHZ_HIST + j];
+			const int t = (m_t + j) % CHZ_BRANCHES;
+
+			/* Branch r sums h[p * 25 + r] * x[t - p * 25 - r] */
+			for (int r = 0; r < CHZ_BRANCHES; r++) {
+				float acc_r = 0.0f, acc_i = 0.0f;
+				for (int p = 0; p < CHZ_TAPS_PER_BRANCH; p++) {
+					const std::complex<float> v = x[-(p * CHZ_BRANCHES + r)];
+					acc_r += m_proto[r][p] * v.real();
+					acc_i += m_proto[r][p] * v.imag();
+				}
+				m_fft[r][0] = acc_r;
+				m_fft[r][1] = acc_i;
+			}
+			fftwf_execute_dft(m_plan, m_fft, m_fft);
+
+			/*
+			 * Bin k (mixed down by k * 100 kHz) is the inverse DFT
+			 * term, i.e. forward bin -k, times the mixer phase at t.
+			 */
+			for (unsigned int c = 0; c < n_ch; c++) {
+				const int k = m_bins[c];
+				const int q = (CHZ_BRANCHES - k) % CHZ_BRANCHES;
+				std::complex<float> y(m_fft[q][0], m_fft[q][1]);
+				m_mid[c * CHZ_MID_CAP + n_mid] = y * m_rot[(k * t) % CHZ_BRANCHES];
+			}
+			n_mid++;
+		}
+
+		m_decim_index = (m_decim_index + n) % CHZ_DECIM;
+		m_t = (m_t + n) % CHZ_BRANCHES;
+		std::copy(m_buf.begin() + n, m_buf.begin() + n + CHZ_HIST, m_buf.begin());
+
+		/* Stage 2 advances identically for every channel */
+		size_t got = 0;
+		for (unsigned int c = 0; c < n_ch; c++) {
+			got = m_stage2[c]->process_stage2(&m_mid[c * CHZ_MID_CAP], n_mid,
+							  out[c] + out_produced, out_cap - out_produced);
+		}
+		out_produced += got;
+
+		in += n;
+		in_count -= n;
+	}
+
+	return out_produced;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file dsp_channelizer.h
+ * @brief Polyphase FFT channelizer: one 2.5 MSPS capture → N GSM streams.
+ *
+ * An oversampled analysis filter bank with CHZ_BRANCHES = 25 branches
+ * (100 kHz bin spacing) and decimation by 5. The prototype is the
+ * dsp_resampler Stage 1 filter, so every bin output equals what mixing
+ * the input down by the bin frequency and running Stage 1 would give,
+ * but the 61-tap filter runs once per output instant for all bins
+ * instead of once per channel. Each selected bin then gets its own
+ * Stage 2 (dsp_resampler::process_stage2()) to reach 270.833 kSPS, or
+ * a multiple of it when the channelizer is built oversampled.
+ *
+ *   x[t] (2.5 MSPS) → 25 polyphase sums → 25-point FFT (every 5 inputs)
+ *                   → bin k × e^{-j2πkt/25} → Stage 2 → channel k
+ *
+ * GSM channels sit on a 200 kHz grid, so tuning between two channels
+ * (odd multiples of 100 kHz from each channel) puts them all on bins.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __DSP_CHANNELIZER_H__
+#define __DSP_CHANNELIZER_H__
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+#include <fftw3.h>
+#include "dsp_resampler.h"
+
+/** @brief Filter bank branches (= FFT size). */
+#define CHZ_BRANCHES 25
+
+/** @brief Output decimation, same as Stage 1 (500 kSPS per bin). */
+#define CHZ_DECIM S1_DECIMATION
+
+/** @brief Bin spacing (Hz): 2.5 MSPS / CHZ_BRANCHES. */
+#define CHZ_BIN_HZ 100000.0
+
+/** @brief Prototype taps per branch (S1_TAPS zero padded to 3 * 25). */
+#define CHZ_TAPS_PER_BRANCH ((S1_TAPS + CHZ_BRANCHES - 1) / CHZ_BRANCHES)
+
+/** @brief Input samples filtered per internal block. */
+#define CHZ_BLOCK 4096
+
+class dsp_channelizer {
+public:
+	/**
+	 * @param sps Output samples per GSM symbol (see dsp_resampler::set_output_sps()).
+	 * @throws std::runtime_error if the FFT buffer or plan cannot be created.
+	 */
+	explicit dsp_channelizer(unsigned int sps = 1);
+	~dsp_channelizer();
+
+	/**
+	 * @brief Selects the output channels and resets the state.
+	 *
+	 * @param offsets Channel centres relative to the tuned frequency
+	 *                (Hz), multiples of CHZ_BIN_HZ within ±1.2 MHz.
+	 * @param count   Number of channels (at most CHZ_BRANCHES).
+	 * @return 0 on success, -1 if an offset is not on the bin grid
+	 *         (or the oversampling has no Stage 2).
+	 */
+	int set_channels(const double *offsets, unsigned int count);
+
+	/** @brief Returns the number of selected channels. */
+	unsigned int channel_count() const { return (unsigned int)m_bins.size(); }
+
+	/** @brief Clears the filter history of the bank and every Stage 2. */
+	void reset();
+
+	/**
+	 * @brief Channelizes a block of 2.5 MSPS input.
+	 *
+	 * @param in       Input samples.
+	 * @param in_count Number of input samples.
+	 * @param out      One 270.833 kSPS x sps destination per channel, in
+	 *                 set_channels() order.
+	 * @param out_cap  Capacity of each destination (samples).
+	 * @return Samples written to each destination (same for all).
+	 */
+	size_t process(const std::complex<float>* in, size_t in_count,
+		       std::complex<float>* const* out, size_t out_cap);
+
+private:
+	/** @brief Polyphase prototype, [branch][tap] = h[tap * 25 + branch]. */
+	float m_proto[CHZ_BRANCHES][CHZ_TAPS_PER_BRANCH];
+
+	/** @brief e^{-j2πi/25}, output rotation table. */
+	std::complex<float> m_rot[CHZ_BRANCHES];
+
+	/** @brief Input with the previous block's tail in front (history). */
+	std::vector<std::complex<float>> m_buf;
+
+	/** @brief Bin outputs of one block, CHZ_BLOCK / CHZ_DECIM + 1 per channel. */
+	std::vector<std::complex<float>> m_mid;
+
+	/** @brief Inputs since the last output (0 to CHZ_DECIM-1). */
+	int m_decim_index;
+
+	/** @brief Input sample index modulo CHZ_BRANCHES. */
+	int m_t;
+
+	/** @brief Selected bins (0 to CHZ_BRANCHES-1). */
+	std::vector<int> m_bins;
+
+	/** @brief Output samples per symbol of every Stage 2. */
+	unsigned int m_sps;
+
+	/** @brief Stage 2 per selected channel. */
+	std::vector<dsp_resampler*> m_stage2;
+
+	fftwf_complex *m_fft;
+	fftwf_plan m_plan;
+};
+
+#endif /* __DSP_CHANNELIZER_H__ */
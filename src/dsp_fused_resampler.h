@@ -0,0 +1,133 @@
+/**
+ * @file dsp_fused_resampler.h
+ * @brief Single-stage polyphase resampler (×13/÷120) engine.
+ *
+ * Alternative to the two-stage pipeline of dsp_resampler:
+ *   2,500,000 Hz → [×13/120] → 270,833.333 Hz
+ *
+ * One polyphase filter bank runs directly at the input rate, so there is
+ * no intermediate 500 kHz buffer. The prototype is a Kaiser-windowed sinc
+ * designed at construction for the 32.5 MHz virtual rate (2.5 MHz × 13):
+ *
+ *   Taps:            2496 (13 phases × 192 taps)
+ *   6 dB cutoff:     135.4 kHz (output Nyquist)
+ *   Passband:        0 - 100 kHz, < 0.01 dB ripple
+ *   Alias rejection: > 83 dB for every band folding onto 0 - 100 kHz
+ *   DC gain:         13.0 (interpolation factor)
+ *
+ * It costs more multiplies per output than the folded two-stage design
+ * but trades them for a single pass over the data; use
+ * dsp_resampler::macs_per_output() and -B to pick per host.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __DSP_FUSED_RESAMPLER_H__
+#define __DSP_FUSED_RESAMPLER_H__
+
+#include <complex>
+#include <cstddef>
+#include <stdint.h>
+#include <new>
+#include "util.h"
+#include "dsp_simd.h"
+
+/** @brief Fused engine interpolation factor (= polyphase branches). */
+#define FUSED_INTERP 13
+
+/** @brief Fused engine decimation factor. */
+#define FUSED_DECIM 120
+
+/** @brief Fused engine taps per polyphase branch. */
+#define FUSED_TAPS_PER_PHASE 192
+
+/** @brief Fused engine prototype filter taps. */
+#define FUSED_TAPS (FUSED_INTERP * FUSED_TAPS_PER_PHASE)
+
+/** @brief Input samples deinterleaved per block. */
+#define FUSED_BLOCK 4096
+
+/**
+ * @class dsp_fused_resampler
+ * @brief Single polyphase ×13/÷120 filter on split I/Q data.
+ *
+ * Driven by dsp_resampler when DSP_ENGINE_FUSED is selected; uses the
+ * same dsp_kernels dot product as the two-stage block path.
+ */
+class dsp_fused_resampler {
+public:
+	dsp_fused_resampler();
+
+	/** @brief Clears the filter history and phase accumulator. */
+	void reset();
+
+	/**
+	 * @brief Sets the kernel table used for the branch dot products.
+	 * @param kernels Kernel table (must not be NULL).
+	 */
+	void set_kernels(const dsp_kernels* kernels) { m_kernels = kernels; }
+
+	/**
+	 * @brief Processes a block of input samples.
+	 *
+	 * Same contract as dsp_resampler::process(): if out_buffer fills
+	 * before all input is consumed, the rest of the current block's
+	 * outputs are dropped and the remaining input is lost; the filter
+	 * state stays consistent for the next call.
+	 */
+	size_t process(const std::complex<float>* in, size_t in_count,
+		       std::complex<float>* out_buffer, size_t out_cap);
+
+	/** @brief int16 I/Q variant, see dsp_resampler::process_int16(). */
+	size_t process_int16(const int16_t* in_iq, size_t in_count,
+			     std::complex<float>* out_buffer, size_t out_cap);
+
+	/** @brief Coefficient multiply-accumulates per output sample. */
+	static double macs_per_output() { return FUSED_TAPS_PER_PHASE; }
+
+	/** @brief Aligned allocation (see dsp_resampler::operator new). */
+	static void* operator new(size_t size) {
+		void* ptr = aligned_malloc(size, DEFAULT_ALIGNMENT);
+		if (!ptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+
+	/** @brief Aligned deallocation. */
+	static void operator delete(void* ptr) noexcept {
+		aligned_free(ptr);
+	}
+
+private:
+	/** @brief Kernel table for the dot products. */
+	const dsp_kernels* m_kernels;
+
+	/** @brief Polyphase phase accumulator (same walk as Stage 2). */
+	int m_phase;
+
+	/** @brief Polyphase branches, pre-reversed for forward dot products. */
+	alignas(64) float m_coeffs[FUSED_INTERP][FUSED_TAPS_PER_PHASE];
+
+	/** @brief Same branches pre-scaled by INT16_IQ_SCALE. */
+	alignas(64) float m_coeffs_i16[FUSED_INTERP][FUSED_TAPS_PER_PHASE];
+
+	/** @brief Deinterleaved input with FUSED_TAPS_PER_PHASE - 1 history. */
+	alignas(64) float m_re[FUSED_TAPS_PER_PHASE - 1 + FUSED_BLOCK];
+	alignas(64) float m_im[FUSED_TAPS_PER_PHASE - 1 + FUSED_BLOCK];
+
+	/** @brief Shared implementation for float and int16 input. */
+	template <typename T>
+	size_t process_iq(const T* in_iq, size_t in_count,
+			  std::complex<float>* out_buffer, size_t out_cap,
+			  const float (*coeffs)[FUSED_TAPS_PER_PHASE]);
+};
+
+#endif /* __DSP_FUSED_RESAMPLER_H__ */
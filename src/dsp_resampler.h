@@ -2,9 +2,15 @@
  * @file dsp_resampler.h
  * @brief Header for DSP Resampler (Stage 1 Decimator + Stage 2 Polyphase).
  *
- * Two-stage rational resampling pipeline:
+ * Two-stage rational resampling pipeline (default 2.5 MSPS input):
  *   2,500,000 Hz → [÷5] → 500,000 Hz → [×13/24] → 270,833.333 Hz
  *
+ * The pipeline is compiled once per supported hardware rate and output
+ * oversampling (dsp_two_stage.h), picked with set_input_rate() and
+ * set_output_sps(). At 2.5 MSPS and 1 sps a single-stage ×13/÷120 engine
+ * (dsp_fused_resampler.h) can be selected at runtime behind the same
+ * interface.
+ *
  * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
  * @copyright 2025 Benjamin Vernoux
  * @license BSD-2-Clause
@@ -21,8 +27,21 @@
 #include <complex>
 #include <vector>
 #include <cstddef>
+#include <stdint.h>
 #include <new>
 #include "util.h"
+#include "dsp_simd.h"
+
+class dsp_fused_resampler;
+class dsp_two_stage_engine;
+
+/** @brief Default input rate (Hz), the HydraSDR 2.5 MSPS mode. */
+#define DSP_RESAMPLER_INPUT_RATE 2500000
+
+/*
+ * Ratios and filters of the default (2.5 MSPS) two-stage configuration.
+ * dsp_channelizer is built on the same Stage 1.
+ */
 
 /** @brief Stage 1 decimation factor. */
 #define S1_DECIMATION 5
@@ -45,22 +64,114 @@
 /** @brief Stage 2 taps per polyphase branch. */
 #define S2_TAPS_PER_PHASE 57
 
+/** @brief Largest output oversampling (samples per GSM symbol). */
+#define DSP_RESAMPLER_MAX_SPS 4
+
+/** @brief int16 full scale, folded into the first filter stage. */
+#define INT16_IQ_SCALE (1.0f / 32768.0f)
+
+/** @brief Resampler engines selectable behind dsp_resampler. */
+enum dsp_engine_id {
+	DSP_ENGINE_TWO_STAGE = 0,  /**< ÷5 FIR + ×13/24 polyphase (default) */
+	DSP_ENGINE_FUSED,          /**< Single ×13/÷120 polyphase filter */
+	DSP_ENGINE_COUNT
+};
+
+/**
+ * @brief Returns a printable engine name ("two-stage" or "fused").
+ */
+const char *dsp_engine_name(dsp_engine_id id);
+
+/**
+ * @brief Parses an engine name as printed by dsp_engine_name().
+ * @return Engine identifier, or -1 if the name is unknown.
+ */
+int str_to_engine(const char *s);
+
+/**
+ * @brief Kaiser-windowed sinc lowpass design (unnormalized).
+ * @param h      Output: taps coefficients.
+ * @param taps   Filter length.
+ * @param cutoff 6 dB cutoff (Hz).
+ * @param rate   Sample rate the filter runs at (Hz).
+ * @param beta   Kaiser window parameter.
+ * @return Sum of the coefficients (divide by it for unity DC gain).
+ */
+double dsp_kaiser_lowpass(double *h, int taps, double cutoff, double rate, double beta);
+
 /**
  * @class dsp_resampler
  * @brief Two-stage rational resampler optimized for SIMD processing.
  *
- * Converts 2.5 MSPS input to 270.833 kSPS output using:
- * - Stage 1: Integer decimation by 5 with 61-tap anti-alias filter
- * - Stage 2: Polyphase rational resampling (13/24) with 729-tap prototype
+ * Converts the hardware rate to 270.833 kSPS output (or 2 / 4 samples
+ * per symbol, see set_output_sps()) using:
+ * - Stage 1: Integer decimation to 500 kHz (÷5 with a 61-tap anti-alias
+ *   filter at 2.5 MSPS)
+ * - Stage 2: Polyphase rational resampling (13/24, 13/12 or 13/6) with
+ *   729-tap prototype
  *
- * Internal buffers use alignas(64) for SIMD-friendly memory alignment.
- * Custom operator new/delete ensures proper alignment when heap-allocated.
+ * Two processing paths share the same filters:
+ * - Reference: per-sample processing on interleaved data
+ * - Block: a whole transfer is deinterleaved into split I/Q arrays and
+ *   filtered with the runtime-dispatched kernels from dsp_simd.h, using
+ *   the symmetry of the Stage 1 filter to halve its multiplies
+ *
+ * The filters live in the dsp_two_stage instantiation for the input
+ * rate, or in the fused engine.
  */
 class dsp_resampler {
 public:
 	dsp_resampler();
 	~dsp_resampler();
 
+	/**
+	 * @brief Switches to the configuration compiled for a hardware rate.
+	 *
+	 * Keeps the kernel and the output oversampling; the fused engine only
+	 * exists at the default rate and 1 sps, elsewhere the two-stage
+	 * engine is selected. The filter state is reset.
+	 *
+	 * @param rate Input rate (Hz).
+	 * @return 0 on success, -1 if no configuration matches (the current
+	 *         one is kept, error printed to stderr).
+	 */
+	int set_input_rate(double rate);
+
+	/** @brief Returns the input rate of the current configuration (Hz). */
+	double input_rate() const;
+
+	/**
+	 * @brief Selects the output oversampling (samples per GSM symbol).
+	 *
+	 * Same rules as set_input_rate(): the two-stage engine is selected
+	 * if sps is not 1, and the filter state is reset.
+	 *
+	 * @param sps 1, 2 or 4.
+	 * @return 0 on success, -1 if no configuration matches (the current
+	 *         one is kept, error printed to stderr).
+	 */
+	int set_output_sps(unsigned int sps);
+
+	/** @brief Returns the output samples per GSM symbol. */
+	unsigned int output_sps() const;
+
+	/** @brief Returns the output rate (Hz), GSM_RATE * output_sps(). */
+	double output_rate() const;
+
+	/** @brief Returns true if a configuration is compiled for rate and sps. */
+	static bool supports_rate(double rate, unsigned int sps = 1);
+
+	/**
+	 * @brief Block kernel MACs per output sample at a hardware rate.
+	 *
+	 * What macs_per_output() reports for the two-stage engine with a
+	 * block kernel, before the configuration exists; hardware rates
+	 * are chosen by this cost.
+	 *
+	 * @return Cost, or a negative value if rate is not supported.
+	 */
+	static double cost_per_output(double rate, unsigned int sps = 1);
+
 	/**
 	 * @brief Resets the internal filter state.
 	 *
@@ -78,8 +189,10 @@ public:
 	 * @param out_cap    Capacity of destination buffer in samples.
 	 * @return Number of samples written to out_buffer.
 	 *
-	 * @note Output rate is approximately in_count / 9.23 samples.
-	 *       Caller must ensure out_cap >= in_count / 9 to avoid data loss.
+	 * @note Output rate is approximately in_count / 9.23 samples at
+	 *       2.5 MSPS and 1 sps (x output_rate() / input_rate() in
+	 *       general). Caller must size out_cap from that ratio to avoid
+	 *       data loss.
 	 *
 	 * @warning If out_buffer fills before all input is processed,
 	 *          remaining input samples are LOST. Size buffers appropriately.
@@ -88,119 +201,105 @@ public:
 		       std::complex<float>* out_buffer, size_t out_cap);
 
 	/**
-	 * @brief Custom aligned operator new for SIMD-friendly allocation.
+	 * @brief Processes a block of interleaved int16 I/Q samples.
 	 *
-	 * This class uses alignas(64) for internal buffers to enable SIMD
-	 * optimizations. C++11/14 default operator new does not guarantee
-	 * 64-byte alignment, so we provide custom operators.
+	 * Same contract as process(), for HYDRASDR_SAMPLE_INT16_IQ data.
+	 * The 1/32768 int-to-float scale is folded into the first filter
+	 * stage coefficients, so samples are only widened to float while
+	 * being deinterleaved. Call reset() before switching between
+	 * process() and process_int16() on a running stream.
 	 *
-	 * @param size Size in bytes to allocate.
-	 * @return Pointer to aligned memory block.
-	 * @throws std::bad_alloc if allocation fails.
+	 * @param in_iq    Interleaved I/Q pairs (2 * in_count values).
+	 * @param in_count Number of complex input samples.
 	 */
-	static void* operator new(size_t size) {
-		void* ptr = aligned_malloc(size, DEFAULT_ALIGNMENT);
-		if (!ptr) {
-			throw std::bad_alloc();
-		}
-		return ptr;
-	}
+	size_t process_int16(const int16_t* in_iq, size_t in_count,
+			     std::complex<float>* out_buffer, size_t out_cap);
 
 	/**
-	 * @brief Custom aligned operator delete.
-	 * @param ptr Pointer to memory block allocated by operator new.
+	 * @brief Runs Stage 2 only (500 kSPS → output_rate()).
+	 *
+	 * For input that already went through a Stage 1 equivalent, e.g. one
+	 * output of dsp_channelizer. Always uses the two-stage engine's
+	 * Stage 2 filter, whatever engine is selected; do not mix with
+	 * process() on the same stream without reset().
+	 *
+	 * @param in       Input samples at 500 kSPS.
+	 * @param in_count Number of input samples.
 	 */
-	static void operator delete(void* ptr) noexcept {
-		aligned_free(ptr);
-	}
+	size_t process_stage2(const std::complex<float>* in, size_t in_count,
+			      std::complex<float>* out_buffer, size_t out_cap);
 
 	/**
-	 * @brief Custom aligned operator new[] for array allocation.
-	 * @param size Size in bytes to allocate.
-	 * @return Pointer to aligned memory block.
-	 * @throws std::bad_alloc if allocation fails.
+	 * @brief Stage 1 prototype filter of the default configuration
+	 *        (S1_TAPS coefficients, DC gain 1).
 	 */
-	static void* operator new[](size_t size) {
-		void* ptr = aligned_malloc(size, DEFAULT_ALIGNMENT);
-		if (!ptr) {
-			throw std::bad_alloc();
-		}
-		return ptr;
-	}
+	static const float* stage1_coeffs();
 
 	/**
-	 * @brief Custom aligned operator delete[] for array deallocation.
-	 * @param ptr Pointer to memory block allocated by operator new[].
-	 */
-	static void operator delete[](void* ptr) noexcept {
-		aligned_free(ptr);
-	}
-
-private:
-	/*
-	 * Stage 1 State (Decimator)
+	 * @brief Selects the processing kernel.
+	 *
+	 * DSP_KERNEL_AUTO resolves to dsp_best_kernel(). Unsupported kernels
+	 * fall back to the generic block kernel. The filter state is reset.
+	 *
+	 * @param id Kernel identifier.
+	 * @return The kernel actually selected.
 	 */
+	dsp_kernel_id set_kernel(dsp_kernel_id id);
 
-	/** @brief Decimation counter (0 to S1_DECIMATION-1). */
-	int s1_index;
+	/** @brief Returns the currently selected kernel. */
+	dsp_kernel_id kernel() const { return m_kernel_id; }
 
 	/**
-	 * @brief Double-sized history buffer for linear convolution.
+	 * @brief Selects the resampler engine.
+	 *
+	 * The fused engine always runs on a block kernel; with
+	 * DSP_KERNEL_REFERENCE selected it uses the generic one. The filter
+	 * state is reset.
 	 *
-	 * Samples are written at both [head] and [head + S1_TAPS] to enable
-	 * contiguous memory access during convolution without modulo operations.
+	 * @param id Engine identifier.
+	 * @return The engine actually selected.
 	 */
-	alignas(64) std::complex<float> s1_history[2 * S1_TAPS];
+	dsp_engine_id set_engine(dsp_engine_id id);
 
-	/** @brief Pre-reversed coefficients for forward-scan vectorization. */
-	alignas(64) float s1_coeffs_rev[S1_TAPS];
+	/** @brief Returns the currently selected engine. */
+	dsp_engine_id engine() const { return m_engine_id; }
 
-	/** @brief Write position in history buffer. */
-	int s1_head;
-
-	/*
-	 * Stage 2 State (Polyphase Resampler)
+	/**
+	 * @brief Coefficient multiply-accumulates per output sample.
+	 *
+	 * Counts one MAC per real coefficient applied (each is applied to I
+	 * and Q), for the current engine, kernel, input rate and output
+	 * oversampling. Stage 1 work is scaled by the Stage 1 outputs
+	 * consumed per final output (24/13 at 1 sps).
 	 */
+	double macs_per_output() const;
 
 	/**
-	 * @brief Polyphase filter banks (coefficients pre-reversed).
+	 * @brief Outputs still influenced by the zeroed history after reset().
 	 *
-	 * Organized as [phase][tap] for cache-friendly access during
-	 * the polyphase convolution inner loop.
+	 * The filter span of the current engine in input samples, converted
+	 * to output samples and rounded up: 37 for two-stage at 2.5 MSPS and
+	 * 1 sps (61 Stage 1 taps + 57 Stage 2 taps at 500 kSPS), 21 for
+	 * fused. Scales with the output oversampling.
 	 */
-	alignas(64) float s2_coeffs_poly[S2_PHASES][S2_TAPS_PER_PHASE];
-
-	/** @brief Double-sized history buffer (same technique as Stage 1). */
-	alignas(64) std::complex<float> s2_history[2 * S2_TAPS_PER_PHASE];
+	unsigned int warmup_outputs() const;
 
-	/** @brief Write position in Stage 2 history buffer. */
-	int s2_head;
+private:
+	/** @brief Replaces the two-stage engine (see set_input_rate()). */
+	int select(double rate, unsigned int sps);
 
-	/** @brief Current polyphase phase accumulator. */
-	int s2_phase_state;
+	/** @brief Selected kernel and its function table (NULL = reference). */
+	dsp_kernel_id m_kernel_id;
+	const dsp_kernels* m_kernels;
 
-	/*
-	 * Internal Processing Functions
-	 */
+	/** @brief Selected engine. */
+	dsp_engine_id m_engine_id;
 
-	/**
-	 * @brief Processes one input sample through Stage 1.
-	 *
-	 * When S1_DECIMATION samples have been accumulated, produces one
-	 * output sample and passes it to Stage 2.
-	 */
-	inline void push_stage1(std::complex<float> sample,
-				std::complex<float>* out_buffer,
-				size_t out_cap, size_t& out_produced);
+	/** @brief Two-stage engine for the current input rate and oversampling. */
+	dsp_two_stage_engine* m_two_stage;
 
-	/**
-	 * @brief Processes one sample through Stage 2 polyphase resampler.
-	 *
-	 * May produce 0 or 1 output samples depending on phase state.
-	 */
-	inline void push_stage2(std::complex<float> sample,
-				std::complex<float>* out_buffer,
-				size_t out_cap, size_t& out_produced);
+	/** @brief Fused engine, allocated on first selection. */
+	dsp_fused_resampler* m_fused;
 };
 
 #endif /* __DSP_RESAMPLER_H__ */
@@ -0,0 +1,574 @@
+/**
+ * @file dsp_simd.cc
+ * @brief Block FIR and NLMS kernels (generic, AVX2/FMA, NEON) and runtime dispatch.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "dsp_simd.h"
+
+/*
+ * AVX2 kernels are built with per-function target attributes so the rest
+ * of the binary stays baseline x86-64. MinGW GCC is excluded: it does not
+ * realign the stack to 32 bytes and AVX register spills would fault.
+ */
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64)) && \
+    (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)) && \
+    !(defined(__MINGW32__) && !defined(__clang__))
+#define KAL_HAVE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KAL_TARGET_AVX2
+#else
+#define KAL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KAL_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * ---------------------------------------------------------------------------
+ * NLMS helpers (shared by every kernel)
+ * ---------------------------------------------------------------------------
+ */
+
+/** @brief Gain update; keeps the previous gain on a silent window. */
+static inline float nlms_gain(float E, float G)
+{
+	return (E > 1e-10f) ? 1.0f / E : G;
+}
+
+/** @brief Error power average and normalized output sample. */
+static inline float nlms_norm_error(float E, float er, float ei,
+				    unsigned int n_taps, dsp_nlms_state *st)
+{
+	E /= n_taps;
+	st->e = (1.0f - st->p) * st->e + st->p * (er * er + ei * ei);
+	return (E > 1e-20f) ? (st->e / E) : 0.0f;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Generic Kernels (portable C++)
+ * ---------------------------------------------------------------------------
+ */
+
+static void generic_fir_sym_decim(const float *re, const float *im,
+				  size_t stride, size_t n_out,
+				  const float *fold, unsigned int n_fold,
+				  unsigned int n_taps,
+				  float *out_re, float *out_im)
+{
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j * stride;
+		const float *xi = im + j * stride;
+		float acc_r = 0.0f;
+		float acc_i = 0.0f;
+
+		for (unsigned int k = 0; k < n_fold; k++) {
+			acc_r += fold[k] * (xr[k] + xr[n_taps - 1 - k]);
+			acc_i += fold[k] * (xi[k] + xi[n_taps - 1 - k]);
+		}
+
+		out_re[j] = acc_r;
+		out_im[j] = acc_i;
+	}
+}
+
+static void generic_dot_split(const float *re, const float *im, const float *c,
+			      unsigned int n, float *acc_re, float *acc_im)
+{
+	float acc_r = 0.0f;
+	float acc_i = 0.0f;
+
+	for (unsigned int k = 0; k < n; k++) {
+		acc_r += re[k] * c[k];
+		acc_i += im[k] * c[k];
+	}
+
+	*acc_re = acc_r;
+	*acc_im = acc_i;
+}
+
+static void generic_nlms_predict(const float *re, const float *im,
+				 const float *energy, size_t n_out,
+				 unsigned int n_taps, unsigned int delay,
+				 float *w_re, float *w_im,
+				 dsp_nlms_state *st, float *err)
+{
+	float G = st->G;
+
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j;
+		const float *xi = im + j;
+		float yr = 0.0f;
+		float yi = 0.0f;
+		unsigned int k;
+
+		G = nlms_gain(energy[j], G);
+
+		/* y = conj(w) . x */
+		for (k = 0; k < n_taps; k++) {
+			yr += w_re[k] * xr[k] + w_im[k] * xi[k];
+			yi += w_re[k] * xi[k] - w_im[k] * xr[k];
+		}
+
+		const float er = xr[n_taps - 1 + delay] - yr;
+		const float ei = xi[n_taps - 1 + delay] - yi;
+		const float gr = G * er;
+		const float gi = G * ei;
+
+		/* w += G * conj(e) * x */
+		for (k = 0; k < n_taps; k++) {
+			w_re[k] += gr * xr[k] + gi * xi[k];
+			w_im[k] += gr * xi[k] - gi * xr[k];
+		}
+
+		err[j] = nlms_norm_error(energy[j], er, ei, n_taps, st);
+	}
+
+	st->G = G;
+}
+
+static const dsp_kernels generic_kernels = {
+	"generic",
+	generic_fir_sym_decim,
+	generic_dot_split,
+	generic_nlms_predict
+};
+
+/*
+ * ---------------------------------------------------------------------------
+ * AVX2 + FMA Kernels (x86)
+ * ---------------------------------------------------------------------------
+ */
+
+#ifdef KAL_HAVE_AVX2
+
+static inline KAL_TARGET_AVX2 float avx2_hsum(__m256 v)
+{
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+static KAL_TARGET_AVX2 void avx2_fir_sym_decim(const float *re, const float *im,
+					       size_t stride, size_t n_out,
+					       const float *fold, unsigned int n_fold,
+					       unsigned int n_taps,
+					       float *out_re, float *out_im)
+{
+	/* Lane permutation reversing a vector of 8 floats */
+	const __m256i rev = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const unsigned int n_vec = n_fold & ~7u;
+
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j * stride;
+		const float *xi = im + j * stride;
+		__m256 acc_r = _mm256_setzero_ps();
+		__m256 acc_i = _mm256_setzero_ps();
+		unsigned int k;
+
+		/*
+		 * Fold: x[k..k+7] + reversed(x[n_taps-8-k .. n_taps-1-k]),
+		 * then a single FMA per component with the shared coefficient.
+		 */
+		for (k = 0; k < n_vec; k += 8) {
+			__m256 c = _mm256_loadu_ps(fold + k);
+			__m256 tail_r = _mm256_permutevar8x32_ps(
+				_mm256_loadu_ps(xr + n_taps - 8 - k), rev);
+			__m256 tail_i = _mm256_permutevar8x32_ps(
+				_mm256_loadu_ps(xi + n_taps - 8 - k), rev);
+
+			acc_r = _mm256_fmadd_ps(c, _mm256_add_ps(_mm256_loadu_ps(xr + k), tail_r), acc_r);
+			acc_i = _mm256_fmadd_ps(c, _mm256_add_ps(_mm256_loadu_ps(xi + k), tail_i), acc_i);
+		}
+
+		float sum_r = avx2_hsum(acc_r);
+		float sum_i = avx2_hsum(acc_i);
+
+		for (; k < n_fold; k++) {
+			sum_r += fold[k] * (xr[k] + xr[n_taps - 1 - k]);
+			sum_i += fold[k] * (xi[k] + xi[n_taps - 1 - k]);
+		}
+
+		out_re[j] = sum_r;
+		out_im[j] = sum_i;
+	}
+}
+
+static KAL_TARGET_AVX2 void avx2_dot_split(const float *re, const float *im,
+					   const float *c, unsigned int n,
+					   float *acc_re, float *acc_im)
+{
+	__m256 acc_r = _mm256_setzero_ps();
+	__m256 acc_i = _mm256_setzero_ps();
+	unsigned int k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		__m256 cv = _mm256_loadu_ps(c + k);
+		acc_r = _mm256_fmadd_ps(_mm256_loadu_ps(re + k), cv, acc_r);
+		acc_i = _mm256_fmadd_ps(_mm256_loadu_ps(im + k), cv, acc_i);
+	}
+
+	float sum_r = avx2_hsum(acc_r);
+	float sum_i = avx2_hsum(acc_i);
+
+	for (; k < n; k++) {
+		sum_r += re[k] * c[k];
+		sum_i += im[k] * c[k];
+	}
+
+	*acc_re = sum_r;
+	*acc_im = sum_i;
+}
+
+static KAL_TARGET_AVX2 void avx2_nlms_predict(const float *re, const float *im,
+					      const float *energy, size_t n_out,
+					      unsigned int n_taps, unsigned int delay,
+					      float *w_re, float *w_im,
+					      dsp_nlms_state *st, float *err)
+{
+	const unsigned int n_vec = n_taps & ~7u;
+	float G = st->G;
+
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j;
+		const float *xi = im + j;
+		__m256 acc_r = _mm256_setzero_ps();
+		__m256 acc_i = _mm256_setzero_ps();
+		unsigned int k;
+
+		G = nlms_gain(energy[j], G);
+
+		for (k = 0; k < n_vec; k += 8) {
+			__m256 vr = _mm256_loadu_ps(xr + k);
+			__m256 vi = _mm256_loadu_ps(xi + k);
+			__m256 wr = _mm256_loadu_ps(w_re + k);
+			__m256 wi = _mm256_loadu_ps(w_im + k);
+
+			acc_r = _mm256_fmadd_ps(wr, vr, acc_r);
+			acc_r = _mm256_fmadd_ps(wi, vi, acc_r);
+			acc_i = _mm256_fmadd_ps(wr, vi, acc_i);
+			acc_i = _mm256_fnmadd_ps(wi, vr, acc_i);
+		}
+
+		float yr = avx2_hsum(acc_r);
+		float yi = avx2_hsum(acc_i);
+
+		for (; k < n_taps; k++) {
+			yr += w_re[k] * xr[k] + w_im[k] * xi[k];
+			yi += w_re[k] * xi[k] - w_im[k] * xr[k];
+		}
+
+		const float er = xr[n_taps - 1 + delay] - yr;
+		const float ei = xi[n_taps - 1 + delay] - yi;
+		const float gr = G * er;
+		const float gi = G * ei;
+		const __m256 vgr = _mm256_set1_ps(gr);
+		const __m256 vgi = _mm256_set1_ps(gi);
+
+		for (k = 0; k < n_vec; k += 8) {
+			__m256 vr = _mm256_loadu_ps(xr + k);
+			__m256 vi = _mm256_loadu_ps(xi + k);
+			__m256 wr = _mm256_loadu_ps(w_re + k);
+			__m256 wi = _mm256_loadu_ps(w_im + k);
+
+			wr = _mm256_fmadd_ps(vgr, vr, wr);
+			wr = _mm256_fmadd_ps(vgi, vi, wr);
+			wi = _mm256_fmadd_ps(vgr, vi, wi);
+			wi = _mm256_fnmadd_ps(vgi, vr, wi);
+			_mm256_storeu_ps(w_re + k, wr);
+			_mm256_storeu_ps(w_im + k, wi);
+		}
+		for (; k < n_taps; k++) {
+			w_re[k] += gr * xr[k] + gi * xi[k];
+			w_im[k] += gr * xi[k] - gi * xr[k];
+		}
+
+		err[j] = nlms_norm_error(energy[j], er, ei, n_taps, st);
+	}
+
+	st->G = G;
+}
+
+static const dsp_kernels avx2_kernels = {
+	"avx2",
+	avx2_fir_sym_decim,
+	avx2_dot_split,
+	avx2_nlms_predict
+};
+
+/**
+ * @brief Checks CPU and OS support for AVX2 + FMA.
+ */
+static bool cpu_has_avx2_fma()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int r[4];
+
+	__cpuid(r, 0);
+	if (r[0] < 7)
+		return false;
+
+	/* FMA (bit 12), OSXSAVE (bit 27), AVX (bit 28) */
+	__cpuid(r, 1);
+	if ((r[2] & ((1 << 12) | (1 << 27) | (1 << 28))) != ((1 << 12) | (1 << 27) | (1 << 28)))
+		return false;
+
+	/* OS must save XMM and YMM state */
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	/* AVX2 (leaf 7, EBX bit 5) */
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif /* KAL_HAVE_AVX2 */
+
+/*
+ * ---------------------------------------------------------------------------
+ * NEON Kernels (ARM)
+ * ---------------------------------------------------------------------------
+ */
+
+#ifdef KAL_HAVE_NEON
+
+static inline float32x4_t neon_rev(float32x4_t v)
+{
+	v = vrev64q_f32(v);
+	return vcombine_f32(vget_high_f32(v), vget_low_f32(v));
+}
+
+static inline float32x4_t neon_fma(float32x4_t acc, float32x4_t a, float32x4_t b)
+{
+#if defined(__aarch64__) || defined(__ARM_FEATURE_FMA)
+	return vfmaq_f32(acc, a, b);
+#else
+	return vmlaq_f32(acc, a, b);
+#endif
+}
+
+static inline float32x4_t neon_fms(float32x4_t acc, float32x4_t a, float32x4_t b)
+{
+#if defined(__aarch64__) || defined(__ARM_FEATURE_FMA)
+	return vfmsq_f32(acc, a, b);
+#else
+	return vmlsq_f32(acc, a, b);
+#endif
+}
+
+static inline float neon_hsum(float32x4_t v)
+{
+#if defined(__aarch64__)
+	return vaddvq_f32(v);
+#else
+	float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+
+static void neon_fir_sym_decim(const float *re, const float *im,
+			       size_t stride, size_t n_out,
+			       const float *fold, unsigned int n_fold,
+			       unsigned int n_taps,
+			       float *out_re, float *out_im)
+{
+	const unsigned int n_vec = n_fold & ~3u;
+
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j * stride;
+		const float *xi = im + j * stride;
+		float32x4_t acc_r = vdupq_n_f32(0.0f);
+		float32x4_t acc_i = vdupq_n_f32(0.0f);
+		unsigned int k;
+
+		for (k = 0; k < n_vec; k += 4) {
+			float32x4_t c = vld1q_f32(fold + k);
+			float32x4_t tail_r = neon_rev(vld1q_f32(xr + n_taps - 4 - k));
+			float32x4_t tail_i = neon_rev(vld1q_f32(xi + n_taps - 4 - k));
+
+			acc_r = neon_fma(acc_r, c, vaddq_f32(vld1q_f32(xr + k), tail_r));
+			acc_i = neon_fma(acc_i, c, vaddq_f32(vld1q_f32(xi + k), tail_i));
+		}
+
+		float sum_r = neon_hsum(acc_r);
+		float sum_i = neon_hsum(acc_i);
+
+		for (; k < n_fold; k++) {
+			sum_r += fold[k] * (xr[k] + xr[n_taps - 1 - k]);
+			sum_i += fold[k] * (xi[k] + xi[n_taps - 1 - k]);
+		}
+
+		out_re[j] = sum_r;
+		out_im[j] = sum_i;
+	}
+}
+
+static void neon_dot_split(const float *re, const float *im, const float *c,
+			   unsigned int n, float *acc_re, float *acc_im)
+{
+	float32x4_t acc_r = vdupq_n_f32(0.0f);
+	float32x4_t acc_i = vdupq_n_f32(0.0f);
+	unsigned int k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		float32x4_t cv = vld1q_f32(c + k);
+		acc_r = neon_fma(acc_r, vld1q_f32(re + k), cv);
+		acc_i = neon_fma(acc_i, vld1q_f32(im + k), cv);
+	}
+
+	float sum_r = neon_hsum(acc_r);
+	float sum_i = neon_hsum(acc_i);
+
+	for (; k < n; k++) {
+		sum_r += re[k] * c[k];
+		sum_i += im[k] * c[k];
+	}
+
+	*acc_re = sum_r;
+	*acc_im = sum_i;
+}
+
+static void neon_nlms_predict(const float *re, const float *im,
+			      const float *energy, size_t n_out,
+			      unsigned int n_taps, unsigned int delay,
+			      float *w_re, float *w_im,
+			      dsp_nlms_state *st, float *err)
+{
+	const unsigned int n_vec = n_taps & ~3u;
+	float G = st->G;
+
+	for (size_t j = 0; j < n_out; j++) {
+		const float *xr = re + j;
+		const float *xi = im + j;
+		float32x4_t acc_r = vdupq_n_f32(0.0f);
+		float32x4_t acc_i = vdupq_n_f32(0.0f);
+		unsigned int k;
+
+		G = nlms_gain(energy[j], G);
+
+		for (k = 0; k < n_vec; k += 4) {
+			float32x4_t vr = vld1q_f32(xr + k);
+			float32x4_t vi = vld1q_f32(xi + k);
+			float32x4_t wr = vld1q_f32(w_re + k);
+			float32x4_t wi = vld1q_f32(w_im + k);
+
+			acc_r = neon_fma(acc_r, wr, vr);
+			acc_r = neon_fma(acc_r, wi, vi);
+			acc_i = neon_fma(acc_i, wr, vi);
+			acc_i = neon_fms(acc_i, wi, vr);
+		}
+
+		float yr = neon_hsum(acc_r);
+		float yi = neon_hsum(acc_i);
+
+		for (; k < n_taps; k++) {
+			yr += w_re[k] * xr[k] + w_im[k] * xi[k];
+			yi += w_re[k] * xi[k] - w_im[k] * xr[k];
+		}
+
+		const float er = xr[n_taps - 1 + delay] - yr;
+		const float ei = xi[n_taps - 1 + delay] - yi;
+		const float gr = G * er;
+		const float gi = G * ei;
+		const float32x4_t vgr = vdupq_n_f32(gr);
+		const float32x4_t vgi = vdupq_n_f32(gi);
+
+		for (k = 0; k < n_vec; k += 4) {
+			float32x4_t vr = vld1q_f32(xr + k);
+			float32x4_t vi = vld1q_f32(xi + k);
+			float32x4_t wr = vld1q_f32(w_re + k);
+			float32x4_t wi = vld1q_f32(w_im + k);
+
+			wr = neon_fma(wr, vgr, vr);
+			wr = neon_fma(wr, vgi, vi);
+			wi = neon_fma(wi, vgr, vi);
+			wi = neon_fms(wi, vgi, vr);
+			vst1q_f32(w_re + k, wr);
+			vst1q_f32(w_im + k, wi);
+		}
+		for (; k < n_taps; k++) {
+			w_re[k] += gr * xr[k] + gi * xi[k];
+			w_im[k] += gr * xi[k] - gi * xr[k];
+		}
+
+		err[j] = nlms_norm_error(energy[j], er, ei, n_taps, st);
+	}
+
+	st->G = G;
+}
+
+static const dsp_kernels neon_kernels = {
+	"neon",
+	neon_fir_sym_decim,
+	neon_dot_split,
+	neon_nlms_predict
+};
+
+#endif /* KAL_HAVE_NEON */
+
+/*
+ * ---------------------------------------------------------------------------
+ * Dispatch
+ * ---------------------------------------------------------------------------
+ */
+
+const dsp_kernels *dsp_get_kernels(dsp_kernel_id id)
+{
+	switch (id) {
+	case DSP_KERNEL_GENERIC:
+		return &generic_kernels;
+#ifdef KAL_HAVE_AVX2
+	case DSP_KERNEL_AVX2: {
+		static const bool supported = cpu_has_avx2_fma();
+		return supported ? &avx2_kernels : NULL;
+	}
+#endif
+#ifdef KAL_HAVE_NEON
+	case DSP_KERNEL_NEON:
+		return &neon_kernels;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+dsp_kernel_id dsp_best_kernel()
+{
+	if (dsp_get_kernels(DSP_KERNEL_AVX2))
+		return DSP_KERNEL_AVX2;
+	if (dsp_get_kernels(DSP_KERNEL_NEON))
+		return DSP_KERNEL_NEON;
+	return DSP_KERNEL_GENERIC;
+}
+
+const char *dsp_kernel_name(dsp_kernel_id id)
+{
+	if (id == DSP_KERNEL_REFERENCE)
+		return "reference";
+	if (id == DSP_KERNEL_GENERIC)
+		return generic_kernels.name;
+	if (id == DSP_KERNEL_AVX2)
+		return "avx2";
+	if (id == DSP_KERNEL_NEON)
+		return "neon";
+	return "auto";
+}
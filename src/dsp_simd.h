@@ -0,0 +1,122 @@
+/**
+ * @file dsp_simd.h
+ * @brief Runtime-dispatched SIMD kernels for the block DSP paths.
+ *
+ * The block path of dsp_resampler keeps I and Q in separate (split) float
+ * arrays so every kernel below is a plain real-valued FIR applied twice.
+ * The FCCH detector uses the same split layout for its NLMS predictor.
+ * Each instruction set provides the same function table; the best table
+ * supported by the running CPU is selected once at startup.
+ *
+ * Available kernels:
+ * - reference: original per-sample push_stage1()/push_stage2() and
+ *              fcch_detector::next_norm_error() paths
+ * - generic:   portable C++ block kernels (auto-vectorized by the compiler)
+ * - avx2:      x86-64 AVX2 + FMA (runtime detected)
+ * - neon:      ARM Advanced SIMD (compile-time, mandatory on AArch64)
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __DSP_SIMD_H__
+#define __DSP_SIMD_H__
+
+#include <cstddef>
+
+/** @brief Identifiers for the resampler kernel implementations. */
+enum dsp_kernel_id {
+	DSP_KERNEL_AUTO = -1,      /**< Pick the fastest supported kernel */
+	DSP_KERNEL_REFERENCE = 0,  /**< Scalar per-sample path (reference) */
+	DSP_KERNEL_GENERIC,        /**< Portable block kernels */
+	DSP_KERNEL_AVX2,           /**< AVX2 + FMA block kernels */
+	DSP_KERNEL_NEON,           /**< NEON block kernels */
+	DSP_KERNEL_COUNT
+};
+
+/**
+ * @brief Recursive state of the NLMS predictor carried between blocks.
+ */
+struct dsp_nlms_state {
+	float G;  /**< Adaptive gain, kept when the window energy is ~0 */
+	float e;  /**< Running error power average */
+	float p;  /**< Error averaging coefficient */
+};
+
+/**
+ * @brief Function table implemented by each block kernel.
+ */
+struct dsp_kernels {
+	/** @brief Short kernel name, as printed by the benchmark. */
+	const char *name;
+
+	/**
+	 * @brief Symmetric (linear-phase) decimating FIR on split I/Q.
+	 *
+	 * For output j the window starts at re/im + j * stride and spans
+	 * n_taps samples. The filter is evaluated in folded form:
+	 *   acc = sum_k fold[k] * (x[k] + x[n_taps - 1 - k]),  k < n_fold
+	 * so the centre tap must be stored pre-halved and any padding
+	 * entries (k > n_taps / 2) must be zero. n_fold must not exceed
+	 * n_taps.
+	 */
+	void (*fir_sym_decim)(const float *re, const float *im,
+			      size_t stride, size_t n_out,
+			      const float *fold, unsigned int n_fold,
+			      unsigned int n_taps,
+			      float *out_re, float *out_im);
+
+	/**
+	 * @brief Real-coefficient dot product on split I/Q.
+	 *
+	 * Computes acc_re = sum(re[k] * c[k]) and acc_im = sum(im[k] * c[k])
+	 * for k < n.
+	 */
+	void (*dot_split)(const float *re, const float *im, const float *c,
+			  unsigned int n, float *acc_re, float *acc_im);
+
+	/**
+	 * @brief Complex NLMS one-step predictor on split I/Q.
+	 *
+	 * For output j the window is x[j .. j + n_taps - 1] and the desired
+	 * sample is x[j + n_taps - 1 + delay]. Weights are stored in window
+	 * order (w[k] multiplies x[j + k]) and updated in place:
+	 *   G   = 1 / energy[j]          (if energy[j] > 1e-10)
+	 *   y   = sum_k conj(w[k]) * x[j + k]
+	 *   e   = d - y
+	 *   w  += G * conj(e) * x[j .. j + n_taps - 1]
+	 *   err[j] = st->e / (energy[j] / n_taps), st->e averaged with st->p
+	 * energy[j] must hold the window power sum(|x[j + k]|^2).
+	 */
+	void (*nlms_predict)(const float *re, const float *im,
+			     const float *energy, size_t n_out,
+			     unsigned int n_taps, unsigned int delay,
+			     float *w_re, float *w_im,
+			     dsp_nlms_state *st, float *err);
+};
+
+/**
+ * @brief Returns the function table for a block kernel.
+ * @param id Kernel identifier (DSP_KERNEL_REFERENCE has no table).
+ * @return Table pointer, or NULL if the kernel is not supported by
+ *         this build or by the running CPU.
+ */
+const dsp_kernels *dsp_get_kernels(dsp_kernel_id id);
+
+/**
+ * @brief Returns the fastest kernel supported by the running CPU.
+ */
+dsp_kernel_id dsp_best_kernel();
+
+/**
+ * @brief Returns a printable kernel name ("reference", "avx2", ...).
+ */
+const char *dsp_kernel_name(dsp_kernel_id id);
+
+#endif /* __DSP_SIMD_H__ */
@@ -0,0 +1,285 @@
+/**
+ * @file dsp_two_stage.h
+ * @brief Two-stage resampler engine, one compiled configuration per input rate.
+ *
+ * Every configuration decimates to the same 500 kHz intermediate rate, so
+ * the Stage 2 polyphase filter is shared and only Stage 1 grows with the
+ * input rate:
+ *
+ *    2,500,000 Hz → [÷5,  61 taps]  → 500 kHz → [×13/24, 57 taps/phase] → 270.833 kHz
+ *    5,000,000 Hz → [÷10, 101 taps] → 500 kHz → [×13/24, 57 taps/phase]
+ *   10,000,000 Hz → [÷20, 201 taps] → 500 kHz → [×13/24, 57 taps/phase]
+ *
+ * Oversampled output (2 or 4 samples per GSM symbol) only changes the
+ * Stage 2 decimation, ×13/12 or ×13/6: the prototype already removes
+ * everything above 163 kHz, below the 270.833 kHz Nyquist of 2 sps.
+ *
+ * The ratios and tap counts are template parameters of dsp_two_stage, so
+ * buffers are sized exactly and every filter loop has a compile-time trip
+ * count. dsp_two_stage_engine::create() picks the instantiation for a
+ * hardware rate; dsp_resampler drives it.
+ *
+ * The 2.5 MSPS Stage 1 filter is the validated 61-tap table. The others
+ * are Kaiser designs with the same job: flat to 135 kHz, > 73 dB on every
+ * band folding onto 0 - 135 kHz at 500 kHz.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __DSP_TWO_STAGE_H__
+#define __DSP_TWO_STAGE_H__
+
+#include <complex>
+#include <cstddef>
+#include <stdint.h>
+#include <new>
+#include "util.h"
+#include "dsp_simd.h"
+
+/** @brief Block path: input samples deinterleaved per iteration. */
+#define S1_BLOCK 4096
+
+/**
+ * @brief Ratios and filters of one two-stage configuration.
+ */
+struct dsp_two_stage_config {
+	uint32_t input_rate;       /**< Hardware rate (Hz) */
+	unsigned int sps;          /**< Output samples per GSM symbol */
+	int s1_decim;              /**< Stage 1 decimation */
+	int s1_taps;               /**< Stage 1 FIR taps (odd, linear phase) */
+	int s2_interp;             /**< Stage 2 interpolation (= branches) */
+	int s2_decim;              /**< Stage 2 decimation */
+	int s2_taps_per_phase;     /**< Stage 2 taps per branch */
+	const float *s1_coeffs;    /**< Stage 1 table, or NULL for a Kaiser design */
+};
+
+/**
+ * @brief Returns the compiled configurations, lowest input rate first.
+ * @param count Output: number of entries.
+ */
+const dsp_two_stage_config *dsp_two_stage_configs(unsigned int *count);
+
+/**
+ * @brief Returns the configuration for an input rate and output sps, or NULL.
+ */
+const dsp_two_stage_config *dsp_two_stage_find(double input_rate, unsigned int sps = 1);
+
+/**
+ * @brief Coefficient multiply-accumulates per output sample of a configuration.
+ * @param folded true for the block kernels (symmetric Stage 1 folded).
+ */
+double dsp_two_stage_macs(const dsp_two_stage_config *cfg, bool folded);
+
+/**
+ * @class dsp_two_stage_engine
+ * @brief Runtime interface of the dsp_two_stage instantiations.
+ */
+class dsp_two_stage_engine {
+public:
+	virtual ~dsp_two_stage_engine() {}
+
+	/**
+	 * @brief Creates the engine compiled for an input rate and output sps.
+	 * @return Engine, or NULL if no configuration matches.
+	 * @throws std::bad_alloc if allocation fails.
+	 */
+	static dsp_two_stage_engine *create(double input_rate, unsigned int sps = 1);
+
+	/** @brief Clears the filter history and phase state. */
+	virtual void reset() = 0;
+
+	/**
+	 * @brief Sets the block kernel table.
+	 * @param kernels Kernel table, or NULL for the per-sample reference path.
+	 */
+	virtual void set_kernels(const dsp_kernels *kernels) = 0;
+
+	/** @brief See dsp_resampler::process(). */
+	virtual size_t process(const std::complex<float> *in, size_t in_count,
+			       std::complex<float> *out_buffer, size_t out_cap) = 0;
+
+	/** @brief See dsp_resampler::process_int16(). */
+	virtual size_t process_int16(const int16_t *in_iq, size_t in_count,
+				     std::complex<float> *out_buffer, size_t out_cap) = 0;
+
+	/** @brief See dsp_resampler::process_stage2(). */
+	virtual size_t process_stage2(const std::complex<float> *in, size_t in_count,
+				      std::complex<float> *out_buffer, size_t out_cap) = 0;
+
+	/** @brief See dsp_resampler::macs_per_output(). */
+	virtual double macs_per_output() const = 0;
+
+	/** @brief See dsp_resampler::warmup_outputs(). */
+	virtual unsigned int warmup_outputs() const = 0;
+
+	/** @brief The configuration this engine was compiled for. */
+	virtual const dsp_two_stage_config *config() const = 0;
+
+	/** @brief Aligned allocation (see dsp_resampler::operator new). */
+	static void* operator new(size_t size) {
+		void* ptr = aligned_malloc(size, DEFAULT_ALIGNMENT);
+		if (!ptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+
+	/** @brief Aligned deallocation. */
+	static void operator delete(void* ptr) noexcept {
+		aligned_free(ptr);
+	}
+};
+
+/**
+ * @class dsp_two_stage
+ * @brief Stage 1 decimator + Stage 2 polyphase resampler for fixed ratios.
+ *
+ * @tparam DECIM1  Stage 1 decimation factor.
+ * @tparam TAPS1   Stage 1 FIR taps (odd: the filter is linear phase).
+ * @tparam INTERP2 Stage 2 interpolation factor (= polyphase branches).
+ * @tparam DECIM2  Stage 2 decimation factor.
+ * @tparam TAPS2   Stage 2 taps per branch.
+ *
+ * Two processing paths share the same filters:
+ * - Reference: per-sample push_stage1()/push_stage2() on interleaved data
+ * - Block: a whole transfer is deinterleaved into split I/Q arrays and
+ *   filtered with the runtime-dispatched kernels from dsp_simd.h, using
+ *   the symmetry of the Stage 1 filter to halve its multiplies
+ */
+template <int DECIM1, int TAPS1, int INTERP2, int DECIM2, int TAPS2>
+class dsp_two_stage : public dsp_two_stage_engine {
+public:
+	/** @brief Folded Stage 1 coefficient count, padded to 8 floats. */
+	static const int FOLD1 = (((TAPS1 + 1) / 2) + 7) & ~7;
+
+	/** @brief Maximum Stage 1 outputs per input block. */
+	static const int BLOCK2 = S1_BLOCK / DECIM1 + 1;
+
+	/**
+	 * @param cfg       Matching configuration (kept by pointer).
+	 * @param s1_coeffs Stage 1 prototype (TAPS1 coefficients, DC gain 1).
+	 * @param s2_proto  Stage 2 prototype (up to INTERP2 * TAPS2
+	 *                  coefficients, DC gain INTERP2).
+	 * @param s2_len    Number of s2_proto coefficients.
+	 */
+	dsp_two_stage(const dsp_two_stage_config *cfg, const float *s1_coeffs,
+		      const float *s2_proto, int s2_len);
+
+	void reset();
+	void set_kernels(const dsp_kernels *kernels) { m_kernels = kernels; }
+
+	size_t process(const std::complex<float> *in, size_t in_count,
+		       std::complex<float> *out_buffer, size_t out_cap);
+	size_t process_int16(const int16_t *in_iq, size_t in_count,
+			     std::complex<float> *out_buffer, size_t out_cap);
+	size_t process_stage2(const std::complex<float> *in, size_t in_count,
+			      std::complex<float> *out_buffer, size_t out_cap);
+
+	double macs_per_output() const { return dsp_two_stage_macs(m_cfg, m_kernels != NULL); }
+	unsigned int warmup_outputs() const;
+	const dsp_two_stage_config *config() const { return m_cfg; }
+
+private:
+	const dsp_two_stage_config *m_cfg;
+
+	/** @brief Kernel table (NULL = reference path). */
+	const dsp_kernels *m_kernels;
+
+	/*
+	 * Stage 1 State (Decimator)
+	 */
+
+	/** @brief Decimation counter (0 to DECIM1-1). */
+	int s1_index;
+
+	/**
+	 * @brief Double-sized history buffer for linear convolution.
+	 *
+	 * Samples are written at both [head] and [head + TAPS1] to enable
+	 * contiguous memory access during convolution without modulo operations.
+	 */
+	alignas(64) std::complex<float> s1_history[2 * TAPS1];
+
+	/** @brief Pre-reversed coefficients for forward-scan vectorization. */
+	alignas(64) float s1_coeffs_rev[TAPS1];
+
+	/** @brief Write position in history buffer. */
+	int s1_head;
+
+	/*
+	 * Stage 2 State (Polyphase Resampler)
+	 */
+
+	/**
+	 * @brief Polyphase filter banks (coefficients pre-reversed).
+	 *
+	 * Organized as [phase][tap] for cache-friendly access during
+	 * the polyphase convolution inner loop.
+	 */
+	alignas(64) float s2_coeffs_poly[INTERP2][TAPS2];
+
+	/** @brief Double-sized history buffer (same technique as Stage 1). */
+	alignas(64) std::complex<float> s2_history[2 * TAPS2];
+
+	/** @brief Write position in Stage 2 history buffer. */
+	int s2_head;
+
+	/** @brief Current polyphase phase accumulator. */
+	int s2_phase_state;
+
+	/*
+	 * Block Path State (split I/Q)
+	 */
+
+	/**
+	 * @brief Stage 1 input, deinterleaved.
+	 *
+	 * The first TAPS1 - 1 entries carry the tail of the previous
+	 * block, so every output window is contiguous.
+	 */
+	alignas(64) float b1_re[TAPS1 - 1 + S1_BLOCK];
+	alignas(64) float b1_im[TAPS1 - 1 + S1_BLOCK];
+
+	/** @brief Folded S1 coefficients (centre tap halved, zero padded). */
+	alignas(64) float s1_coeffs_fold[FOLD1];
+
+	/** @brief Folded S1 coefficients pre-scaled by INT16_IQ_SCALE. */
+	alignas(64) float s1_coeffs_fold_i16[FOLD1];
+
+	/** @brief Stage 2 input (Stage 1 output) with S2 history prefix. */
+	alignas(64) float b2_re[TAPS2 - 1 + BLOCK2];
+	alignas(64) float b2_im[TAPS2 - 1 + BLOCK2];
+
+	/** @brief Block path implementation of process()/process_int16(). */
+	template <typename T>
+	size_t process_block(const T *in_iq, size_t in_count,
+			     std::complex<float> *out_buffer, size_t out_cap,
+			     const float *fold);
+
+	/**
+	 * @brief Block path Stage 2 over b2 (n1 new samples after the history).
+	 * @return false if out_buffer filled up (the rest of the block's
+	 *         outputs are dropped, the phase still walks the whole block).
+	 */
+	inline bool block_stage2(int n1, std::complex<float> *out_buffer,
+				 size_t out_cap, size_t &out_produced);
+
+	/** @brief Processes one input sample through Stage 1. */
+	inline void push_stage1(std::complex<float> sample,
+				std::complex<float> *out_buffer,
+				size_t out_cap, size_t &out_produced);
+
+	/** @brief Processes one sample through the Stage 2 polyphase resampler. */
+	inline void push_stage2(std::complex<float> sample,
+				std::complex<float> *out_buffer,
+				size_t out_cap, size_t &out_produced);
+};
+
+#endif /* __DSP_TWO_STAGE_H__ */
@@ -1,6 +1,6 @@
 /**
  * @file fcch_detector.cc
- * @brief Implementation of the FCCH Detector using FFTW.
+ * @brief Implementation of the FCCH Detector using single-precision FFTW.
  *
  * @author Joshua Lackey (original)
  * @author Benjamin Vernoux <bvernoux@hydrasdr.com> (improvements)
@@ -15,12 +15,95 @@
 #include <cstring>
 #include <stdexcept>
 #include <algorithm>
+#include <vector>
 
 #include "fcch_detector.h"
+#include "fft_plan_cache.h"
 #include "kal_globals.h"
+#include "kal_stats.h"
+#include "spsc_buffer.h"
+#include "util.h"
 
-static const char * const fftw_plan_name = ".kal_fftw_plan";
-static const size_t PLAN_BUF_SIZE = 1024;
+/*
+ * The window energy is kept as a running sum in double; it is recomputed
+ * from scratch this often so cancellation error cannot build up after a
+ * strong burst is followed by a quiet stretch.
+ */
+static const unsigned int ENERGY_RESYNC = 1024;
+
+/* Shortest low error region taken as a burst candidate (symbols) */
+static const unsigned int MIN_FB_LEN = 100;
+
+/*
+ * ---------------------------------------------------------------------------
+ * NLMS Workspace
+ * ---------------------------------------------------------------------------
+ */
+
+/* Sub-array alignment in the arena (floats), one cache line */
+static const unsigned int WS_ALIGN = 16;
+
+/*
+ * Scratch for norm_error_block(): split input, window power and error,
+ * carved out of one aligned allocation. A detector only needs it for the
+ * duration of scan() or train(), so every detector on a thread shares the
+ * thread's arena: it grows to the longest buffer scanned there, then
+ * scans and new detectors allocate nothing.
+ */
+struct fcch_workspace {
+	float *base;
+	unsigned int cap;          /* Samples per sub-array */
+	float *re, *im, *energy, *err;
+
+	fcch_workspace() : base(NULL), cap(0), re(NULL), im(NULL), energy(NULL), err(NULL) {}
+	~fcch_workspace() { if (base) aligned_free_impl(base); }
+
+	/* Returns false if the arena cannot hold len samples */
+	bool reserve(unsigned int len) {
+		if (len <= cap)
+			return true;
+
+		const unsigned int n = (len + WS_ALIGN - 1) & ~(WS_ALIGN - 1);
+		float *p = (float *)aligned_alloc_impl(4 * (size_t)n * sizeof(float),
+						       WS_ALIGN * sizeof(float));
+		if (!p) {
+			fprintf(stderr, "error: fcch_detector: cannot allocate %u sample workspace\n", len);
+			return false;
+		}
+		if (base)
+			aligned_free_impl(base);
+		base = p;
+		cap = n;
+		re = p;
+		im = p + n;
+		energy = p + 2 * (size_t)n;
+		err = p + 3 * (size_t)n;
+		return true;
+	}
+};
+
+static thread_local fcch_workspace t_ws;
+
+/* Symbol-rate view of oversampled input for the predictor (see norm_error()) */
+static thread_local std::vector<complex> t_dec;
+
+/* Candidate regions of the current scan_all() */
+static thread_local std::vector<fcch_burst> t_cand;
+
+size_t fcch_detector::workspace_bytes()
+{
+	return 4 * (size_t)t_ws.cap * sizeof(float);
+}
+
+unsigned int fcch_detector::fft_len(double sample_rate)
+{
+	const double sps = sample_rate / GSM_RATE;
+	unsigned int n = FFT_SIZE;
+
+	while (n < FFT_SIZE * sps - 0.5)
+		n <<= 1;
+	return n;
+}
 
 /*
  * ---------------------------------------------------------------------------
@@ -31,110 +114,94 @@ static const size_t PLAN_BUF_SIZE = 1024;
 fcch_detector::fcch_detector(const float sample_rate, const unsigned int D,
 			     const float p, const float G)
 {
-	FILE *plan_fp;
-	char plan_name[PLAN_BUF_SIZE];
-	const char *home;
-
 	m_D = D;
 	m_p = p;
 	m_G = G;
+	m_G0 = G;
 	m_e = 0.0f;
 
 	m_sample_rate = sample_rate;
 	m_fcch_burst_len = (unsigned int)(148.0 * (m_sample_rate / GSM_RATE));
+	m_fft_len = fft_len(m_sample_rate);
+	m_stride = (unsigned int)(m_sample_rate / GSM_RATE + 0.5);
+	if (m_stride < 1)
+		m_stride = 1;
+	m_burst_start = 0;
+	m_peak_mode = FCCH_PEAK_TABLE;
 
 	m_filter_delay = 8;
 	m_w_len = 2 * m_filter_delay + 1;
 
+	/*
+	 * Error a[k] belongs to the window starting at symbol k, whose
+	 * predicted sample is get_delay() symbols on: a low error run
+	 * starts and ends ahead of its burst by about the distance from the
+	 * window centre to that sample (~11 symbols early on the -P fcch
+	 * signals, at every sps).
+	 */
+	m_lead = m_filter_delay + m_D;
+
 	/* Initialize all pointers to NULL for exception-safe cleanup */
-	m_w = NULL;
-	m_x_cb = NULL;
-	m_y_cb = NULL;
-	m_e_cb = NULL;
-	m_in = NULL;
-	m_out = NULL;
+	m_w_re = NULL;
+	m_w_im = NULL;
+	m_fft = NULL;
 	m_plan = NULL;
+	m_batch = NULL;
+	std::fill(m_batch_plan, m_batch_plan + FCCH_BATCH_MAX + 1, (fftwf_plan)NULL);
 
 	try {
-		m_w = new complex[m_w_len];
-		std::fill(m_w, m_w + m_w_len, complex(0.0f, 0.0f));
-
-		m_x_cb = new circular_buffer(8192, sizeof(complex), 0);
-		m_y_cb = new circular_buffer(8192, sizeof(complex), 1);
-		m_e_cb = new circular_buffer(1015808, sizeof(float), 0);
+		m_w_re = new float[m_w_len];
+		m_w_im = new float[m_w_len];
+		std::fill(m_w_re, m_w_re + m_w_len, 0.0f);
+		std::fill(m_w_im, m_w_im + m_w_len, 0.0f);
 	} catch (...) {
-		delete[] m_w;
-		delete m_x_cb;
-		delete m_y_cb;
-		delete m_e_cb;
+		delete[] m_w_re;
+		delete[] m_w_im;
 		throw;
 	}
 
+	m_kernels = dsp_get_kernels(dsp_best_kernel());
+	m_err = NULL;
+	m_err_len = 0;
+
 	/* Initialize edge detection state machine (instance variables) */
 	m_lth_count = 0;
 	m_lth_state = 1;  /* HIGH */
 
-	/* FFTW setup */
-	m_in = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * FFT_SIZE);
-	m_out = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * FFT_SIZE);
-	if ((!m_in) || (!m_out)) {
-		delete[] m_w;
-		delete m_x_cb;
-		delete m_y_cb;
-		delete m_e_cb;
-		if (m_in) fftw_free(m_in);
-		if (m_out) fftw_free(m_out);
-		throw std::runtime_error("fcch_detector: fftw_malloc failed!");
-	}
-
-	/* Try to load existing FFTW wisdom */
-	home = getenv("HOME");
-	if (!home)
-		home = ".";
-
-	snprintf(plan_name, sizeof(plan_name), "%s/%s", home, fftw_plan_name);
-
-	if ((plan_fp = fopen(plan_name, "r"))) {
-		fftw_import_wisdom_from_file(plan_fp);
-		fclose(plan_fp);
-	}
-
-	m_plan = fftw_plan_dft_1d(FFT_SIZE, m_in, m_out, FFTW_FORWARD, FFTW_MEASURE);
-
-	/* Save wisdom for future use */
-	if ((plan_fp = fopen(plan_name, "w"))) {
-		fftw_export_wisdom_to_file(plan_fp);
-		fclose(plan_fp);
+	/* FFTW setup: aligned per-instance buffer, shared in-place plan */
+	m_fft = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * m_fft_len);
+	if (!m_fft) {
+		delete[] m_w_re;
+		delete[] m_w_im;
+		throw std::runtime_error("fcch_detector: fftwf_malloc failed!");
 	}
 
+	m_plan = fft_plan_acquire(m_fft_len, m_fft, m_fft);
 	if (!m_plan) {
-		delete[] m_w;
-		delete m_x_cb;
-		delete m_y_cb;
-		delete m_e_cb;
-		fftw_free(m_in);
-		fftw_free(m_out);
+		delete[] m_w_re;
+		delete[] m_w_im;
+		fftwf_free(m_fft);
 		throw std::runtime_error("fcch_detector: fftw plan failed!");
 	}
 }
 
 fcch_detector::~fcch_detector()
 {
-	if (m_w)
-		delete[] m_w;
-	if (m_x_cb)
-		delete m_x_cb;
-	if (m_y_cb)
-		delete m_y_cb;
-	if (m_e_cb)
-		delete m_e_cb;
+	if (m_w_re)
+		delete[] m_w_re;
+	if (m_w_im)
+		delete[] m_w_im;
 
 	if (m_plan)
-		fftw_destroy_plan(m_plan);
-	if (m_in)
-		fftw_free(m_in);
-	if (m_out)
-		fftw_free(m_out);
+		fft_plan_release(m_plan);
+	if (m_fft)
+		fftwf_free(m_fft);
+	for (unsigned int n = 0; n <= FCCH_BATCH_MAX; n++) {
+		if (m_batch_plan[n])
+			fft_plan_release(m_batch_plan[n]);
+	}
+	if (m_batch)
+		fftwf_free(m_batch);
 }
 
 /*
@@ -189,17 +256,18 @@ static inline float sinc(const float x)
 	return std::sin(x) / x;
 }
 
+/** @brief Sinc interpolation half length; 2 * d + 2 points per sample. */
+static const unsigned int SINC_HALF_LEN = 10;
+static const unsigned int SINC_POINTS = 2 * SINC_HALF_LEN + 2;
+
 static inline complex interpolate_point(const complex *s, const unsigned int s_len,
 					const float s_i)
 {
-	static const unsigned int filter_len = 21;
 	int start, end, i;
-	unsigned int d;
 	complex point(0.0f, 0.0f);
 
-	d = (filter_len - 1) / 2;
-	start = (int)(std::floor(s_i) - d);
-	end = (int)(std::floor(s_i) + d + 1);
+	start = (int)(std::floor(s_i) - SINC_HALF_LEN);
+	end = (int)(std::floor(s_i) + SINC_HALF_LEN + 1);
 
 	if (start < 0)
 		start = 0;
@@ -214,30 +282,82 @@ static inline complex interpolate_point(const complex *s, const unsigned int s_l
 	return point;
 }
 
-static inline float peak_detect(const complex *s, const unsigned int s_len,
-				complex *peak, float *avg_power)
-{
-	unsigned int i;
-	float max = -1.0f, max_i = -1.0f, sample_power, sum_power, early_i, late_i, incr;
-	complex early_p, late_p, cmax;
+/**
+ * Fractional-delay sinc taps for interpolate_point(), one row per
+ * 1/PEAK_TABLE_STEPS bin. Built once on first use (thread-safe static).
+ */
+struct sinc_table {
+	float c[PEAK_TABLE_STEPS][SINC_POINTS];
 
-	sum_power = 0;
-	for (i = 0; i < s_len; i++) {
-		sample_power = std::norm(s[i]);
-		sum_power += sample_power;
-		if (sample_power > max) {
-			max = sample_power;
-			max_i = (float)i;
+	sinc_table()
+	{
+		for (unsigned int q = 0; q < PEAK_TABLE_STEPS; q++) {
+			double frac = (double)q / PEAK_TABLE_STEPS;
+
+			for (unsigned int t = 0; t < SINC_POINTS; t++) {
+				double x = M_PI * ((double)t - SINC_HALF_LEN - frac);
+				c[q][t] = (std::fabs(x) < 0.0001) ? 1.0f : (float)(std::sin(x) / x);
+			}
 		}
 	}
+};
+
+static const sinc_table &get_sinc_table()
+{
+	static const sinc_table table;
+	return table;
+}
+
+/**
+ * Same as interpolate_point() with s_i rounded to the table resolution.
+ * The bisection in peak_detect() only visits multiples of 1/512 bin, so
+ * it lands exactly on table rows.
+ */
+static inline complex interpolate_point_table(const complex *s, const unsigned int s_len,
+					      const float s_i)
+{
+	int base, start, end, i, q;
+	const float *row;
+	complex point(0.0f, 0.0f);
+
+	base = (int)std::floor(s_i);
+	q = (int)lrintf((s_i - (float)base) * PEAK_TABLE_STEPS);
+	if (q >= (int)PEAK_TABLE_STEPS) {
+		base++;
+		q -= PEAK_TABLE_STEPS;
+	}
+	row = get_sinc_table().c[q];
+
+	start = base - (int)SINC_HALF_LEN;
+	end = base + (int)SINC_HALF_LEN + 1;
+
+	if (start < 0)
+		start = 0;
+	if (end > (int)(s_len - 1))
+		end = s_len - 1;
+
+	for (i = start; i <= end; i++)
+		point += s[i] * row[i - (base - (int)SINC_HALF_LEN)];
+
+	return point;
+}
+
+typedef complex (*interpolate_fn)(const complex *, const unsigned int, const float);
+
+/** @brief Bisection on the interpolated spectrum around bin max_i. */
+static inline float peak_bisect(const complex *s, const unsigned int s_len,
+				float max_i, interpolate_fn interp)
+{
+	float early_i, late_i, incr;
+	complex early_p, late_p;
 
 	early_i = (1 <= max_i) ? (max_i - 1) : 0;
 	late_i = (max_i + 1 < s_len) ? (max_i + 1) : s_len - 1;
 
 	incr = 0.5f;
 	while (incr > 1.0f / 1024.0f) {
-		early_p = interpolate_point(s, s_len, early_i);
-		late_p = interpolate_point(s, s_len, late_i);
+		early_p = interp(s, s_len, early_i);
+		late_p = interp(s, s_len, late_i);
 		if (std::norm(early_p) < std::norm(late_p))
 			early_i += incr;
 		else if (std::norm(early_p) > std::norm(late_p))
@@ -248,8 +368,95 @@ static inline float peak_detect(const complex *s, const unsigned int s_len,
 		late_i = early_i + 2.0f;
 	}
 
-	max_i = early_i + 1.0f;
-	cmax = interpolate_point(s, s_len, max_i);
+	return early_i + 1.0f;
+}
+
+/**
+ * @brief Closed-form fractional bin offset from the 3 bins around k.
+ *
+ * Jacobsen's estimator assumes no zero padding. Here only data_len of the
+ * s_len FFT inputs are data, so the neighbours are first de-rotated by the
+ * linear phase of the length-data_len window and the result is scaled by
+ * the slope of the padded Dirichlet kernel D(u) at u = 1 bin:
+ *   delta = R * (D(0) - D(1)) / D'(1)
+ * which reduces to the textbook estimator when data_len == s_len.
+ */
+static inline float peak_closed_form(const complex *s, const unsigned int s_len,
+				     unsigned int data_len, unsigned int k,
+				     fcch_peak_mode mode)
+{
+	float delta = 0.0f;
+
+	if (k == 0 || k + 1 >= s_len)
+		return (float)k;
+
+	if (mode == FCCH_PEAK_JACOBSEN) {
+		const double L = (double)data_len;
+		const double w = M_PI / (double)s_len;
+		const complex rot = std::polar(1.0f, (float)(w * (L - 1.0)));
+		complex lo = s[k - 1] * std::conj(rot);
+		complex hi = s[k + 1] * rot;
+		complex den = 2.0f * s[k] - lo - hi;
+
+		/* D(u) = sin(w L u) / sin(w u), D(0) = L */
+		double d1 = std::sin(w * L) / std::sin(w);
+		double dd1 = w * (L * std::cos(w * L) * std::sin(w) - std::sin(w * L) * std::cos(w)) /
+			     (std::sin(w) * std::sin(w));
+
+		if (std::norm(den) > 0.0f && dd1 != 0.0)
+			delta = (float)(((lo - hi) / den).real() * (L - d1) / dd1);
+	} else {
+		float a = std::abs(s[k - 1]);
+		float b = std::abs(s[k]);
+		float c = std::abs(s[k + 1]);
+		float den = a - 2.0f * b + c;
+		if (den < 0.0f)
+			delta = 0.5f * (a - c) / den;
+	}
+
+	/* k is the largest bin, so the peak is within half a bin of it */
+	if (delta > 0.5f)
+		delta = 0.5f;
+	else if (delta < -0.5f)
+		delta = -0.5f;
+	else if (delta != delta)
+		delta = 0.0f;
+
+	return (float)k + delta;
+}
+
+static inline float peak_detect(const complex *s, const unsigned int s_len,
+				unsigned int data_len, fcch_peak_mode mode,
+				complex *peak, float *avg_power)
+{
+	unsigned int i, max_k = 0;
+	float max = -1.0f, max_i, sample_power, sum_power;
+	complex cmax;
+
+	sum_power = 0;
+	for (i = 0; i < s_len; i++) {
+		sample_power = std::norm(s[i]);
+		sum_power += sample_power;
+		if (sample_power > max) {
+			max = sample_power;
+			max_k = i;
+		}
+	}
+
+	switch (mode) {
+	case FCCH_PEAK_SINC:
+		max_i = peak_bisect(s, s_len, (float)max_k, interpolate_point);
+		cmax = interpolate_point(s, s_len, max_i);
+		break;
+	case FCCH_PEAK_TABLE:
+		max_i = peak_bisect(s, s_len, (float)max_k, interpolate_point_table);
+		cmax = interpolate_point_table(s, s_len, max_i);
+		break;
+	default:
+		max_i = peak_closed_form(s, s_len, data_len, max_k, mode);
+		cmax = interpolate_point_table(s, s_len, max_i);
+		break;
+	}
 
 	if (peak)
 		*peak = cmax;
@@ -271,34 +478,149 @@ static inline float itof(float index, float sample_rate, unsigned int fft_size)
  * ---------------------------------------------------------------------------
  */
 
+static const char * const peak_mode_names[FCCH_PEAK_COUNT] = {
+	"sinc", "table", "parabolic", "jacobsen"
+};
+
+const char *fcch_peak_mode_name(fcch_peak_mode mode)
+{
+	if (mode < 0 || mode >= FCCH_PEAK_COUNT)
+		return "unknown";
+	return peak_mode_names[mode];
+}
+
+int str_to_peak_mode(const char *s)
+{
+	for (int i = 0; i < FCCH_PEAK_COUNT; i++) {
+		if (!strcmp(s, peak_mode_names[i]))
+			return i;
+	}
+	return -1;
+}
+
+void fcch_detector::set_peak_mode(fcch_peak_mode mode)
+{
+	m_peak_mode = mode;
+}
+
 float fcch_detector::freq_detect(const complex *s, const unsigned int s_len, float *pm)
 {
-	unsigned int i, len;
+	unsigned int len;
 	float max_i, avg_power;
-	complex fft[FFT_SIZE], peak;
+	complex peak;
+
+	len = (s_len < m_fft_len) ? s_len : m_fft_len;
+
+	/*
+	 * Bursts are at most 148 samples, so the input is always zero
+	 * padded into the aligned buffer; fftwf_complex and complex share
+	 * the same layout.
+	 */
+	memcpy(m_fft, s, len * sizeof(complex));
+	memset(m_fft + len, 0, (m_fft_len - len) * sizeof(fftwf_complex));
+
+	fftwf_execute_dft(m_plan, m_fft, m_fft);
+	g_stats.fcch_ffts.fetch_add(1, std::memory_order_relaxed);
 
-	len = (s_len < FFT_SIZE) ? s_len : FFT_SIZE;
+	max_i = peak_detect((const complex *)m_fft, m_fft_len, len, m_peak_mode,
+			    &peak, &avg_power);
+	if (pm)
+		*pm = std::norm(peak) / avg_power;
 
-	for (i = 0; i < len; i++) {
-		m_in[i][0] = s[i].real();
-		m_in[i][1] = s[i].imag();
+	return itof(max_i, m_sample_rate, m_fft_len);
+}
+
+void fcch_detector::freq_detect_batch(const complex *s, fcch_burst *c, const unsigned int n)
+{
+	unsigned int j, len;
+	float max_i, avg_power;
+	complex peak;
+	fftwf_complex *row;
+
+	if (n > 1 && !m_batch) {
+		m_batch = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * m_fft_len *
+							FCCH_BATCH_MAX);
 	}
-	for (i = len; i < FFT_SIZE; i++) {
-		m_in[i][0] = 0;
-		m_in[i][1] = 0;
+	if (n > 1 && m_batch && !m_batch_plan[n])
+		m_batch_plan[n] = fft_plan_acquire_many(m_fft_len, n, m_batch, m_batch);
+
+	if (n == 1 || !m_batch_plan[n]) {
+		for (j = 0; j < n; j++) {
+			len = std::min(c[j].end - c[j].start, m_fcch_burst_len);
+			c[j].offset = freq_detect(s + c[j].start, len, &c[j].pm);
+		}
+		return;
 	}
 
-	fftw_execute(m_plan);
+	for (j = 0; j < n; j++) {
+		row = m_batch + (size_t)j * m_fft_len;
+		len = std::min(c[j].end - c[j].start, m_fcch_burst_len);
+		memcpy(row, s + c[j].start, len * sizeof(complex));
+		memset(row + len, 0, (m_fft_len - len) * sizeof(fftwf_complex));
+	}
 
-	for (i = 0; i < FFT_SIZE; i++) {
-		fft[i] = complex((float)m_out[i][0], (float)m_out[i][1]);
+	fftwf_execute_dft(m_batch_plan[n], m_batch, m_batch);
+	g_stats.fcch_ffts.fetch_add(n, std::memory_order_relaxed);
+	g_stats.fcch_batches.fetch_add(1, std::memory_order_relaxed);
+
+	for (j = 0; j < n; j++) {
+		row = m_batch + (size_t)j * m_fft_len;
+		len = std::min(c[j].end - c[j].start, m_fcch_burst_len);
+		max_i = peak_detect((const complex *)row, m_fft_len, len, m_peak_mode,
+				    &peak, &avg_power);
+		c[j].pm = std::norm(peak) / avg_power;
+		c[j].offset = itof(max_i, m_sample_rate, m_fft_len);
 	}
+}
 
-	max_i = peak_detect(fft, FFT_SIZE, &peak, &avg_power);
-	if (pm)
-		*pm = std::norm(peak) / avg_power;
+/*
+ * ---------------------------------------------------------------------------
+ * Pre-detector
+ * ---------------------------------------------------------------------------
+ */
+
+bool fcch_detector::prescreen(const complex *s, const unsigned int s_len)
+{
+	/* Whole blocks inside any burst, whatever its alignment */
+	const unsigned int W = (148 - FCCH_PRE_BLOCK + 1) / FCCH_PRE_BLOCK;
+	const unsigned int n = s_len / m_stride;
+	/* Lag-1 phase of the FCCH tone (+-pi/2 at GSM_RATE / 4) and its spread */
+	const double w0 = M_PI / 2.0;
+	const double w_max = 2.0 * M_PI * FCCH_OFFSET_MAX / GSM_RATE;
+	std::complex<double> r_blk[W], R(0.0, 0.0);
+	double e_blk[W], E = 0.0;
+	bool pass = false;
+
+	g_stats.fcch_prescreens.fetch_add(1, std::memory_order_relaxed);
+	std::fill(r_blk, r_blk + W, std::complex<double>(0.0, 0.0));
+	std::fill(e_blk, e_blk + W, 0.0);
+
+	for (unsigned int k = 0; (k + 1) * FCCH_PRE_BLOCK < n; k++) {
+		complex r(0.0f, 0.0f);
+		float e = 0.0f;
+
+		for (unsigned int i = k * FCCH_PRE_BLOCK + 1; i <= (k + 1) * FCCH_PRE_BLOCK; i++) {
+			const complex x = s[(size_t)i * m_stride];
+			r += x * std::conj(s[(size_t)(i - 1) * m_stride]);
+			e += std::norm(x);
+		}
+
+		/* Window of the last W blocks */
+		R += std::complex<double>(r) - r_blk[k % W];
+		E += (double)e - e_blk[k % W];
+		r_blk[k % W] = r;
+		e_blk[k % W] = e;
 
-	return itof(max_i, m_sample_rate, FFT_SIZE);
+		if (k + 1 >= W && E > 0.0 && std::abs(R) >= FCCH_PRE_MIN_COHERENCE * E &&
+		    fabs(std::arg(R) - w0) < w_max) {
+			pass = true;
+			break;
+		}
+	}
+
+	if (pass)
+		g_stats.fcch_prescreened.fetch_add(1, std::memory_order_relaxed);
+	return pass;
 }
 
 /*
@@ -307,6 +629,37 @@ float fcch_detector::freq_detect(const complex *s, const unsigned int s_len, flo
  * ---------------------------------------------------------------------------
  */
 
+double fcch_detector::error_limit(const complex *s, const unsigned int s_len,
+				  unsigned int *consumed)
+{
+	double sum, limit;
+
+	/* Calculate the error for each symbol */
+	sum = norm_error(s, s_len);
+
+	/*
+	 * Without a burst, keep the tail that could hold the start of one
+	 * (plus the predictor delay) so a caller sliding over a stream sees
+	 * it whole in the next window.
+	 */
+	if (consumed) {
+		const unsigned int keep = m_fcch_burst_len + get_delay() * m_stride;
+		*consumed = (s_len > keep) ? s_len - keep : s_len;
+	}
+
+	if (m_err_len == 0)
+		return 0.0;
+
+	/* Calculate average error over entire buffer */
+	limit = 0.7 * sum / (double)m_err_len;
+
+	if (g_debug) {
+		printf("debug: error limit: %.1lf\n", limit);
+	}
+
+	return limit;
+}
+
 /**
  * scan:
  *   1. Calculate average error
@@ -317,99 +670,56 @@ float fcch_detector::freq_detect(const complex *s, const unsigned int s_len, flo
 unsigned int fcch_detector::scan(const complex *s, const unsigned int s_len,
 				 float *offset, unsigned int *consumed)
 {
-	/*
-	 * Calculate sps at runtime using instance's sample rate.
-	 */
-	const float sps = m_sample_rate / (float)GSM_RATE;
-	const unsigned int MIN_FB_LEN = (unsigned int)(100 * sps);
-	const unsigned int MIN_PM = 50;
-
-	unsigned int len = 0, t, e_count, i, l_count, y_offset, y_len;
-	float e, *a, loff = 0, pm = 0;
-	double sum = 0.0, avg, limit;
+	unsigned int i, l_count, y_offset = 0, y_len;
+	float loff = 0, pm = 0;
+	double limit;
 	const complex *y;
+	const uint64_t t0 = stats_now_ns();
 
-	/* Batching optimization: Reduce mutex locking overhead */
-	const unsigned int E_BATCH_SIZE = 512;
-	float e_batch[E_BATCH_SIZE];
-	unsigned int e_idx = 0;
-
-	/* Calculate the error for each sample */
-	while (len < s_len) {
-		/* Fill buffer with as much data as possible */
-		t = m_x_cb->write(s + len, s_len - len);
-		len += t;
-
-		/* Process all available data */
-		while (!next_norm_error(&e)) {
-			e_batch[e_idx++] = e;
-			sum += e;
-
-			if (e_idx >= E_BATCH_SIZE) {
-				m_e_cb->write(e_batch, e_idx);
-				e_idx = 0;
-			}
-		}
-	}
-
-	/* Flush remaining errors */
-	if (e_idx > 0) {
-		m_e_cb->write(e_batch, e_idx);
-	}
-
-	if (consumed)
-		*consumed = len;
-
-	/* Calculate average error over entire buffer */
-	a = (float *)m_e_cb->peek(&e_count);
-	if (e_count == 0)
-		return 0;
-
-	avg = sum / (double)e_count;
-	limit = 0.7 * avg;
-
-	if (g_debug) {
-		printf("debug: error limit: %.1lf\n", limit);
-	}
+	limit = error_limit(s, s_len, consumed);
 
 	/* Find neighborhoods where error is smaller than limit */
 	low_to_high_init();
-	for (i = 0; i < e_count; i++) {
-		l_count = low_to_high(a[i], (float)limit);
+	for (i = 0; i < m_err_len; i++) {
+		l_count = low_to_high(m_err[i], (float)limit);
 
-		/* Check if region is long enough for FCCH */
+		/* Check if region is long enough for FCCH (error values are per symbol) */
 		pm = 0;
 		if (l_count >= MIN_FB_LEN) {
-			y_offset = i - l_count;
-			y_len = (l_count < m_fcch_burst_len) ? l_count : m_fcch_burst_len;
-
 			/*
-			 * Note: We use the original input 's' at y_offset.
-			 * This works because len == s_len after the while loop,
-			 * so s[y_offset] corresponds to the error at a[y_offset].
+			 * Error a[k] is computed from the window starting at
+			 * s[k * m_stride], so the low error run leads the burst
+			 * by m_lead symbols: move it onto the burst, then cap
+			 * it to one burst. The FFT takes every sample of 's'.
 			 */
+			y_offset = (i - l_count + m_lead) * m_stride;
+			y_len = (l_count * m_stride < m_fcch_burst_len) ?
+				l_count * m_stride : m_fcch_burst_len;
 			y = s + y_offset;
 
+			g_stats.fcch_regions.fetch_add(1, std::memory_order_relaxed);
 			loff = freq_detect(y, y_len, &pm);
 			if (g_debug)
-				printf("debug: %.0f\t%f\t%f\n", (double)l_count / sps, pm, loff);
+				printf("debug: %u\t%f\t%f\n", l_count, pm, loff);
 
-			if (pm > MIN_PM)
+			if (pm > FCCH_MIN_PM)
 				break;
 		}
 	}
 
-	/* Empty buffers for next call */
-	m_e_cb->flush();
-	m_x_cb->flush();
-	m_y_cb->flush();
-
-	if (pm <= MIN_PM)
+	g_stats.fcch_scan_ns.add(stats_now_ns() - t0);
+	if (pm <= FCCH_MIN_PM)
 		return 0;
+	g_stats.fcch_found.fetch_add(1, std::memory_order_relaxed);
 
 	if (offset)
 		*offset = loff;
 
+	/* The low error region ended at i: resume right after the burst */
+	m_burst_start = y_offset;
+	if (consumed)
+		*consumed = i * m_stride;
+
 	if (g_debug) {
 		printf("debug: fcch_detector finished -----------------------------\n");
 	}
@@ -417,25 +727,277 @@ unsigned int fcch_detector::scan(const complex *s, const unsigned int s_len,
 	return 1;
 }
 
+static bool burst_by_pm(const fcch_burst &a, const fcch_burst &b)
+{
+	return a.pm > b.pm;
+}
+
+static bool burst_by_start(const fcch_burst &a, const fcch_burst &b)
+{
+	return a.start < b.start;
+}
+
+unsigned int fcch_detector::scan_all(const complex *s, const unsigned int s_len,
+				     fcch_burst *bursts, const unsigned int max,
+				     unsigned int *consumed)
+{
+	std::vector<fcch_burst> &c = t_cand;
+	unsigned int i, l_count, n, found = 0;
+	double limit;
+	fcch_burst b;
+	const uint64_t t0 = stats_now_ns();
+
+	limit = error_limit(s, s_len, consumed);
+
+	/* Every neighborhood where error is smaller than limit, long enough for FCCH */
+	c.clear();
+	low_to_high_init();
+	for (i = 0; i < m_err_len; i++) {
+		l_count = low_to_high(m_err[i], (float)limit);
+		if (l_count < MIN_FB_LEN)
+			continue;
+
+		/* Moved onto the burst as in scan() */
+		b.start = (i - l_count + m_lead) * m_stride;
+		b.end = (i + m_lead) * m_stride;
+		b.offset = 0.0f;
+		b.pm = 0.0f;
+		c.push_back(b);
+	}
+	g_stats.fcch_regions.fetch_add(c.size(), std::memory_order_relaxed);
+
+	/* Largest power of two batches first: no padding rows, few plans */
+	for (i = 0; i < c.size(); i += n) {
+		for (n = FCCH_BATCH_MAX; n > c.size() - i; n >>= 1)
+			;
+		freq_detect_batch(s, &c[i], n);
+	}
+
+	for (i = 0; i < c.size(); i++) {
+		if (g_debug)
+			printf("debug: %u\t%f\t%f\n", (c[i].end - c[i].start) / m_stride, c[i].pm, c[i].offset);
+		if (c[i].pm > FCCH_MIN_PM)
+			c[found++] = c[i];
+	}
+	c.resize(found);
+
+	/* More bursts than room: keep the cleanest tones, in buffer order */
+	if (found > max) {
+		std::partial_sort(c.begin(), c.begin() + max, c.end(), burst_by_pm);
+		c.resize(max);
+		std::sort(c.begin(), c.end(), burst_by_start);
+		found = max;
+	}
+
+	g_stats.fcch_scan_ns.add(stats_now_ns() - t0);
+	if (!found)
+		return 0;
+	g_stats.fcch_found.fetch_add(1, std::memory_order_relaxed);
+	g_stats.fcch_bursts.fetch_add(found, std::memory_order_relaxed);
+
+	std::copy(c.begin(), c.end(), bursts);
+
+	/* Resume right after the last burst reported */
+	m_burst_start = c[found - 1].start;
+	if (consumed)
+		*consumed = c[found - 1].end;
+
+	if (g_debug) {
+		printf("debug: fcch_detector finished, %u bursts ----------------------\n", found);
+	}
+
+	return found;
+}
+
+unsigned int fcch_detector::scan(spsc_buffer *cb, float *offset, unsigned int *purged)
+{
+	unsigned int len, consumed = 0, r;
+	const complex *s = (const complex *)cb->peek(&len);
+
+	r = scan(s, len, offset, &consumed);
+	consumed = cb->purge(consumed ? consumed : len);
+	if (purged)
+		*purged = consumed;
+	return r;
+}
+
+unsigned int fcch_detector::scan_all(spsc_buffer *cb, fcch_burst *bursts,
+				     const unsigned int max, unsigned int *purged)
+{
+	unsigned int len, consumed = 0, r;
+	const complex *s = (const complex *)cb->peek(&len);
+
+	r = scan_all(s, len, bursts, max, &consumed);
+	consumed = cb->purge(consumed ? consumed : len);
+	if (purged)
+		*purged = consumed;
+	return r;
+}
+
+unsigned int fcch_detector::track(const complex *s, const unsigned int s_len,
+				  float *offset, float *pm_out)
+{
+	float pm = 0, f;
+
+	g_stats.fcch_tracks.fetch_add(1, std::memory_order_relaxed);
+	f = freq_detect(s, (s_len < m_fcch_burst_len) ? s_len : m_fcch_burst_len, &pm);
+	if (g_debug)
+		printf("debug: track\t%f\t%f\n", pm, f);
+
+	if (pm <= FCCH_MIN_PM)
+		return 0;
+	g_stats.fcch_tracked.fetch_add(1, std::memory_order_relaxed);
+
+	if (offset)
+		*offset = f;
+	if (pm_out)
+		*pm_out = pm;
+	return 1;
+}
+
 /*
  * ---------------------------------------------------------------------------
  * Adaptive Filter (Normalized LMS)
  * ---------------------------------------------------------------------------
  */
 
-int fcch_detector::next_norm_error(float *error)
+void fcch_detector::reset()
 {
-	unsigned int i, n, max;
+	std::fill(m_w_re, m_w_re + m_w_len, 0.0f);
+	std::fill(m_w_im, m_w_im + m_w_len, 0.0f);
+	m_G = m_G0;
+	m_e = 0.0f;
+	m_err_len = 0;
+	low_to_high_init();
+}
+
+void fcch_detector::train(const complex *s, const unsigned int s_len)
+{
+	norm_error(s, s_len);
+	m_err_len = 0;
+}
+
+double fcch_detector::norm_error(const complex *s, const unsigned int s_len)
+{
+	/*
+	 * Oversampled input: predict every m_stride-th sample only. The
+	 * resampler output is band limited to the GSM channel, so this is
+	 * the 1 sps stream the predictor and its thresholds are tuned for,
+	 * at the 1 sps cost; freq_detect() still gets every sample.
+	 */
+	if (m_stride > 1) {
+		const unsigned int n = s_len / m_stride;
+
+		if (t_dec.size() < n)
+			t_dec.resize(n);
+		for (unsigned int i = 0; i < n; i++)
+			t_dec[i] = s[(size_t)i * m_stride];
+		s = n ? &t_dec[0] : s;
+		return m_kernels ? norm_error_block(s, n) : norm_error_reference(s, n);
+	}
+
+	return m_kernels ? norm_error_block(s, s_len) : norm_error_reference(s, s_len);
+}
+
+dsp_kernel_id fcch_detector::set_kernel(dsp_kernel_id id)
+{
+	if (id == DSP_KERNEL_AUTO)
+		id = dsp_best_kernel();
+
+	if (id == DSP_KERNEL_REFERENCE) {
+		m_kernels = NULL;
+	} else {
+		m_kernels = dsp_get_kernels(id);
+		if (!m_kernels) {
+			id = DSP_KERNEL_GENERIC;
+			m_kernels = dsp_get_kernels(id);
+		}
+	}
+
+	return id;
+}
+
+double fcch_detector::norm_error_block(const complex *s, const unsigned int s_len)
+{
+	const unsigned int delay = get_delay();
+	unsigned int i, n_out;
+	double E = 0.0, sum = 0.0;
+	dsp_nlms_state st;
+
+	m_err_len = 0;
+	if (s_len <= delay || !t_ws.reserve(s_len))
+		return 0.0;
+	n_out = s_len - delay;
+
+	float *re = t_ws.re, *im = t_ws.im, *energy = t_ws.energy, *err = t_ws.err;
+
+	for (i = 0; i < s_len; i++) {
+		re[i] = s[i].real();
+		im[i] = s[i].imag();
+	}
+
+	/* Window power: add the newest sample, drop the oldest */
+	for (i = 0; i < n_out; i++) {
+		if (i % ENERGY_RESYNC == 0) {
+			E = 0.0;
+			for (unsigned int k = 0; k < m_w_len; k++)
+				E += (double)std::norm(s[i + k]);
+		} else {
+			E += (double)std::norm(s[i + m_w_len - 1]) -
+			     (double)std::norm(s[i - 1]);
+		}
+		energy[i] = (float)E;
+	}
+
+	st.G = m_G;
+	st.e = m_e;
+	st.p = m_p;
+	m_kernels->nlms_predict(re, im, energy, n_out,
+				m_w_len, m_D, m_w_re, m_w_im, &st, err);
+	m_G = st.G;
+	m_e = st.e;
+
+	for (i = 0; i < n_out; i++)
+		sum += err[i];
+
+	m_err = err;
+	m_err_len = n_out;
+	return sum;
+}
+
+double fcch_detector::norm_error_reference(const complex *s, const unsigned int s_len)
+{
+	double sum = 0.0;
+	float e;
+
+	m_err_len = 0;
+	if (!t_ws.reserve(s_len))
+		return 0.0;
+
+	float *err = t_ws.err;
+	m_err = err;
+
+	/* One window per sample, in place */
+	while (!next_norm_error(s + m_err_len, s_len - m_err_len, &e)) {
+		err[m_err_len++] = e;
+		sum += e;
+	}
+
+	return sum;
+}
+
+int fcch_detector::next_norm_error(const complex *x, const unsigned int x_len, float *error)
+{
+	unsigned int i, n;
 	float E;
-	complex *x, y, e;
+	complex y, e;
 
 	/* n is "current" sample */
 	n = m_w_len - 1;
 
-	/* Ensure there are enough samples in the buffer */
-	x = (complex *)m_x_cb->peek(&max);
-	if (n + m_D >= max)
-		return n + m_D - max + 1;
+	/* Ensure there are enough samples in the window */
+	if (n + m_D >= x_len)
+		return n + m_D - x_len + 1;
 
 	/*
 	 * Update gain (Normalized LMS).
@@ -446,20 +1008,20 @@ int fcch_detector::next_norm_error(float *error)
 		m_G = 1.0f / E;
 	}
 
-	/* Calculate filtered value */
+	/* Calculate filtered value (weights are stored in window order) */
 	y = complex(0.0f, 0.0f);
 	for (i = 0; i < m_w_len; i++)
-		y += std::conj(m_w[i]) * x[n - i];
-
-	/* Store filtered value */
-	m_y_cb->write(x + n + m_D, 1);
+		y += std::conj(complex(m_w_re[i], m_w_im[i])) * x[i];
 
 	/* Calculate error from desired signal */
 	e = x[n + m_D] - y;
 
 	/* Update filters with opposite gradient */
-	for (i = 0; i < m_w_len; i++)
-		m_w[i] += m_G * std::conj(e) * x[n - i];
+	for (i = 0; i < m_w_len; i++) {
+		complex w = m_G * std::conj(e) * x[i];
+		m_w_re[i] += w.real();
+		m_w_im[i] += w.imag();
+	}
 
 	/* Update error average power */
 	E /= m_w_len;
@@ -469,9 +1031,6 @@ int fcch_detector::next_norm_error(float *error)
 	if (error)
 		*error = (E > 1e-20f) ? (m_e / E) : 0.0f;
 
-	/* Remove the processed sample from the buffer */
-	m_x_cb->purge(1);
-
 	return 0;
 }
 
@@ -481,11 +1040,6 @@ int fcch_detector::next_norm_error(float *error)
  * ---------------------------------------------------------------------------
  */
 
-unsigned int fcch_detector::update(const complex *s, const unsigned int s_len)
-{
-	return m_x_cb->write(s, s_len);
-}
-
 unsigned int fcch_detector::get_delay()
 {
 	return m_w_len - 1 + m_D;
@@ -496,27 +1050,9 @@ unsigned int fcch_detector::filter_len()
 	return m_w_len;
 }
 
-complex *fcch_detector::dump_x(unsigned int *x_len)
-{
-	return (complex *)m_x_cb->peek(x_len);
-}
-
-complex *fcch_detector::dump_y(unsigned int *y_len)
-{
-	return (complex *)m_y_cb->peek(y_len);
-}
-
-unsigned int fcch_detector::y_buf_len()
-{
-	return m_y_cb->buf_len();
-}
-
-unsigned int fcch_detector::x_buf_len()
-{
-	return m_x_cb->buf_len();
-}
-
-unsigned int fcch_detector::x_purge(unsigned int len)
+const float *fcch_detector::dump_e(unsigned int *e_len)
 {
-	return m_x_cb->purge(len);
+	if (e_len)
+		*e_len = m_err_len;
+	return m_err;
 }
@@ -16,12 +16,80 @@
 #define __FCCH_DETECTOR_H__
 
 #include <fftw3.h>
-#include "circular_buffer.h"
+#include <stddef.h>
+#include "dsp_simd.h"
 #include "kal_types.h"
 
-/** @brief FFT size for frequency detection. */
+class spsc_buffer;
+
+/** @brief FFT size for frequency detection at 1 sps (see fft_len()). */
 #define FFT_SIZE 1024
 
+/** @brief Peak-to-mean ratio above which a tone is taken as an FCCH burst. */
+#define FCCH_MIN_PM 50
+
+/**
+ * @brief Most candidate regions transformed by one FFT call of
+ *        scan_all(), a power of two (batches of 2, 4, ... are planned).
+ */
+#define FCCH_BATCH_MAX 8
+
+/** @brief Symbols per partial sum of the prescreen() correlator. */
+#define FCCH_PRE_BLOCK 16
+
+/**
+ * @brief Lag-1 coherence |sum x[n] x*[n-1]| / sum |x[n]|^2 above which
+ *        prescreen() passes a window.
+ *
+ * 1 for a clean tone, S/(S+N) with noise (0.5 at 0 dB SNR, where scan()
+ * finds almost nothing already), ~0.1 for GMSK data or white noise.
+ */
+#define FCCH_PRE_MIN_COHERENCE 0.4f
+
+/** @brief Fractional resolution of the sinc interpolation table (1/bin). */
+#define PEAK_TABLE_STEPS 1024
+
+/**
+ * @brief FFT peak refinement methods used by freq_detect().
+ *
+ * Accuracy on 500 synthetic 148-sample FCCH bursts at 20 dB SNR (-B),
+ * as mean / max frequency error:
+ * - sinc:      bisection on 22-point sinc interpolation (1/512 bin steps,
+ *              ~440 std::sin() calls per burst); 6.4 / 26.9 Hz
+ * - table:     same search on a precomputed 1/1024 bin sinc table;
+ *              identical results to sinc
+ * - parabolic: 3-point parabola through |X|; 6.4 / 27.8 Hz,
+ *              within 1.9 Hz of sinc
+ * - jacobsen:  3-point complex estimator corrected for zero padding;
+ *              6.4 / 26.8 Hz, within 1.7 Hz of sinc
+ * The error is dominated by noise, not by the refinement method. One FFT
+ * bin is 264 Hz.
+ */
+enum fcch_peak_mode {
+	FCCH_PEAK_SINC = 0,   /**< Original bisection with std::sin() */
+	FCCH_PEAK_TABLE,      /**< Bisection with a precomputed sinc table */
+	FCCH_PEAK_PARABOLIC,  /**< Parabolic fit on bin magnitudes */
+	FCCH_PEAK_JACOBSEN,   /**< Jacobsen complex 3-bin estimator */
+	FCCH_PEAK_COUNT
+};
+
+/** @brief Returns a printable peak mode name ("sinc", "table", ...). */
+const char *fcch_peak_mode_name(fcch_peak_mode mode);
+
+/**
+ * @brief Parses a peak mode name.
+ * @return Mode identifier, or -1 if the name is unknown.
+ */
+int str_to_peak_mode(const char *s);
+
+/** @brief One FCCH burst found by fcch_detector::scan_all(). */
+struct fcch_burst {
+	float offset;        /**< Tone frequency (Hz), as scan() reports it */
+	float pm;            /**< Peak-to-mean ratio */
+	unsigned int start;  /**< Burst start (buffer index) */
+	unsigned int end;    /**< End of its low error region (buffer index) */
+};
+
 /**
  * @class fcch_detector
  * @brief Detects GSM Frequency Correction Channel bursts.
@@ -29,6 +97,15 @@
  * Uses a Normalized LMS adaptive filter to identify regions of pure tone
  * (low prediction error), then FFT-based peak detection to measure the
  * exact frequency offset.
+ *
+ * scan() runs the predictor over the whole buffer at once with the block
+ * kernel from dsp_simd; next_norm_error() is the per-sample reference.
+ * Both read the caller's samples in place: scanning a ring (see
+ * scan(spsc_buffer *, ...)) copies nothing but the FFT input.
+ *
+ * Oversampled input (sample_rate a multiple of GSM_RATE) is predicted
+ * at one sample per symbol, so detection and its cost match 1 sps, while
+ * the FFT spans every sample of the burst (see fft_len()).
  */
 class fcch_detector {
 public:
@@ -48,19 +125,98 @@ public:
 	 * @param s        Input sample buffer.
 	 * @param s_len    Number of samples in buffer.
 	 * @param offset   Output: detected frequency offset (Hz).
-	 * @param consumed Output: number of samples consumed (may be NULL).
+	 * @param consumed Output: samples that can be dropped before the next
+	 *                 window (may be NULL). Up to the end of the burst if
+	 *                 found, otherwise all but the last burst length, so
+	 *                 overlapping windows of a stream miss no burst.
 	 * @return 1 if FCCH found, 0 otherwise.
 	 */
 	unsigned int scan(const complex *s, const unsigned int s_len,
 			  float *offset, unsigned int *consumed);
 
 	/**
-	 * @brief Updates internal buffers with new samples.
+	 * @brief Scans everything a sample ring holds, in place.
+	 *
+	 * Runs scan() on the ring's contiguous (mirrored) view, then purges
+	 * only what it consumed: the tail that could hold the start of a
+	 * burst stays for the next call, so overlapping windows are never
+	 * scanned twice from the start.
+	 *
+	 * @param cb     Output ring of a sample_source (consumer side).
+	 * @param offset Output: detected frequency offset (Hz).
+	 * @param purged Output: samples purged from the ring (may be NULL).
+	 * @return 1 if FCCH found, 0 otherwise.
+	 */
+	unsigned int scan(spsc_buffer *cb, float *offset, unsigned int *purged);
+
+	/**
+	 * @brief Scans input buffer for every FCCH burst it holds.
+	 *
+	 * Same NLMS pass as scan(), but instead of stopping at the first
+	 * low error region whose tone passes FCCH_MIN_PM, collects all
+	 * regions and transforms them together, FCCH_BATCH_MAX per
+	 * fftwf_execute_dft() call on a batched plan. A 12-frame window
+	 * usually holds two bursts, and scan() always reports the earlier.
+	 *
+	 * @param s        Input sample buffer.
+	 * @param s_len    Number of samples in buffer.
+	 * @param bursts   Output: bursts found, in buffer order.
+	 * @param max      Capacity of bursts; with more bursts than that,
+	 *                 the max with the highest peak-to-mean are kept
+	 *                 (max = 1 picks the best one).
+	 * @param consumed Output: as for scan(), up to the end of the last
+	 *                 burst reported (may be NULL).
+	 * @return Number of bursts stored in bursts.
+	 */
+	unsigned int scan_all(const complex *s, const unsigned int s_len,
+			      fcch_burst *bursts, const unsigned int max,
+			      unsigned int *consumed);
+
+	/** @brief scan_all() on a sample ring, purging like scan(spsc_buffer *, ...). */
+	unsigned int scan_all(spsc_buffer *cb, fcch_burst *bursts, const unsigned int max,
+			      unsigned int *purged);
+
+	/**
+	 * @brief Checks a window predicted to hold an FCCH burst.
+	 *
+	 * Runs freq_detect() and the peak-to-mean test of scan() only, no
+	 * NLMS pass: meant for windows placed from the frame timing of an
+	 * earlier burst (see burst_start()). Filter state is not touched.
+	 *
+	 * @param s      Window samples (at most burst_len()).
+	 * @param s_len  Number of samples.
+	 * @param offset Output: detected frequency offset (Hz).
+	 * @param pm     Output: peak-to-mean ratio of the tone (may be NULL).
+	 * @return 1 if the window holds a tone, 0 otherwise.
+	 */
+	unsigned int track(const complex *s, const unsigned int s_len, float *offset,
+			   float *pm = NULL);
+
+	/**
+	 * @brief Start of the burst found by the last successful scan(), or
+	 *        of the last one reported by scan_all() (buffer index).
+	 */
+	unsigned int burst_start() const { return m_burst_start; }
+
+	/** @brief Expected FCCH burst length (samples). */
+	unsigned int burst_len() const { return m_fcch_burst_len; }
+
+	/**
+	 * @brief Cheap test for an FCCH burst anywhere in a buffer.
+	 *
+	 * Correlates each symbol with the previous one over sliding windows
+	 * of whole FCCH_PRE_BLOCK blocks that fit in one burst. A tone gives
+	 * a coherent sum whose phase is its frequency, so a window passes
+	 * if it is coherent (FCCH_PRE_MIN_COHERENCE) and its frequency is
+	 * within FCCH_OFFSET_MAX of GSM_RATE / 4. One complex multiply per
+	 * symbol, against the NLMS pass of scan() and train(); meant to skip
+	 * both on empty channels. Filter state is not touched.
+	 *
 	 * @param s     Input sample buffer.
 	 * @param s_len Number of samples.
-	 * @return Number of samples written.
+	 * @return true if some window may hold an FCCH burst.
 	 */
-	unsigned int update(const complex *s, const unsigned int s_len);
+	bool prescreen(const complex *s, const unsigned int s_len);
 
 	/**
 	 * @brief Detects frequency of pure tone using FFT.
@@ -72,48 +228,116 @@ public:
 	float freq_detect(const complex *s, const unsigned int s_len, float *pm);
 
 	/**
-	 * @brief Computes next normalized prediction error sample.
+	 * @brief Computes the normalized prediction error of one window.
+	 * @param x     Window start: x[get_delay()] is the predicted sample.
+	 * @param x_len Samples available from x.
 	 * @param error Output: normalized error value.
 	 * @return 0 on success, >0 if more samples needed.
 	 */
-	int next_norm_error(float *error);
+	int next_norm_error(const complex *x, const unsigned int x_len, float *error);
+
+	/**
+	 * @brief Clears the adaptive filter and buffered samples.
+	 *
+	 * scan() normally carries the NLMS weights over from the previous
+	 * buffer. Resetting first makes the result depend only on the
+	 * buffer, e.g. when several detectors share a job queue.
+	 */
+	void reset();
+
+	/**
+	 * @brief Adapts the NLMS filter on a buffer without detecting.
+	 *
+	 * After reset(), the first few hundred errors of a scan are the
+	 * filter converging, which lifts the average error and with it the
+	 * low-error threshold. Training on the same buffer first gives a
+	 * converged filter, as a long-running detector would have.
+	 *
+	 * @param s     Input sample buffer.
+	 * @param s_len Number of samples.
+	 */
+	void train(const complex *s, const unsigned int s_len);
+
+	/**
+	 * @brief Selects the NLMS kernel used by scan().
+	 *
+	 * DSP_KERNEL_AUTO resolves to dsp_best_kernel(), DSP_KERNEL_REFERENCE
+	 * runs next_norm_error() per sample. Unsupported kernels fall back
+	 * to the generic block kernel. Filter state is kept.
+	 *
+	 * @param id Kernel identifier.
+	 * @return The kernel actually selected.
+	 */
+	dsp_kernel_id set_kernel(dsp_kernel_id id);
+
+	/** @brief Selects the FFT peak refinement used by freq_detect(). */
+	void set_peak_mode(fcch_peak_mode mode);
 
-	/** @brief Returns adaptive filter delay. */
+	/** @brief Returns the current FFT peak refinement mode. */
+	fcch_peak_mode peak_mode() const { return m_peak_mode; }
+
+	/** @brief Returns adaptive filter delay (predictor samples, one per symbol). */
 	unsigned int get_delay();
 
 	/** @brief Returns adaptive filter length. */
 	unsigned int filter_len();
 
-	/* Debug helpers */
-	complex *dump_x(unsigned int *x_len);
-	complex *dump_y(unsigned int *y_len);
-	unsigned int y_buf_len();
-	unsigned int x_buf_len();
-	unsigned int x_purge(unsigned int len);
+	/*
+	 * Debug helper: points into the thread's arena, valid until the next
+	 * scan() or train() on that thread.
+	 */
+	const float *dump_e(unsigned int *e_len);
+
+	/** @brief Bytes held by the calling thread's NLMS arena. */
+	static size_t workspace_bytes();
+
+	/**
+	 * @brief FFT length used at a sample rate.
+	 *
+	 * FFT_SIZE scaled with the oversampling (to a power of two), so one
+	 * bin stays ~264 Hz wide and oversampled bursts still fit.
+	 */
+	static unsigned int fft_len(double sample_rate);
 
 private:
 	/* Adaptive filter parameters */
 	unsigned int m_D;         /**< Prediction delay */
 	float m_p;                /**< Error averaging coefficient */
 	float m_G;                /**< Adaptive gain */
+	float m_G0;               /**< Initial adaptive gain (for reset()) */
 	float m_e;                /**< Running error average */
 	float m_sample_rate;      /**< Input sample rate (Hz) */
 	unsigned int m_fcch_burst_len;  /**< Expected FCCH burst length (samples) */
+	unsigned int m_burst_start;     /**< Burst position of the last scan() hit */
+	fcch_peak_mode m_peak_mode;     /**< FFT peak refinement method */
+	unsigned int m_fft_len;         /**< FFT length (see fft_len()) */
+	unsigned int m_stride;          /**< Samples per symbol seen by the predictor */
+	unsigned int m_lead;            /**< Low error run to burst start (symbols) */
 
 	/* Adaptive filter state */
 	unsigned int m_filter_delay;
 	unsigned int m_w_len;
-	complex *m_w;
+	float *m_w_re;            /**< Weights (window order), real part */
+	float *m_w_im;            /**< Weights (window order), imaginary part */
 
-	/* Internal buffers */
-	circular_buffer *m_x_cb;  /**< Input sample buffer */
-	circular_buffer *m_y_cb;  /**< Filtered output buffer */
-	circular_buffer *m_e_cb;  /**< Error signal buffer */
+	/*
+	 * The block NLMS working set (split input, window power, error) lives
+	 * in a per-thread arena shared by every detector on that thread.
+	 */
+	const dsp_kernels *m_kernels;  /**< NULL selects next_norm_error() */
+	const float *m_err;            /**< Error sequence of the last scan (arena) */
+	unsigned int m_err_len;        /**< Valid entries in m_err */
 
 	/* FFTW resources */
-	fftw_complex *m_in;
-	fftw_complex *m_out;
-	fftw_plan m_plan;
+	fftwf_complex *m_fft;     /**< Aligned in-place FFT buffer */
+	fftwf_plan m_plan;        /**< Shared plan from fft_plan_cache */
+
+	/*
+	 * scan_all() batches, allocated on first use: FCCH_BATCH_MAX rows of
+	 * m_fft_len points, and one batched plan per power of two count.
+	 */
+	fftwf_complex *m_batch;
+	fftwf_plan m_batch_plan[FCCH_BATCH_MAX + 1];
 
 	/*
 	 * State machine for low_to_high edge detection.
@@ -133,6 +357,48 @@ private:
 	 * @return Length of previous low region (0 if no transition).
 	 */
 	unsigned int low_to_high(float e, float a);
+
+	/**
+	 * @brief Predictor pass and error threshold shared by scan() and
+	 *        scan_all().
+	 *
+	 * Fills m_err, sets *consumed to the no-burst default and returns
+	 * the low error threshold (0.7 of the average error).
+	 */
+	double error_limit(const complex *s, const unsigned int s_len,
+			   unsigned int *consumed);
+
+	/**
+	 * @brief Measures the tone of n candidate regions of s with one
+	 *        batched FFT (n a power of two up to FCCH_BATCH_MAX).
+	 *
+	 * Fills offset and pm of each candidate. Falls back to freq_detect()
+	 * per region if the batch buffer or plan cannot be set up.
+	 */
+	void freq_detect_batch(const complex *s, fcch_burst *c, const unsigned int n);
+
+	/**
+	 * @brief Runs the block NLMS predictor over a buffer.
+	 *
+	 * Fills m_err with one normalized error per complete window
+	 * (s_len - get_delay() values).
+	 *
+	 * @param s     Input sample buffer.
+	 * @param s_len Number of samples.
+	 * @return Sum of the error sequence.
+	 */
+	double norm_error_block(const complex *s, const unsigned int s_len);
+
+	/** @brief Per-sample reference path for norm_error_block(). */
+	double norm_error_reference(const complex *s, const unsigned int s_len);
+
+	/**
+	 * @brief Predictor pass of scan() and train().
+	 *
+	 * Runs the block or reference path over every m_stride-th sample,
+	 * so m_err holds one value per symbol at any oversampling.
+	 */
+	double norm_error(const complex *s, const unsigned int s_len);
 };
 
 #endif /* __FCCH_DETECTOR_H__ */
@@ -0,0 +1,356 @@
+/**
+ * @file fft_plan_cache.cc
+ * @brief Implementation of the process-wide FFTW plan cache.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#ifdef _WIN32
+#include "win_compat.h"
+#include <process.h>
+#define kal_getpid _getpid
+#else
+#include <unistd.h>
+#define kal_getpid getpid
+#endif
+
+#include "fft_plan_cache.h"
+#include "kal_globals.h"
+
+struct plan_entry {
+	bool dbl;          /* fftw (double) or fftwf (single) */
+	int n;
+	int howmany;       /* transforms per execute (fft_plan_acquire_many()) */
+	bool in_place;
+	void *plan;        /* fftw_plan or fftwf_plan */
+	unsigned int refs;
+};
+
+/* FFTW's planner is not thread-safe: everything below runs under s_mutex */
+static std::mutex s_mutex;
+static std::vector<plan_entry> s_plans;
+static std::string s_path;
+static bool s_path_set = false;
+static bool s_wisdom_loaded = false;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double ms_since(clock_type::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+static void resolve_path_locked()
+{
+	const char *env, *home;
+
+	if (s_path_set)
+		return;
+	s_path_set = true;
+
+	if ((env = getenv(FFT_WISDOM_ENV))) {
+		s_path = env;
+		return;
+	}
+
+	home = getenv("HOME");
+	if (!home)
+		home = ".";
+	s_path = std::string(home) + "/" + FFT_WISDOM_DEFAULT_NAME;
+}
+
+static void load_wisdom_locked()
+{
+	clock_type::time_point t0;
+	int ok;
+
+	if (s_wisdom_loaded)
+		return;
+	s_wisdom_loaded = true;
+
+	resolve_path_locked();
+	if (s_path.empty())
+		return;
+
+	t0 = clock_type::now();
+	ok = fftwf_import_wisdom_from_filename(s_path.c_str());
+	if (g_debug) {
+		printf("debug: FFT wisdom %s '%s' (%.2f ms)\n",
+		       ok ? "loaded from" : "not found at", s_path.c_str(), ms_since(t0));
+	}
+}
+
+/*
+ * Writes to a temporary file next to the target and renames it over the
+ * target, so a reader never sees a partial file and a failed write
+ * (read-only or full filesystem) leaves the old file intact.
+ */
+static int save_wisdom_locked()
+{
+	std::string tmp;
+	char suffix[32];
+
+	if (s_path.empty())
+		return 0;
+
+	snprintf(suffix, sizeof(suffix), ".tmp.%ld", (long)kal_getpid());
+	tmp = s_path + suffix;
+
+	if (!fftwf_export_wisdom_to_filename(tmp.c_str())) {
+		remove(tmp.c_str());
+		if (g_debug)
+			printf("debug: FFT wisdom not saved: cannot write '%s'\n", tmp.c_str());
+		return -1;
+	}
+
+#ifdef _WIN32
+	if (!MoveFileExA(tmp.c_str(), s_path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+	if (rename(tmp.c_str(), s_path.c_str())) {
+#endif
+		remove(tmp.c_str());
+		if (g_debug)
+			printf("debug: FFT wisdom not saved: cannot replace '%s'\n", s_path.c_str());
+		return -1;
+	}
+
+	if (g_debug)
+		printf("debug: FFT wisdom saved to '%s'\n", s_path.c_str());
+	return 0;
+}
+
+static void *find_locked(bool dbl, int n, int howmany, bool in_place)
+{
+	for (size_t i = 0; i < s_plans.size(); i++) {
+		plan_entry &e = s_plans[i];
+		if (e.dbl == dbl && e.n == n && e.howmany == howmany && e.in_place == in_place) {
+			e.refs++;
+			return e.plan;
+		}
+	}
+	return NULL;
+}
+
+static void insert_locked(bool dbl, int n, int howmany, bool in_place, void *plan)
+{
+	plan_entry e;
+
+	e.dbl = dbl;
+	e.n = n;
+	e.howmany = howmany;
+	e.in_place = in_place;
+	e.plan = plan;
+	e.refs = 1;
+	s_plans.push_back(e);
+}
+
+/** @returns true if the entry was found; destroyed is set on the last ref. */
+static bool release_locked(void *plan, bool *destroyed)
+{
+	*destroyed = false;
+	for (size_t i = 0; i < s_plans.size(); i++) {
+		if (s_plans[i].plan != plan)
+			continue;
+		if (--s_plans[i].refs == 0) {
+			s_plans.erase(s_plans.begin() + i);
+			*destroyed = true;
+		}
+		return true;
+	}
+	return false;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------------
+ */
+
+void fft_wisdom_set_path(const char *path)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (!path) {
+		s_path_set = false;
+		s_path.clear();
+		return;
+	}
+	s_path = path;
+	s_path_set = true;
+}
+
+const char *fft_wisdom_path()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	resolve_path_locked();
+	return s_path.c_str();
+}
+
+/*
+ * Plans howmany contiguous transforms of n points (distance n, stride 1);
+ * howmany == 1 is the plain 1-D plan.
+ */
+static fftwf_plan plan_float(int n, int howmany, fftwf_complex *in, fftwf_complex *out,
+			     unsigned int flags)
+{
+	if (howmany == 1)
+		return fftwf_plan_dft_1d(n, in, out, FFTW_FORWARD, flags);
+	return fftwf_plan_many_dft(1, &n, howmany, in, NULL, 1, n, out, NULL, 1, n,
+				   FFTW_FORWARD, flags);
+}
+
+fftwf_plan fft_plan_acquire_many(int n, int howmany, fftwf_complex *in, fftwf_complex *out)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const bool in_place = (in == out);
+	const bool measure = ((long)n * howmany <= FFT_MEASURE_MAX);
+	clock_type::time_point t0;
+	fftwf_plan p;
+	bool measured = false;
+
+	if ((p = (fftwf_plan)find_locked(false, n, howmany, in_place)))
+		return p;
+
+	t0 = clock_type::now();
+	if (measure) {
+		load_wisdom_locked();
+		p = plan_float(n, howmany, in, out, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+		if (!p) {
+			p = plan_float(n, howmany, in, out, FFTW_MEASURE);
+			measured = true;
+		}
+	} else {
+		p = plan_float(n, howmany, in, out, FFTW_ESTIMATE);
+	}
+
+	if (g_debug) {
+		char batch[32] = "";
+
+		if (howmany > 1)
+			snprintf(batch, sizeof(batch), " x%d", howmany);
+		printf("debug: FFT plan n=%d%s float%s: %s, %.2f ms\n", n, batch,
+		       in_place ? " in-place" : "",
+		       !measure ? "estimated" : (measured ? "measured" : "from wisdom"),
+		       ms_since(t0));
+	}
+
+	if (!p)
+		return NULL;
+
+	if (measured)
+		save_wisdom_locked();
+
+	insert_locked(false, n, howmany, in_place, p);
+	return p;
+}
+
+fftwf_plan fft_plan_acquire(int n, fftwf_complex *in, fftwf_complex *out)
+{
+	return fft_plan_acquire_many(n, 1, in, out);
+}
+
+fftw_plan fft_plan_acquire(int n, fftw_complex *in, fftw_complex *out)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const bool in_place = (in == out);
+	clock_type::time_point t0;
+	fftw_plan p;
+
+	if ((p = (fftw_plan)find_locked(true, n, 1, in_place)))
+		return p;
+
+	t0 = clock_type::now();
+	p = fftw_plan_dft_1d(n, in, out, FFTW_FORWARD, FFTW_ESTIMATE);
+
+	if (g_debug) {
+		printf("debug: FFT plan n=%d double%s: estimated, %.2f ms\n", n,
+		       in_place ? " in-place" : "", ms_since(t0));
+	}
+
+	if (!p)
+		return NULL;
+
+	insert_locked(true, n, 1, in_place, p);
+	return p;
+}
+
+void fft_plan_release(fftwf_plan p)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	bool destroyed;
+
+	if (p && release_locked(p, &destroyed) && destroyed)
+		fftwf_destroy_plan(p);
+}
+
+void fft_plan_release(fftw_plan p)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	bool destroyed;
+
+	if (p && release_locked(p, &destroyed) && destroyed)
+		fftw_destroy_plan(p);
+}
+
+int fft_wisdom_generate(const int *sizes, const int *howmany, unsigned int count)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	clock_type::time_point t0;
+	fftwf_complex *buf;
+	fftwf_plan p;
+	int r = 0;
+
+	load_wisdom_locked();
+	if (s_path.empty()) {
+		fprintf(stderr, "error: FFT wisdom file is disabled (empty path)\n");
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		const int m = howmany ? howmany[i] : 1;
+		char batch[32] = "";
+
+		if (m > 1)
+			snprintf(batch, sizeof(batch), " x%d", m);
+
+		buf = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * sizes[i] * m);
+		if (!buf) {
+			fprintf(stderr, "error: FFT wisdom: cannot allocate %d%s points\n", sizes[i], batch);
+			return -1;
+		}
+
+		t0 = clock_type::now();
+		p = plan_float(sizes[i], m, buf, buf, FFTW_PATIENT);
+		if (p) {
+			printf("FFT wisdom: n=%d%s planned in %.1f ms\n", sizes[i], batch, ms_since(t0));
+			fftwf_destroy_plan(p);
+		} else {
+			fprintf(stderr, "error: FFT wisdom: planning n=%d%s failed\n", sizes[i], batch);
+			r = -1;
+		}
+		fftwf_free(buf);
+	}
+
+	if (save_wisdom_locked()) {
+		fprintf(stderr, "error: cannot write FFT wisdom to '%s'\n", s_path.c_str());
+		return -1;
+	}
+
+	printf("FFT wisdom written to '%s'\n", s_path.c_str());
+	return r;
+}
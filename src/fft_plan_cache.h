@@ -0,0 +1,116 @@
+/**
+ * @file fft_plan_cache.h
+ * @brief Process-wide FFTW plan cache and wisdom file handling.
+ *
+ * Every FFT in kal (FCCH detector, ASCII spectrum, benchmark) gets its
+ * plan from here. Plans are keyed by precision, size, batch count and
+ * placement (in-place or not), shared by reference count and executed with the new
+ * array interface (fftwf_execute_dft()), which is thread-safe. Buffers
+ * passed to the execute calls must come from fftw_malloc()/fftwf_malloc().
+ *
+ * Single precision plans up to FFT_MEASURE_MAX points (all transforms of
+ * a batch together) are created with
+ * FFTW_MEASURE and backed by a wisdom file. Larger plans and double
+ * precision plans (display only) use FFTW_ESTIMATE and need no wisdom.
+ *
+ * Wisdom file location, first match wins:
+ * - fft_wisdom_set_path() (command line -F)
+ * - KAL_FFTW_WISDOM environment variable
+ * - $HOME/.kal_fftw_plan
+ * An empty path disables reading and writing wisdom.
+ *
+ * The file is read once per process and rewritten (atomically, through a
+ * temporary file and rename) only when a plan had to be measured because
+ * the wisdom did not cover it.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __FFT_PLAN_CACHE_H__
+#define __FFT_PLAN_CACHE_H__
+
+#include <fftw3.h>
+
+/** @brief Name of the default wisdom file in $HOME. */
+#define FFT_WISDOM_DEFAULT_NAME ".kal_fftw_plan"
+
+/** @brief Environment variable overriding the wisdom file path. */
+#define FFT_WISDOM_ENV "KAL_FFTW_WISDOM"
+
+/** @brief Largest single precision size planned with FFTW_MEASURE. */
+#define FFT_MEASURE_MAX 65536
+
+/**
+ * @brief Overrides the wisdom file path (takes precedence over the
+ *        environment). Must be called before the first plan is acquired.
+ * @param path File path, "" to disable wisdom files, NULL for default.
+ */
+void fft_wisdom_set_path(const char *path);
+
+/**
+ * @brief Returns the wisdom file path in use ("" if disabled).
+ */
+const char *fft_wisdom_path();
+
+/**
+ * @brief Returns a shared single precision forward plan.
+ *
+ * in and out are only used for planning (FFTW_MEASURE overwrites them)
+ * and to decide whether the plan is in-place (in == out). Execute with
+ * fftwf_execute_dft() on any arrays of the same placement.
+ *
+ * @param n   Transform size.
+ * @param in  Aligned input buffer of n points.
+ * @param out Aligned output buffer of n points (may equal in).
+ * @return Plan, or NULL on failure. Release with fft_plan_release().
+ */
+fftwf_plan fft_plan_acquire(int n, fftwf_complex *in, fftwf_complex *out);
+
+/**
+ * @brief Returns a shared single precision plan for a batch of transforms.
+ *
+ * One fftwf_execute_dft() call runs howmany transforms of n points laid
+ * out back to back (transform k at in + k * n). Same rules as
+ * fft_plan_acquire(), which is the howmany == 1 case.
+ *
+ * @param n       Transform size.
+ * @param howmany Transforms per call.
+ * @param in      Aligned input buffer of n * howmany points.
+ * @param out     Aligned output buffer of n * howmany points (may equal in).
+ * @return Plan, or NULL on failure. Release with fft_plan_release().
+ */
+fftwf_plan fft_plan_acquire_many(int n, int howmany, fftwf_complex *in, fftwf_complex *out);
+
+/** @brief Double precision variant of fft_plan_acquire() (FFTW_ESTIMATE). */
+fftw_plan fft_plan_acquire(int n, fftw_complex *in, fftw_complex *out);
+
+/** @brief Drops a reference; the plan is destroyed with the last one. */
+void fft_plan_release(fftwf_plan p);
+
+/** @brief Drops a reference on a double precision plan. */
+void fft_plan_release(fftw_plan p);
+
+/**
+ * @brief Pre-generates wisdom (install time).
+ *
+ * Plans each size (single precision, in-place) with FFTW_PATIENT and
+ * writes the wisdom file. Later FFTW_MEASURE planning of those sizes is
+ * then served from the file.
+ *
+ * @param sizes   Transform sizes.
+ * @param howmany Batch count of each entry (see fft_plan_acquire_many()),
+ *                NULL for single transforms.
+ * @param count   Number of entries in sizes (and howmany).
+ * @return 0 on success, -1 if planning failed or the file could not be
+ *         written.
+ */
+int fft_wisdom_generate(const int *sizes, const int *howmany, unsigned int count);
+
+#endif /* __FFT_PLAN_CACHE_H__ */
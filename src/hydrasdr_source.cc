@@ -5,19 +5,9 @@
  * This file implements the hydrasdr_source class, providing:
  * - Hardware initialization and configuration via libhydrasdr
  * - Asynchronous USB sample reception with callback handling
- * - Integrated two-stage DSP resampling (2.5 MSPS → 270.833 kSPS)
- * - Thread-safe producer/consumer buffering
+ * - The optional resampler worker thread and its raw buffer pool
  *
- * @section DSP Pipeline
- *
- * The resampling pipeline converts the native hardware rate to GSM symbol rate:
- *
- * @code
- *   2,500,000 Hz ─▶ [Stage 1: ÷5] ─▶ 500,000 Hz ─▶ [Stage 2: ×13/24] ─▶ 270,833.333 Hz
- *                   (61-tap LPF)                   (729-tap Polyphase)
- * @endcode
- *
- * @see dsp_resampler for filter coefficient details.
+ * Resampling and producer/consumer buffering are in sample_source.
  *
  * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
  * @copyright 2025 Benjamin Vernoux
@@ -46,6 +36,8 @@
 
 #include "hydrasdr_source.h"
 #include "kal_globals.h"
+#include "kal_stats.h"
+#include "thread_util.h"
 
 /**
  * @brief Maximum linearity gain index supported by hardware.
@@ -94,28 +86,31 @@ static int hydrasdr_callback(hydrasdr_transfer_t* transfer)
  * ---------------------------------------------------------------------------
  */
 
-hydrasdr_source::hydrasdr_source(float gain)
+hydrasdr_source::hydrasdr_source(float gain) : sample_source(gain)
 {
-	m_gain = gain;
-
-	/* Target GSM symbol rate: 13 MHz / 48 = 270833.333... Hz */
-	m_sample_rate = 270833.333333;
-	m_center_freq = 0.0;
 	m_freq_corr = 0;
-	m_overflow_count = 0;
-
 	dev = NULL;
-	cb = NULL;
-	streaming = false;
 
-	/* Initialize DSP resampling pipeline */
-	m_resampler = new dsp_resampler();
+	/* A transfer in flight at a retune is followed by the PLL lock */
+	m_settle_samples = HYDRASDR_TUNE_SETTLE_SAMPLES;
+	m_settle_first = true;
+
+	m_int16 = false;
+	m_serial = 0;
+	m_rate_req = 0.0;
+	m_last_callback = 0;
+	m_worker_enabled = false;
+	m_worker_cpu = -1;
+	m_worker_priority = 0;
+	m_worker_exit = false;
+	m_pool = NULL;
+	m_pool_free = NULL;
+	m_pool_filled = NULL;
 }
 
 hydrasdr_source::~hydrasdr_source()
 {
 	close();
-	delete m_resampler;
 }
 
 /*
@@ -131,28 +126,43 @@ hydrasdr_source::~hydrasdr_source()
  */
 int hydrasdr_source::open(void)
 {
+	double rate;
 	int r;
 
-	/* Open first available HydraSDR device */
-	r = hydrasdr_open(&dev);
+	/* Open the selected HydraSDR device, or the first available one */
+	if (m_serial)
+		r = hydrasdr_open_sn(&dev, m_serial);
+	else
+		r = hydrasdr_open(&dev);
 	if (r != HYDRASDR_SUCCESS) {
-		fprintf(stderr, "Failed to open HydraSDR device: %d\n", r);
+		if (m_serial)
+			fprintf(stderr, "Failed to open HydraSDR device 0x%016llX: %d\n",
+				(unsigned long long)m_serial, r);
+		else
+			fprintf(stderr, "Failed to open HydraSDR device: %d\n", r);
 		return -1;
 	}
 
-	/* Configure hardware for Float32 I/Q sample format */
-	r = hydrasdr_set_sample_type(dev, HYDRASDR_SAMPLE_FLOAT32_IQ);
+	/* Configure hardware for Float32 (or packed int16) I/Q sample format */
+	r = hydrasdr_set_sample_type(dev, m_int16 ? HYDRASDR_SAMPLE_INT16_IQ :
+						    HYDRASDR_SAMPLE_FLOAT32_IQ);
 	if (r != HYDRASDR_SUCCESS) {
 		fprintf(stderr, "Failed to set sample type: %d\n", r);
 		goto err_close_dev;
 	}
 
-	/* Set native sample rate (2.5 MSPS) */
-	r = hydrasdr_set_samplerate(dev, HYDRASDR_2_5MSPS_NATIVE_RATE);
+	/* Set the native sample rate and the resampler compiled for it */
+	rate = select_rate();
+	if (rate <= 0.0)
+		goto err_close_dev;
+	r = hydrasdr_set_samplerate(dev, (uint32_t)rate);
 	if (r != HYDRASDR_SUCCESS) {
 		fprintf(stderr, "Failed to set sample rate: %d\n", r);
 		goto err_close_dev;
 	}
+	if (set_input_rate(rate) != 0)
+		goto err_close_dev;
+	m_settle_samples = (size_t)(HYDRASDR_TUNE_SETTLE_SAMPLES * (rate / HYDRASDR_2_5MSPS_NATIVE_RATE));
 
 	/* Apply initial gain setting */
 	if (set_gain(m_gain) != 0) {
@@ -164,12 +174,8 @@ int hydrasdr_source::open(void)
 	 * Allocate circular buffer for producer/consumer handoff.
 	 * Size: 256K samples provides ~0.9 seconds of buffering at GSM rate.
 	 */
-	try {
-		cb = new circular_buffer(256 * 1024, sizeof(complex));
-	} catch (const std::exception& e) {
-		fprintf(stderr, "Failed to allocate circular buffer: %s\n", e.what());
+	if (alloc_ring() != 0)
 		goto err_close_dev;
-	}
 
 	return 0;
 
@@ -179,6 +185,42 @@ err_close_dev:
 	return -1;
 }
 
+double hydrasdr_source::select_rate()
+{
+	std::vector<uint32_t> rates;
+	uint32_t count = 0;
+	double best = 0.0;
+
+	/* Rates the device reports; assume the default one if it reports none */
+	if (hydrasdr_get_samplerates(dev, &count, 0) == HYDRASDR_SUCCESS && count > 0) {
+		rates.resize(count);
+		if (hydrasdr_get_samplerates(dev, &rates[0], count) != HYDRASDR_SUCCESS)
+			rates.clear();
+	}
+	if (rates.empty())
+		rates.push_back(HYDRASDR_2_5MSPS_NATIVE_RATE);
+
+	for (size_t i = 0; i < rates.size(); i++) {
+		if (!dsp_resampler::supports_rate(rates[i], oversampling()))
+			continue;
+		if (m_rate_req > 0.0) {
+			if (fabs(rates[i] - m_rate_req) < 1.0)
+				return rates[i];
+		} else if (best == 0.0 || dsp_resampler::cost_per_output(rates[i], oversampling()) <
+					  dsp_resampler::cost_per_output(best, oversampling())) {
+			best = rates[i];
+		}
+	}
+
+	if (m_rate_req > 0.0)
+		fprintf(stderr, "Sample rate %.3f MSPS not supported by the device or the resampler\n",
+			m_rate_req / 1e6);
+	else if (best == 0.0)
+		fprintf(stderr, "No device sample rate is supported by the resampler\n");
+
+	return best;
+}
+
 int hydrasdr_source::close()
 {
 	stop();
@@ -188,12 +230,14 @@ int hydrasdr_source::close()
 		dev = NULL;
 	}
 
-	if (cb) {
-		delete cb;
-		cb = NULL;
-	}
+	delete m_pool_free;
+	delete m_pool_filled;
+	aligned_free(m_pool);
+	m_pool_free = NULL;
+	m_pool_filled = NULL;
+	m_pool = NULL;
 
-	return 0;
+	return sample_source::close();
 }
 
 /*
@@ -213,14 +257,7 @@ int hydrasdr_source::tune(double freq)
 		return -1;
 	}
 
-	m_center_freq = freq;
-
-	/*
-	 * IMPORTANT: Reset filter history when retuning.
-	 * This prevents transients from the old frequency from
-	 * contaminating the new signal during filter settling.
-	 */
-	m_resampler->reset();
+	retuned(freq);
 
 	return 0;
 }
@@ -256,14 +293,22 @@ int hydrasdr_source::start()
 	if (!dev)
 		return -1;
 
+	/* Already running: the producer owns the DSP state now */
+	if (streaming.load(std::memory_order_acquire))
+		return 0;
+
 	/* Reset DSP state before streaming begins */
-	m_resampler->reset();
-	m_overflow_count = 0;
+	reset_stream();
+	m_last_callback = 0;
+
+	if (m_worker_enabled && start_worker() != 0)
+		return -1;
 
 	/* Register callback and start USB transfers */
 	int r = hydrasdr_start_rx(dev, hydrasdr_callback, (void*)this);
 	if (r != HYDRASDR_SUCCESS) {
 		fprintf(stderr, "Failed to start RX: %d\n", r);
+		stop_worker();
 		return -1;
 	}
 
@@ -281,8 +326,12 @@ int hydrasdr_source::stop()
 		/* Clear streaming flag (atomic) */
 		streaming.store(false, std::memory_order_release);
 
+		/* No more transfers: let the worker exit */
+		stop_worker();
+
 		/* Wake up any threads waiting in fill() for graceful exit */
-		data_ready.notify_all();
+		if (cb)
+			cb->notify();
 	}
 
 	return 0;
@@ -290,23 +339,93 @@ int hydrasdr_source::stop()
 
 /*
  * ---------------------------------------------------------------------------
- * Benchmark Mode
+ * Worker Pipeline
  * ---------------------------------------------------------------------------
  */
 
-void hydrasdr_source::start_benchmark()
+int hydrasdr_source::set_worker(bool enable, int cpu, int priority)
 {
-	/* Allocate buffer without opening hardware */
-	if (!cb) {
-		cb = new circular_buffer(256 * 1024, sizeof(complex));
+	if (streaming.load(std::memory_order_acquire)) {
+		fprintf(stderr, "Error: cannot change worker mode while streaming\n");
+		return -1;
 	}
 
-	/* Reset DSP pipeline (same as regular start) */
-	m_resampler->reset();
-	m_overflow_count = 0;
+	m_worker_enabled = enable;
+	m_worker_cpu = cpu;
+	m_worker_priority = priority;
 
-	/* Force streaming state to enable callback processing */
-	streaming.store(true, std::memory_order_release);
+	return 0;
+}
+
+int hydrasdr_source::start_worker()
+{
+	if (m_worker.joinable())
+		return 0;
+
+	/* Pool and index queues are allocated once and kept until close() */
+	try {
+		if (!m_pool) {
+			m_pool = (std::complex<float>*)aligned_malloc(
+				(size_t)RAW_POOL_COUNT * RAW_POOL_SAMPLES * sizeof(std::complex<float>));
+			if (!m_pool)
+				throw std::bad_alloc();
+		}
+		if (!m_pool_free)
+			m_pool_free = new spsc_buffer(RAW_POOL_COUNT, sizeof(int));
+		if (!m_pool_filled)
+			m_pool_filled = new spsc_buffer(RAW_POOL_COUNT, sizeof(int));
+	} catch (const std::exception& e) {
+		fprintf(stderr, "Failed to allocate worker buffer pool: %s\n", e.what());
+		return -1;
+	}
+
+	/* No other thread is running: safe to reset both queue ends here */
+	m_pool_filled->flush();
+	m_pool_free->flush();
+	for (int i = 0; i < RAW_POOL_COUNT; i++)
+		m_pool_free->write(&i, 1);
+
+	m_worker_exit.store(false, std::memory_order_release);
+
+	try {
+		m_worker = std::thread(&hydrasdr_source::worker_loop, this);
+	} catch (const std::exception& e) {
+		fprintf(stderr, "Failed to start resampler worker: %s\n", e.what());
+		return -1;
+	}
+
+	return 0;
+}
+
+void hydrasdr_source::stop_worker()
+{
+	if (!m_worker.joinable())
+		return;
+
+	m_worker_exit.store(true, std::memory_order_release);
+	m_pool_filled->notify();
+	m_worker.join();
+}
+
+void hydrasdr_source::worker_loop()
+{
+	thread_pin_current(m_worker_cpu);
+	thread_set_priority_current(m_worker_priority);
+
+	while (!m_worker_exit.load(std::memory_order_acquire)) {
+		int idx;
+
+		if (m_pool_filled->read(&idx, 1) != 1) {
+			m_pool_filled->wait(1, 100);
+			continue;
+		}
+
+		process_samples(m_pool + (size_t)idx * RAW_POOL_SAMPLES, m_pool_len[idx],
+				m_pool_format[idx], m_pool_segment[idx]);
+
+		/* Hand the buffer back to the callback */
+		m_pool_free->write(&idx, 1);
+	}
 }
 
 /*
@@ -322,8 +441,17 @@ int hydrasdr_source::fill_buffer_callback(hydrasdr_transfer_t* transfer)
 		return 0;
 
 	/* Extract sample pointer and count from transfer structure */
-	std::complex<float>* input = (std::complex<float>*)transfer->samples;
+	const void* input = transfer->samples;
 	size_t count = transfer->sample_count;
+	sample_format format = (transfer->sample_type == HYDRASDR_SAMPLE_INT16_IQ) ?
+			       SAMPLE_FORMAT_CI16 : SAMPLE_FORMAT_CF32;
+	size_t sample_bytes = sample_format_bytes(format);
+
+	/* Callback duration and interval, see kal_stats */
+	const uint64_t t0 = stats_now_ns();
+	if (m_last_callback)
+		g_stats.interval_ns.add(t0 - m_last_callback);
+	m_last_callback = t0;
 
 	/*
 	 * FIX: Correctly count hardware-reported dropped samples.
@@ -331,105 +459,46 @@ int hydrasdr_source::fill_buffer_callback(hydrasdr_transfer_t* transfer)
 	 */
 	if (transfer->dropped_samples > 0) {
 		m_overflow_count += (unsigned int)transfer->dropped_samples;
+		m_drops_usb += (unsigned int)transfer->dropped_samples;
+		g_stats.drops_usb.fetch_add(transfer->dropped_samples, std::memory_order_relaxed);
 	}
 
-	/*
-	 * Sanity check: Verify input won't overflow batch buffer.
-	 * Output ratio is approximately 1/9.23, so max output = count/9.23
-	 * With BATCH_SIZE=32768 and ratio ~9.23, max safe input is ~302K samples.
-	 */
-	if (count > 262144) {
-		fprintf(stderr, "Warning: USB transfer size %zu exceeds expected maximum\n", count);
-		/* Process anyway, resampler will clamp output */
-	}
-
-	/*
-	 * Run DSP Pipeline: 2.5 MSPS → 270.833 kSPS
-	 * Stage 1: Decimate by 5 with anti-alias filter (61 taps)
-	 * Stage 2: Rational resample 13/24 with polyphase filter (729 taps)
-	 */
-	size_t produced = m_resampler->process(input, count,
-					       m_batch_buffer, BATCH_SIZE);
-
-	/* Push processed samples to circular buffer (thread-safe) */
-	if (produced > 0) {
-		/*
-		 * Use try_lock to avoid blocking the USB thread.
-		 * If lock is contended, samples are dropped (counted as overflow).
-		 * The circular_buffer has its own mutex, but we use data_mutex
-		 * to coordinate with the consumer thread's wait condition.
-		 */
-		std::unique_lock<std::mutex> lock(data_mutex, std::defer_lock);
-		if (lock.try_lock()) {
-			if (cb) {
-				unsigned int written = cb->write(m_batch_buffer, (unsigned int)produced);
-				if (written < (unsigned int)produced) {
-					/* Software overflow: buffer full */
-					m_overflow_count += (unsigned int)(produced - written);
-				}
-			}
-			lock.unlock();
-			data_ready.notify_one();
-		} else {
-			/* Lock contention: drop samples */
-			m_overflow_count += (unsigned int)produced;
+	/* Sampled here, not in the worker: queued buffers keep their segment */
+	uint32_t segment = m_segment.load(std::memory_order_acquire);
+
+	if (m_worker_enabled) {
+		/* Worker mode: copy into a free pool buffer and return */
+		int idx;
+		size_t n = (std::min)(count, (size_t)RAW_POOL_SAMPLES);
+
+		if (m_pool_free->read(&idx, 1) != 1) {
+			/* DSP-side overflow: worker is behind, pool exhausted */
+			m_overflow_count += (unsigned int)count;
+			m_drops_dsp += (unsigned int)count;
+			g_stats.drops_dsp.fetch_add(count, std::memory_order_relaxed);
+			g_stats.callback_ns.add(stats_now_ns() - t0);
+			return 0;
 		}
-	}
 
-	return 0;
-}
-
-/*
- * ---------------------------------------------------------------------------
- * Sample Consumer (Main Thread)
- * ---------------------------------------------------------------------------
- */
-
-int hydrasdr_source::fill(unsigned int num_samples, unsigned int *overruns)
-{
-	if (!cb)
-		return -1;
-
-	/* Auto-start streaming if not already running */
-	if (!streaming.load(std::memory_order_acquire))
-		start();
-
-	std::unique_lock<std::mutex> lock(data_mutex);
-
-	while (true) {
-		/* Check global exit flag to allow graceful shutdown */
-		if (g_kal_exit_req)
-			return -1;
-
-		/* Exit loop when enough samples available or streaming stopped */
-		if ((cb->data_available() >= num_samples) ||
-		    !streaming.load(std::memory_order_acquire))
-			break;
-
-		/*
-		 * Wait with 100ms timeout to periodically check exit flag.
-		 * This prevents indefinite blocking if no samples arrive.
-		 */
-		data_ready.wait_for(lock, std::chrono::milliseconds(100));
-	}
+		if (n < count) {
+			m_overflow_count += (unsigned int)(count - n);
+			m_drops_dsp += (unsigned int)(count - n);
+			g_stats.drops_dsp.fetch_add(count - n, std::memory_order_relaxed);
+		}
 
-	if (!streaming.load(std::memory_order_acquire))
-		return -1;
+		/* int16 transfers fill only half of a (float-sized) buffer */
+		memcpy(m_pool + (size_t)idx * RAW_POOL_SAMPLES, input, n * sample_bytes);
+		m_pool_len[idx] = (unsigned int)n;
+		m_pool_format[idx] = format;
+		m_pool_segment[idx] = segment;
+		m_pool_filled->write(&idx, 1);
 
-	/* Report and atomically reset overflow counter */
-	if (overruns) {
-		*overruns = m_overflow_count.exchange(0);
+		g_stats.callback_ns.add(stats_now_ns() - t0);
+		return 0;
 	}
 
-	return 0;
-}
-
-int hydrasdr_source::flush()
-{
-	if (cb)
-		cb->flush();
-
-	m_overflow_count = 0;
+	process_samples(input, count, format, segment);
 
+	g_stats.callback_ns.add(stats_now_ns() - t0);
 	return 0;
 }
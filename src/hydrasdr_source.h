@@ -2,10 +2,10 @@
  * @file hydrasdr_source.h
  * @brief SDR source interface for HydraSDR RFOne hardware.
  *
- * This module provides a high-level C++ interface for receiving samples from
- * HydraSDR RFOne hardware. It handles device initialization, tuning, gain
- * control, and integrates a two-stage DSP resampling pipeline to convert
- * the native 2.5 MSPS sample rate to GSM-compatible 270.833 kSPS.
+ * This module provides a sample_source for HydraSDR RFOne hardware. It
+ * handles device initialization, tuning, gain control and USB streaming,
+ * and feeds the sample_source two-stage DSP resampling pipeline that
+ * converts the native 2.5 MSPS sample rate to GSM-compatible 270.833 kSPS.
  *
  * @section Architecture
  *
@@ -26,8 +26,12 @@
  * @section Threading Model
  *
  * - **USB Thread**: Invoked by HydraSDR driver via callback, runs DSP pipeline
+ *   (or, in worker mode, only copies the raw transfer into a buffer pool)
+ * - **Worker Thread** (optional, set_worker()): runs the DSP pipeline on
+ *   pooled raw buffers, optionally pinned to a core with raised priority
  * - **Main Thread**: Consumes processed samples via fill() method
- * - **Synchronization**: std::mutex + std::condition_variable for thread-safe handoff
+ * - **Synchronization**: wait-free SPSC ring (spsc_buffer); the USB thread
+ *   never blocks or drops data because of locking
  *
  * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
  * @copyright 2025 Benjamin Vernoux
@@ -43,43 +47,59 @@
 #define __HYDRASDR_SOURCE_H__
 
 #include <vector>
-#include <mutex>
 #include <atomic>
-#include <condition_variable>
-#include "circular_buffer.h"
-#include "kal_types.h"
-#include "dsp_resampler.h"
+#include <thread>
+#include "sample_source.h"
 #include <hydrasdr.h>
 
 /**
- * @brief Native sample rate of HydraSDR RFOne hardware (Hz).
+ * @brief Default native sample rate of HydraSDR RFOne hardware (Hz).
  *
- * The hardware operates at 2.5 MSPS, which is then resampled by the
- * DSP pipeline to produce the GSM-compatible 270.833 kSPS output rate.
+ * The hardware operates at 2.5 MSPS unless another rate is selected (see
+ * set_sample_rate()); the DSP pipeline resamples it to the GSM-compatible
+ * 270.833 kSPS output rate.
  */
-#define HYDRASDR_2_5MSPS_NATIVE_RATE 2500000
+#define HYDRASDR_2_5MSPS_NATIVE_RATE SAMPLE_SOURCE_INPUT_RATE
+
+/** @brief Raw transfer buffers in the worker pipeline pool. */
+#define RAW_POOL_COUNT 16
+
+/**
+ * @brief Capacity of one raw pool buffer in native rate samples.
+ *
+ * Matches the largest expected USB transfer (128K samples); longer
+ * transfers are truncated and the excess counted as a DSP-side drop.
+ * The whole pool holds ~0.84 s of raw input at 2.5 MSPS.
+ */
+#define RAW_POOL_SAMPLES 131072
+
+/**
+ * @brief Native rate samples dropped after a retune (10 ms at 2.5 MSPS).
+ *
+ * Covers the tuner PLL lock, and is scaled to the rate open() selects.
+ * It comes on top of the first transfer handled after the retune, which
+ * may have been sampled before it.
+ */
+#define HYDRASDR_TUNE_SETTLE_SAMPLES 25000
 
 /**
  * @class hydrasdr_source
- * @brief High-level SDR source for HydraSDR RFOne with integrated DSP resampling.
+ * @brief sample_source for HydraSDR RFOne hardware.
  *
- * This class encapsulates all hardware interaction and signal processing
- * required to receive and condition RF samples for GSM analysis. It manages:
+ * This class encapsulates all hardware interaction required to receive
+ * RF samples for GSM analysis. It manages:
  *
  * - Device lifecycle (open/close)
  * - RF front-end configuration (frequency, gain)
  * - Asynchronous sample streaming with USB callbacks
- * - Two-stage rational resampling (2.5 MSPS → 270.833 kSPS)
- * - Thread-safe sample buffering with overflow detection
+ * - An optional resampler worker thread fed from a raw buffer pool
  *
  * @par Example Usage:
  * @code
  *     hydrasdr_source src(10.0f);  // Initial gain
  *     src.open();
- *     src.tune(935.2e6);           // GSM-900 downlink
- *     src.start();
- *
  *     unsigned int overruns;
+ *     src.tune_capture(935.2e6, 1024, &overruns);  // GSM-900 downlink
  *     while (running) {
  *         src.fill(1024, &overruns);
  *         complex* samples = (complex*)src.get_buffer()->peek(nullptr);
@@ -90,7 +110,7 @@
  *     src.close();
  * @endcode
  */
-class hydrasdr_source {
+class hydrasdr_source : public sample_source {
 public:
 	/**
 	 * @brief Constructs a HydraSDR source instance.
@@ -114,9 +134,10 @@ public:
 	 * @brief Opens and initializes the HydraSDR hardware.
 	 *
 	 * Performs the following initialization sequence:
-	 * 1. Opens the first available HydraSDR device
-	 * 2. Configures Float32 I/Q sample format
-	 * 3. Sets native sample rate (2.5 MSPS)
+	 * 1. Opens the device set_serial() selected (default: the first one)
+	 * 2. Configures Float32 (or int16, see set_int16()) I/Q sample format
+	 * 3. Sets the native sample rate (see set_sample_rate()) and the
+	 *    resampler configuration compiled for it
 	 * 4. Applies initial gain setting
 	 * 5. Allocates circular buffer for sample handoff
 	 *
@@ -127,8 +148,8 @@ public:
 	/**
 	 * @brief Tunes the RF front-end to the specified frequency.
 	 *
-	 * Also resets the DSP filter state to prevent transients from
-	 * the previous frequency from contaminating the new signal.
+	 * The settle interval of the new segment is the first transfer
+	 * handled after the retune plus HYDRASDR_TUNE_SETTLE_SAMPLES.
 	 *
 	 * @param freq Center frequency in Hz (e.g., 935.2e6 for GSM-900).
 	 * @return 0 on success, -1 on failure.
@@ -147,84 +168,88 @@ public:
 	int set_gain(float gain);
 
 	/**
-	 * @brief Starts asynchronous sample streaming.
+	 * @brief Selects packed int16 I/Q transfers instead of float32.
 	 *
-	 * Registers the internal callback with the HydraSDR driver and
-	 * begins receiving samples. Samples are processed through the
-	 * DSP pipeline and deposited into the circular buffer.
+	 * Halves USB-side and per-transfer memory traffic; the int-to-float
+	 * conversion is folded into the resampler's first filter stage
+	 * (dsp_resampler::process_int16()). Must be called before open().
 	 *
-	 * @return 0 on success, -1 on failure.
+	 * @param enable true for HYDRASDR_SAMPLE_INT16_IQ.
 	 */
-	int start();
+	void set_int16(bool enable) { m_int16 = enable; }
 
 	/**
-	 * @brief Stops sample streaming.
+	 * @brief Selects the native sample rate open() configures.
 	 *
-	 * Halts the USB transfer and notifies any threads waiting
-	 * in fill() to allow graceful shutdown.
+	 * The rate must be one the resampler is compiled for
+	 * (dsp_resampler::supports_rate()). 0 selects, among the rates the
+	 * device reports, the one with the lowest resampler cost per output
+	 * sample (dsp_resampler::cost_per_output()). Must be called before
+	 * open().
 	 *
-	 * @return 0 on success.
+	 * @param rate Rate in Hz, or 0 for automatic selection (default).
 	 */
-	int stop();
+	void set_sample_rate(double rate) { m_rate_req = rate; }
 
 	/**
-	 * @brief Closes the device and releases all resources.
+	 * @brief Selects the device open() opens by its serial number.
 	 *
-	 * Calls stop() if still streaming, then releases the device
-	 * handle and frees the circular buffer.
+	 * Must be called before open().
 	 *
-	 * @return 0 on success.
+	 * @param serial Serial number (see hydrasdr_list_devices()), 0 for
+	 *               the first available device.
 	 */
-	int close();
+	void set_serial(uint64_t serial) { m_serial = serial; }
+
+	/** @brief Serial number set by set_serial() (0 = first device). */
+	uint64_t serial() const { return m_serial; }
 
 	/**
-	 * @brief Initializes the source for benchmark mode (no hardware).
+	 * @brief Enables the resampler worker-thread pipeline.
 	 *
-	 * Creates the circular buffer and resampler without opening
-	 * actual hardware. Used by run_dsp_benchmark() to test DSP
-	 * pipeline performance with synthetic data.
+	 * When enabled, the USB callback only copies each raw transfer into
+	 * a pre-allocated pool of RAW_POOL_COUNT buffers; a dedicated worker
+	 * thread runs the resampler and feeds the output ring. Must be
+	 * called while not streaming.
 	 *
-	 * @see run_dsp_benchmark()
+	 * @param enable   true to use the worker thread.
+	 * @param cpu      Core to pin the worker to (-1 = no pinning).
+	 * @param priority Worker priority (0 = default, see
+	 *                 thread_set_priority_current()).
+	 * @return 0 on success, -1 if called while streaming.
 	 */
-	void start_benchmark();
+	int set_worker(bool enable, int cpu = -1, int priority = 0);
 
 	/**
-	 * @brief Returns the output sample rate after resampling.
-	 * @return Sample rate in Hz (270833.333... for GSM).
-	 */
-	inline double sample_rate() { return m_sample_rate; }
-
-	/**
-	 * @brief Returns a pointer to the internal circular buffer.
+	 * @brief Starts asynchronous sample streaming.
 	 *
-	 * Used to access processed samples via peek()/read()/purge().
+	 * Registers the internal callback with the HydraSDR driver and
+	 * begins receiving samples. Samples are processed through the
+	 * DSP pipeline and deposited into the circular buffer.
 	 *
-	 * @return Pointer to circular_buffer instance.
+	 * @return 0 on success, -1 on failure.
 	 */
-	inline circular_buffer* get_buffer() { return cb; }
+	int start();
 
 	/**
-	 * @brief Blocks until the requested number of samples are available.
+	 * @brief Stops sample streaming.
 	 *
-	 * This is the primary method for the consumer thread to wait for
-	 * new data. It uses a condition variable with 100ms timeout to
-	 * periodically check the global exit flag (g_kal_exit_req).
+	 * Halts the USB transfer and notifies any threads waiting
+	 * in fill() to allow graceful shutdown.
 	 *
-	 * @param num_samples Minimum number of samples to wait for.
-	 * @param overruns    Output: number of samples dropped since last call
-	 *                    due to buffer overflow (can be NULL).
-	 * @return 0 on success, -1 if streaming stopped or exit requested.
+	 * @return 0 on success.
 	 */
-	int fill(unsigned int num_samples, unsigned int *overruns);
+	int stop();
 
 	/**
-	 * @brief Discards all buffered samples and resets overflow counter.
+	 * @brief Closes the device and releases all resources.
+	 *
+	 * Calls stop() if still streaming, then releases the device
+	 * handle and frees the circular buffer.
+	 *
 	 * @return 0 on success.
 	 */
-	int flush();
-
-	/** @brief Current center frequency in Hz. */
-	double m_center_freq;
+	int close();
 
 	/** @brief Frequency correction in PPM (reserved for future use). */
 	int m_freq_corr;
@@ -247,53 +272,60 @@ private:
 	/** @brief HydraSDR device handle. */
 	hydrasdr_device* dev;
 
-	/** @brief Circular buffer for producer/consumer sample handoff. */
-	circular_buffer* cb;
+	/** @brief Request int16 I/Q transfers (see set_int16()). */
+	bool m_int16;
 
-	/** @brief Condition variable for consumer thread synchronization. */
-	std::condition_variable data_ready;
+	/** @brief Device to open (see set_serial()). */
+	uint64_t m_serial;
 
-	/** @brief Mutex protecting buffer access coordination. */
-	std::mutex data_mutex;
+	/** @brief Requested native rate, 0 = automatic (see set_sample_rate()). */
+	double m_rate_req;
 
 	/**
-	 * @brief Atomic streaming state flag.
-	 *
-	 * Using std::atomic<bool> to avoid data race between USB callback
-	 * thread (reader) and control methods (writer). This eliminates
-	 * undefined behavior that would occur with a plain bool.
+	 * @brief Resolves m_rate_req against the rates the open device reports.
+	 * @return Rate in Hz, or 0 if none is usable (error printed to stderr).
 	 */
-	std::atomic<bool> streaming;
+	double select_rate();
 
-	/** @brief Current RF gain setting. */
-	float m_gain;
+	/** @brief Time of the last callback (ns, see kal_stats), 0 before the first. */
+	uint64_t m_last_callback;
 
-	/** @brief Output sample rate after resampling (Hz). */
-	double m_sample_rate;
+	/*
+	 * Worker Pipeline (see set_worker())
+	 */
 
-	/** @brief Atomic overflow counter (samples dropped). */
-	std::atomic<unsigned int> m_overflow_count;
+	bool m_worker_enabled;
+	int m_worker_cpu;
+	int m_worker_priority;
+	std::thread m_worker;
+	std::atomic<bool> m_worker_exit;
 
-	/** @brief DSP resampler instance (2.5 MSPS → 270.833 kSPS). */
-	dsp_resampler* m_resampler;
+	/** @brief RAW_POOL_COUNT buffers of RAW_POOL_SAMPLES samples. */
+	std::complex<float>* m_pool;
 
-	/**
-	 * @brief Size of intermediate batch buffer for DSP output.
-	 *
-	 * Calculation for maximum USB transfer of 128K samples:
-	 *   Input:  131072 samples (128K, conservative upper bound)
-	 *   Stage1: 131072 / 5 = 26214 samples
-	 *   Stage2: 26214 * 13/24 ≈ 14200 samples
-	 *
-	 * BATCH_SIZE = 32768 provides 2x safety margin.
-	 *
-	 * @note If libhydrasdr ever provides larger transfers, this must
-	 *       be increased proportionally to avoid data loss.
-	 */
-	static const int BATCH_SIZE = 32768;
+	/** @brief Valid samples in each pool buffer. */
+	unsigned int m_pool_len[RAW_POOL_COUNT];
+
+	/** @brief Sample format of each pool buffer. */
+	sample_format m_pool_format[RAW_POOL_COUNT];
+
+	/** @brief Stream segment each pool buffer was received in. */
+	uint32_t m_pool_segment[RAW_POOL_COUNT];
+
+	/** @brief Free buffer indices (worker produces, callback consumes). */
+	spsc_buffer* m_pool_free;
+
+	/** @brief Filled buffer indices (callback produces, worker consumes). */
+	spsc_buffer* m_pool_filled;
+
+	/** @brief Starts the worker thread and primes the pool queues. */
+	int start_worker();
+
+	/** @brief Signals the worker thread to exit and joins it. */
+	void stop_worker();
 
-	/** @brief Intermediate buffer for DSP pipeline output. */
-	std::complex<float> m_batch_buffer[BATCH_SIZE];
+	/** @brief Worker thread body. */
+	void worker_loop();
 };
 
 #endif /* __HYDRASDR_SOURCE_H__ */
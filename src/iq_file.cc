@@ -0,0 +1,374 @@
+/**
+ * @file iq_file.cc
+ * @brief Implementation of the I/Q recording sidecar, reader and recorder.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <math.h>
+#include <string>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include "iq_file.h"
+#include "sample_source.h"
+#include "kal_globals.h"
+
+/** @brief Samples written per fill() while recording. */
+#define IQ_RECORD_CHUNK 16384
+
+static const char *iq_format_names[IQ_FORMAT_COUNT] = { "cf32", "ci16" };
+
+const char *iq_format_name(iq_format f)
+{
+	if (f < 0 || f >= IQ_FORMAT_COUNT)
+		return "unknown";
+	return iq_format_names[f];
+}
+
+size_t iq_format_bytes(iq_format f)
+{
+	return (f == IQ_FORMAT_CI16) ? 2 * sizeof(int16_t) : 2 * sizeof(float);
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Sidecar
+ * ---------------------------------------------------------------------------
+ */
+
+int iq_meta_write(const char *data_path, const iq_meta *m)
+{
+	std::string path = std::string(data_path) + IQ_META_SUFFIX;
+	time_t t = (time_t)m->start_time;
+	char utc[32] = "";
+	FILE *f;
+
+	f = fopen(path.c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "error: cannot write '%s'\n", path.c_str());
+		return -1;
+	}
+
+	if (m->start_time > 0.0)
+		strftime(utc, sizeof(utc), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+	fprintf(f, "# kal I/Q recording\n");
+	fprintf(f, "format = %s\n", iq_format_name(m->format));
+	fprintf(f, "sample_rate = %.6f\n", m->sample_rate);
+	fprintf(f, "center_freq = %.0f\n", m->center_freq);
+	fprintf(f, "start_time = %.6f\n", m->start_time);
+	if (*utc)
+		fprintf(f, "start_utc = %s\n", utc);
+	fprintf(f, "samples = %llu\n", (unsigned long long)m->samples);
+	fprintf(f, "gain = %g\n", m->gain);
+	fprintf(f, "overruns = %u\n", m->overruns);
+
+	if (fclose(f)) {
+		fprintf(stderr, "error: cannot write '%s'\n", path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/* Strips leading and trailing white space in place */
+static char *trim(char *s)
+{
+	char *e;
+
+	while (isspace((unsigned char)*s))
+		s++;
+	e = s + strlen(s);
+	while (e > s && isspace((unsigned char)e[-1]))
+		*--e = '\0';
+	return s;
+}
+
+int iq_meta_read(const char *data_path, iq_meta *m)
+{
+	std::string path = std::string(data_path) + IQ_META_SUFFIX;
+	bool have_format = false, have_rate = false, have_freq = false;
+	char line[256];
+	FILE *f;
+
+	memset(m, 0, sizeof(*m));
+
+	f = fopen(path.c_str(), "r");
+	if (!f) {
+		fprintf(stderr, "error: cannot read '%s'\n", path.c_str());
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char *eq, *key, *val = NULL;
+
+		if ((eq = strchr(line, '#')))
+			*eq = '\0';
+		if (!(eq = strchr(line, '=')))
+			continue;
+		*eq = '\0';
+		key = trim(line);
+		val = trim(eq + 1);
+
+		if (!strcmp(key, "format")) {
+			for (int i = 0; i < IQ_FORMAT_COUNT; i++) {
+				if (!strcmp(val, iq_format_names[i])) {
+					m->format = (iq_format)i;
+					have_format = true;
+				}
+			}
+			if (!have_format) {
+				fprintf(stderr, "error: %s: unknown format '%s'\n", path.c_str(), val);
+				fclose(f);
+				return -1;
+			}
+		} else if (!strcmp(key, "sample_rate")) {
+			m->sample_rate = strtod(val, NULL);
+			have_rate = m->sample_rate > 0.0;
+		} else if (!strcmp(key, "center_freq")) {
+			m->center_freq = strtod(val, NULL);
+			have_freq = m->center_freq > 0.0;
+		} else if (!strcmp(key, "start_time")) {
+			m->start_time = strtod(val, NULL);
+		} else if (!strcmp(key, "samples")) {
+			m->samples = strtoull(val, NULL, 0);
+		} else if (!strcmp(key, "gain")) {
+			m->gain = (float)strtod(val, NULL);
+		} else if (!strcmp(key, "overruns")) {
+			m->overruns = (unsigned int)strtoul(val, NULL, 0);
+		}
+	}
+	fclose(f);
+
+	if (!have_format || !have_rate || !have_freq) {
+		fprintf(stderr, "error: %s: format, sample_rate and center_freq are required\n",
+			path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Reader
+ * ---------------------------------------------------------------------------
+ */
+
+iq_file::iq_file()
+{
+	memset(&m_meta, 0, sizeof(m_meta));
+	m_data = NULL;
+	m_map_len = 0;
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_fd = -1;
+#endif
+}
+
+iq_file::~iq_file()
+{
+	close();
+}
+
+int iq_file::open(const char *path)
+{
+	uint64_t size, n;
+
+	close();
+	if (iq_meta_read(path, &m_meta))
+		return -1;
+
+#ifdef _WIN32
+	LARGE_INTEGER li;
+
+	m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			     FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &li)) {
+		fprintf(stderr, "error: cannot open '%s'\n", path);
+		close();
+		return -1;
+	}
+	size = (uint64_t)li.QuadPart;
+#else
+	struct stat st;
+
+	m_fd = ::open(path, O_RDONLY);
+	if (m_fd < 0 || fstat(m_fd, &st)) {
+		fprintf(stderr, "error: cannot open '%s': %s\n", path, strerror(errno));
+		close();
+		return -1;
+	}
+	size = (uint64_t)st.st_size;
+#endif
+
+	n = size / iq_format_bytes(m_meta.format);
+	if (!m_meta.samples || m_meta.samples > n)
+		m_meta.samples = n;
+	if (!m_meta.samples) {
+		fprintf(stderr, "error: '%s' holds no samples\n", path);
+		close();
+		return -1;
+	}
+	m_map_len = (size_t)(m_meta.samples * iq_format_bytes(m_meta.format));
+
+#ifdef _WIN32
+	m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping)
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, m_map_len);
+	if (!m_data) {
+		fprintf(stderr, "error: cannot map '%s'\n", path);
+		close();
+		return -1;
+	}
+#else
+	void *p = mmap(NULL, m_map_len, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "error: cannot map '%s': %s\n", path, strerror(errno));
+		close();
+		return -1;
+	}
+	/* Played front to back, possibly several times */
+	madvise(p, m_map_len, MADV_SEQUENTIAL);
+	m_data = p;
+#endif
+
+	return 0;
+}
+
+void iq_file::close()
+{
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_mapping = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_data)
+		munmap((void *)m_data, m_map_len);
+	if (m_fd >= 0)
+		::close(m_fd);
+	m_fd = -1;
+#endif
+	m_data = NULL;
+	m_map_len = 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Recorder
+ * ---------------------------------------------------------------------------
+ */
+
+int iq_record(sample_source *u, const char *path, double seconds, bool gsm_rate)
+{
+	spsc_buffer *cb = u->get_buffer();
+	unsigned int overruns, b_len;
+	uint64_t total, written = 0;
+	iq_meta m;
+	complex *b;
+	FILE *f;
+	int r = 0;
+
+	f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "error: cannot create '%s'\n", path);
+		return -1;
+	}
+
+	memset(&m, 0, sizeof(m));
+	m.format = IQ_FORMAT_CF32;
+	m.sample_rate = gsm_rate ? u->sample_rate() : u->native_rate();
+	m.center_freq = u->center_freq();
+	m.gain = u->gain();
+	total = (uint64_t)llrint(seconds * m.sample_rate);
+
+	if (u->start()) {
+		r = -1;
+		goto out;
+	}
+	if (!gsm_rate)
+		u->set_wideband(true);
+	if (u->wait_settled()) {
+		r = -1;
+		goto out;
+	}
+	m.start_time = std::chrono::duration<double>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	if (g_verbosity == 0)
+		printf("Recording %.1f s at %.3f kSPS to '%s'\n", seconds, m.sample_rate / 1e3, path);
+
+	while (written < total) {
+		if (u->fill(IQ_RECORD_CHUNK, &overruns)) {
+			if (!g_kal_exit_req)
+				r = -1;
+			break;
+		}
+		m.overruns += overruns;
+
+		b = (complex *)cb->peek(&b_len);
+		if (b_len > total - written)
+			b_len = (unsigned int)(total - written);
+		if (fwrite(b, sizeof(complex), b_len, f) != b_len) {
+			fprintf(stderr, "error: write to '%s' failed\n", path);
+			r = -1;
+			break;
+		}
+		cb->purge(b_len);
+		written += b_len;
+	}
+
+out:
+	if (!gsm_rate)
+		u->set_wideband(false);
+	u->stop();
+
+	if (fclose(f)) {
+		fprintf(stderr, "error: write to '%s' failed\n", path);
+		r = -1;
+	}
+
+	if (r == 0 && !written)
+		r = -1;
+	if (written) {
+		m.samples = written;
+		if (iq_meta_write(path, &m))
+			r = -1;
+		printf("Recorded %llu samples (%.2f s), overruns: %u\n",
+		       (unsigned long long)written, written / m.sample_rate, m.overruns);
+		if (m.overruns)
+			fprintf(stderr, "Warning: samples were lost, the recording has gaps.\n");
+	}
+
+	return r;
+}
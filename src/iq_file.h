@@ -0,0 +1,145 @@
+/**
+ * @file iq_file.h
+ * @brief Raw I/Q recordings: metadata sidecar, memory-mapped reader, recorder.
+ *
+ * A recording is a headerless file of interleaved little-endian I/Q
+ * samples, either complex float32 ("cf32", full scale 1.0) or complex
+ * int16 ("ci16", as the packed USB transfers), at the native rate (2.5
+ * MSPS by default) or at the 270.833 kSPS GSM rate. Next to it,
+ * "<file>.meta" holds one "key = value" per line:
+ *
+ * @code
+ *   format = cf32
+ *   sample_rate = 2500000
+ *   center_freq = 958600000
+ *   start_time = 1760464800.123456      (Unix time of the first sample)
+ *   start_utc = 2025-10-14T18:00:00Z    (same, informational)
+ *   samples = 25000000
+ *   gain = 10
+ *   overruns = 0
+ * @endcode
+ *
+ * Unknown keys and '#' comments are ignored; format, sample_rate and
+ * center_freq are required. iq_record() writes both files from a live
+ * sample_source, replay_source plays them back.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __IQ_FILE_H__
+#define __IQ_FILE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/** @brief Appended to the data file name to get the sidecar name. */
+#define IQ_META_SUFFIX ".meta"
+
+/** @brief Sample formats of a recording. */
+enum iq_format {
+	IQ_FORMAT_CF32 = 0,   /**< Interleaved float32 I/Q */
+	IQ_FORMAT_CI16,       /**< Interleaved int16 I/Q */
+	IQ_FORMAT_COUNT
+};
+
+/** @brief Returns the sidecar name of a format ("cf32", "ci16"). */
+const char *iq_format_name(iq_format f);
+
+/** @brief Bytes per complex sample of a format. */
+size_t iq_format_bytes(iq_format f);
+
+/** @brief Contents of a recording sidecar. */
+struct iq_meta {
+	iq_format format;
+	double sample_rate;      /**< Hz */
+	double center_freq;      /**< Hz */
+	double start_time;       /**< Unix time of the first sample (s), 0 = unknown */
+	uint64_t samples;        /**< Complex samples, 0 = from the file size */
+	float gain;
+	unsigned int overruns;   /**< Samples lost while recording */
+};
+
+/**
+ * @brief Writes "<data_path>.meta".
+ * @return 0 on success, -1 on error (message on stderr).
+ */
+int iq_meta_write(const char *data_path, const iq_meta *m);
+
+/**
+ * @brief Reads "<data_path>.meta".
+ * @return 0 on success, -1 on error (message on stderr).
+ */
+int iq_meta_read(const char *data_path, iq_meta *m);
+
+/**
+ * @class iq_file
+ * @brief Read-only memory mapping of a recording and its sidecar.
+ */
+class iq_file {
+public:
+	iq_file();
+	~iq_file();
+
+	/**
+	 * @brief Maps a recording.
+	 *
+	 * The sample count is the sidecar's, capped to the file size.
+	 *
+	 * @return 0 on success, -1 on error (message on stderr).
+	 */
+	int open(const char *path);
+
+	/** @brief Unmaps the recording. */
+	void close();
+
+	/** @brief First sample, in meta().format. */
+	const void *data() const { return m_data; }
+
+	/** @brief Number of complex samples. */
+	uint64_t samples() const { return m_meta.samples; }
+
+	/** @brief Sidecar contents. */
+	const iq_meta &meta() const { return m_meta; }
+
+private:
+	iq_meta m_meta;
+	const void *m_data;
+	size_t m_map_len;
+
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_fd;
+#endif
+};
+
+class sample_source;
+
+/**
+ * @brief Records the tuned frequency to a file and its sidecar.
+ *
+ * Streams from the settled start of the current tune. Native rate
+ * recordings use the wideband output (see set_wideband()), GSM rate
+ * recordings the resampled one. Samples are written as cf32.
+ *
+ * @param u        Open source, tuned to the frequency to record.
+ * @param path     Data file (the sidecar is path + IQ_META_SUFFIX).
+ * @param seconds  Recording length.
+ * @param gsm_rate Record 270.833 kSPS instead of the native rate.
+ * @return 0 on success, -1 on error or if interrupted before any sample.
+ */
+int iq_record(sample_source *u, const char *path, double seconds, bool gsm_rate);
+
+#endif /* __IQ_FILE_H__ */
@@ -14,8 +14,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <ctype.h>
 #include <time.h> 
 #include <signal.h> // Added for signal handling
+#include <vector>
+#include <string>
 
 #ifdef _WIN32
 #include "win_compat.h"
@@ -30,15 +33,27 @@
 
 #include "hydrasdr_source.h"
 #include "fcch_detector.h"
+#include "fft_plan_cache.h"
+#include "kal_state.h"
 #include "arfcn_freq.h"
 #include "offset.h"
 #include "c0_detect.h"
+#include "warm_start.h"
+#include "kal_server.h"
+#include "wideband_scan.h"
+#include "replay_source.h"
+#include "iq_file.h"
+#include "bench_suite.h"
+#include "kal_stats.h"
 #include "util.h"
 #include "kal_globals.h"
 
 #define HYDRASDR_FLASH_CALIB_OFFSET (0x20000) 
 #define HYDRASDR_FLASH_CALIB_HEADER (0xCA1B0001)
 
+/** @brief Most HydraSDR devices -d all / list will enumerate. */
+#define MAX_DEVICES 16
+
 typedef struct {
 	uint32_t header;
 	uint32_t timestamp;
@@ -48,6 +63,9 @@ typedef struct {
 int g_verbosity = 0;
 int g_debug = 0;
 int g_show_fft = 0;
+int g_peak_mode = FCCH_PEAK_TABLE;
+int g_fcch_track = 1;
+kal_stats g_stats;
 
 // Global control flags for signal handling
 volatile sig_atomic_t g_kal_exit_req = 0;
@@ -81,9 +99,13 @@ void usage(char *prog) {
 	fprintf(stderr, "\n");
 	fprintf(stderr, "\tClock Offset Calculation:\n");
 	fprintf(stderr, "\t\t%s <-f frequency | -c channel> [options]\n", basename(prog));
+	fprintf(stderr, "\t\t%s -a <band | auto> [options] (from the last result, scan if it fails)\n", basename(prog));
+	fprintf(stderr, "\n");
+	fprintf(stderr, "\tService Mode:\n");
+	fprintf(stderr, "\t\t%s -S <socket path> [options] (JSON requests: measure, scan, calibrate, status)\n", basename(prog));
 	fprintf(stderr, "\n");
 	fprintf(stderr, "\tDevice Maintenance:\n");
-	fprintf(stderr, "\t\t%s -R (Read Calibration)\n", basename(prog));
+	fprintf(stderr, "\t\t%s -R [-d serial,...] (Read Calibration)\n", basename(prog));
 	fprintf(stderr, "\t\t%s -W <ppb_error> (Write Calibration and Reset)\n", basename(prog));
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Where options are:\n");
@@ -91,23 +113,113 @@ void usage(char *prog) {
 	fprintf(stderr, "\t-f\tfrequency of nearby GSM base station\n");
 	fprintf(stderr, "\t-c\tchannel of nearby GSM base station\n");
 	fprintf(stderr, "\t-b\tband indicator (GSM850, GSM-R, GSM900, EGSM, DCS)\n");
+	fprintf(stderr, "\t-a\twarm start: measure on the last or strongest known carrier, scan the band if it is gone (band, or auto = any known band)\n");
+	fprintf(stderr, "\t-S\tserve JSON requests on a Unix socket, keeping the devices open (one object per line, see kal_server.h)\n");
 	fprintf(stderr, "\t-g\tgain (0-21 for HydraSDR Linearity Gain)\n");
+	fprintf(stderr, "\t-d\tdevices by hex serial: serial[,serial...] | all | list (several = per-device offsets, or the scan split between them)\n");
+	fprintf(stderr, "\t-e\tresampler engine (two-stage, fused)\n");
+	fprintf(stderr, "\t-n\tnative sample rate in MSPS (2.5, 5, 10; default the cheapest to resample the device supports)\n");
+	fprintf(stderr, "\t-o\toutput samples per symbol (1, 2, 4; default 1, drops back to 1 when the CPU falls behind)\n");
+	fprintf(stderr, "\t-i\tuse packed int16 I/Q USB transfers (default float32)\n");
+	fprintf(stderr, "\t-t\trun resampler in a worker thread: cpu[,priority] (cpu -1 = not pinned)\n");
+	fprintf(stderr, "\t-p\tFFT peak refinement (sinc, table, parabolic, jacobsen; default table)\n");
+	fprintf(stderr, "\t-j\tFCCH scan threads for band scans (default 1)\n");
+	fprintf(stderr, "\t-m\tband scan method (narrow = tune per channel, wide = ~2 MHz FFT power pass, multi = wide + channelized FCCH pass)\n");
+	fprintf(stderr, "\t-M\tmonitor the offset until Ctrl-C: interval_s[,ema_alpha] (-f/-c only)\n");
+	fprintf(stderr, "\t-E\tstop the offset measurement at a standard error: ppb[,min_bursts][,pm] (default %u bursts min, pm = weight bursts by peak-to-mean)\n",
+		OFFSET_MIN_BURSTS);
+	fprintf(stderr, "\t-T\tdisable FCCH tracking (full search of every window)\n");
+	fprintf(stderr, "\t-w\trecord I/Q to a file and exit: path[,seconds[,gsm]] (default 10 s at the native rate, -f/-c only)\n");
+	fprintf(stderr, "\t-r\treplay an I/Q recording instead of the device (default frequency from its .meta)\n");
+	fprintf(stderr, "\t-F\tFFTW wisdom file (default $%s or ~/%s, \"\" = none)\n",
+		FFT_WISDOM_ENV, FFT_WISDOM_DEFAULT_NAME);
+	fprintf(stderr, "\t-G\tGenerate FFTW wisdom file and exit\n");
+	fprintf(stderr, "\t-C\tstate file: C0 carriers found by the last scan of each band and the last result of each device (default $%s or ~/%s, \"\" = none)\n",
+		KAL_STATE_ENV, KAL_STATE_DEFAULT_NAME);
 	fprintf(stderr, "\t-R\tRead calibration data from flash\n");
 	fprintf(stderr, "\t-W\tWrite calibration data (int32 PPB) to flash and RESET\n");
 	fprintf(stderr, "\t-A\tShow ASCII FFT of signal\n");
 	fprintf(stderr, "\t-B\tRun DSP Benchmark and exit\n");
-	fprintf(stderr, "\t-v\tverbose\n");
-	fprintf(stderr, "\t-D\tenable debug messages\n");
+	fprintf(stderr, "\t-P\trun benchmark scenarios and exit: name[,name...] | all | list (replays use -r if given)\n");
+	fprintf(stderr, "\t-J\twrite a JSON report to a file: -P results, else pipeline stats at exit\n");
+	fprintf(stderr, "\t-v\tverbose (pipeline stats every %.0f s and at exit)\n", STATS_DUMP_INTERVAL);
+	fprintf(stderr, "\t-D\tenable debug messages (full pipeline stats)\n");
 	fprintf(stderr, "\t-h\thelp\n");
 	exit(1);
 }
 
-int handle_calibration(bool write, int32_t ppb_value) {
+/*
+ * Prints the serial number of every attached HydraSDR.
+ */
+static int list_devices() {
+	uint64_t serials[MAX_DEVICES];
+	int n;
+
+	n = hydrasdr_list_devices(serials, MAX_DEVICES);
+	if (n < 0) {
+		fprintf(stderr, "Error: Failed to list HydraSDR devices: %d\n", n);
+		return -1;
+	}
+	if (n > MAX_DEVICES)
+		n = MAX_DEVICES;
+
+	printf("%d HydraSDR device(s) found\n", n);
+	for (int i = 0; i < n; i++)
+		printf("  0x%016llX\n", (unsigned long long)serials[i]);
+	return 0;
+}
+
+/*
+ * Parses -d: "all" for every attached device, or a comma separated list
+ * of hex serial numbers.
+ */
+static int parse_devices(const char *spec, std::vector<uint64_t> *serials) {
+	char *end;
+
+	serials->clear();
+	if (!strcmp(spec, "all")) {
+		uint64_t sn[MAX_DEVICES];
+		int n = hydrasdr_list_devices(sn, MAX_DEVICES);
+
+		if (n <= 0) {
+			fprintf(stderr, "error: no HydraSDR device found\n");
+			return -1;
+		}
+		if (n > MAX_DEVICES)
+			n = MAX_DEVICES;
+		serials->assign(sn, sn + n);
+		return 0;
+	}
+
+	while (*spec) {
+		uint64_t sn = strtoull(spec, &end, 16);
+
+		if (end == spec || (*end && *end != ',') || !sn) {
+			fprintf(stderr, "error: bad device serial: ``%s''\n", spec);
+			return -1;
+		}
+		for (size_t i = 0; i < serials->size(); i++) {
+			if ((*serials)[i] == sn) {
+				fprintf(stderr, "error: device 0x%016llX listed twice\n", (unsigned long long)sn);
+				return -1;
+			}
+		}
+		serials->push_back(sn);
+		spec = *end ? end + 1 : end;
+	}
+	if (serials->size() > MAX_DEVICES) {
+		fprintf(stderr, "error: at most %d devices\n", MAX_DEVICES);
+		return -1;
+	}
+	return serials->empty() ? -1 : 0;
+}
+
+int handle_calibration(bool write, int32_t ppb_value, uint64_t serial) {
 	hydrasdr_device* dev = NULL;
 	int res;
 	hydrasdr_calib_t calib;
 
-	res = hydrasdr_open(&dev); 
+	res = serial ? hydrasdr_open_sn(&dev, serial) : hydrasdr_open(&dev);
 	if (res != HYDRASDR_SUCCESS) {
 		fprintf(stderr, "Error: Failed to open HydraSDR device: %d\n", res);
 		return -1;
@@ -192,15 +304,39 @@ int main(int argc, char **argv) {
 	int bi = BI_NOT_DEFINED;
 	int chan = -1;
 	int bts_scan = 0;
+	bool auto_mode = false;
+	const char *server_path = NULL;
 	float gain = 10.0; 
 	double freq = -1.0;
 	int result = 0;
+	dsp_engine_id engine = DSP_ENGINE_TWO_STAGE;
+	bool use_worker = false;
+	bool use_int16 = false;
+	double native_rate = 0.0;
+	unsigned int sps = 1;
+	int worker_cpu = -1, worker_prio = 0;
+	unsigned long scan_workers = 1;
+	c0_scan_mode scan_mode = C0_SCAN_NARROW;
+	double monitor_interval = 0.0, monitor_alpha = 0.0;
+	char *record_path = NULL;
+	const char *replay_path = NULL;
+	double record_seconds = 10.0;
+	bool record_gsm = false;
+	const char *device_spec = NULL;
+	const char *bench_spec = NULL;
+	const char *bench_json = NULL;
+	std::vector<uint64_t> serials;
+	std::vector<sample_source *> srcs;
+	std::vector<std::string> names;
+	std::vector<const char *> name_ptrs;
 	
+	bool do_gen_wisdom = false;
 	bool do_read_cal = false;
 	bool do_write_cal = false;
 	int32_t write_cal_val = 0;
 	
-	hydrasdr_source *u = NULL;
+	sample_source *u = NULL;
+	replay_source *replay = NULL;
 
 	// Setup Windows Console for Unicode/ANSI
 #ifdef _WIN32
@@ -217,7 +353,7 @@ int main(int argc, char **argv) {
 	signal(SIGINT, sighandler);
 #endif
 
-	while((c = getopt(argc, argv, "f:c:s:b:g:W:RvDBAh?")) != EOF) {
+	while((c = getopt(argc, argv, "f:c:s:b:a:S:g:d:e:n:o:t:p:j:m:M:E:w:r:F:C:W:P:J:RivDGBATh?")) != EOF) {
 		switch(c) {
 			case 'f':
 				freq = strtod(optarg, 0);
@@ -240,9 +376,132 @@ int main(int argc, char **argv) {
 				}
 				check_band_limit(bi);
 				break;
+			case 'a':
+				if (!strcmp(optarg, "auto")) {
+					bi = BI_NOT_DEFINED;
+				} else if ((bi = str_to_bi(optarg)) == -1) {
+					fprintf(stderr, "error: bad band indicator: ``%s''\n", optarg);
+					usage(argv[0]);
+				} else {
+					check_band_limit(bi);
+				}
+				auto_mode = true;
+				break;
+			case 'S':
+				server_path = optarg;
+				break;
 			case 'g':
 				gain = strtof(optarg, 0);
 				break;
+			case 'd':
+				if (!strcmp(optarg, "list"))
+					return list_devices() ? 1 : 0;
+				device_spec = optarg;
+				break;
+			case 'e':
+				if((c = str_to_engine(optarg)) == -1) {
+					fprintf(stderr, "error: bad resampler engine: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				engine = (dsp_engine_id)c;
+				break;
+			case 'n':
+				native_rate = strtod(optarg, 0) * 1e6;
+				if(!dsp_resampler::supports_rate(native_rate)) {
+					fprintf(stderr, "error: no resampler configuration for ``%s'' MSPS\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'o':
+				sps = (unsigned int)strtoul(optarg, 0, 0);
+				if(!dsp_resampler::supports_rate(DSP_RESAMPLER_INPUT_RATE, sps)) {
+					fprintf(stderr, "error: bad samples per symbol: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'i':
+				use_int16 = true;
+				break;
+			case 't':
+				use_worker = true;
+				if(sscanf(optarg, "%d,%d", &worker_cpu, &worker_prio) < 1) {
+					fprintf(stderr, "error: bad worker spec: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'p':
+				if((g_peak_mode = str_to_peak_mode(optarg)) == -1) {
+					fprintf(stderr, "error: bad peak refinement mode: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'j':
+				scan_workers = strtoul(optarg, 0, 0);
+				if(scan_workers < 1 || scan_workers > 64) {
+					fprintf(stderr, "error: bad scan worker count: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'm':
+				if((c = str_to_scan_mode(optarg)) == -1) {
+					fprintf(stderr, "error: bad scan mode: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				scan_mode = (c0_scan_mode)c;
+				break;
+			case 'M':
+				if(sscanf(optarg, "%lf,%lf", &monitor_interval, &monitor_alpha) < 1 ||
+				   monitor_interval <= 0.0 || monitor_alpha < 0.0 || monitor_alpha > 1.0) {
+					fprintf(stderr, "error: bad monitor spec: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'E': {
+				offset_precision prec = offset_get_precision();
+				char *s;
+
+				prec.ppb = strtod(optarg, &s);
+				if (*s == ',' && isdigit((unsigned char)s[1]))
+					prec.min_bursts = strtoul(s + 1, &s, 0);
+				if (*s == ',' && !strcmp(s + 1, "pm")) {
+					prec.pm_weight = true;
+					s += 3;
+				}
+				if (prec.ppb <= 0.0 || prec.min_bursts < 2 || *s) {
+					fprintf(stderr, "error: bad precision spec: ``%s''\n", optarg);
+					usage(argv[0]);
+				}
+				offset_set_precision(&prec);
+				break;
+			}
+			case 'w': {
+				char *spec = strdup(optarg), *s;
+				free(record_path);
+				record_path = spec;
+				if ((s = strchr(spec, ','))) {
+					*s++ = '\0';
+					record_seconds = strtod(s, &s);
+					if (*s == ',')
+						record_gsm = !strcmp(s + 1, "gsm");
+					if (record_seconds <= 0.0 || (*s && !record_gsm)) {
+						fprintf(stderr, "error: bad record spec: ``%s''\n", optarg);
+						usage(argv[0]);
+					}
+				}
+				break;
+			}
+			case 'r':
+				replay_path = optarg;
+				break;
+			case 'F':
+				fft_wisdom_set_path(optarg);
+				break;
+			case 'C':
+				kal_state_set_path(optarg);
+				break;
+			case 'G':
+				do_gen_wisdom = true;
+				break;
 			case 'R':
 				do_read_cal = true;
 				break;
@@ -253,9 +512,18 @@ int main(int argc, char **argv) {
 			case 'B':
 				run_dsp_benchmark();
 				return 0; 
+			case 'P':
+				bench_spec = optarg;
+				break;
+			case 'J':
+				bench_json = optarg;
+				break;
 			case 'A':
 				g_show_fft = 1;
 				break;
+			case 'T':
+				g_fcch_track = 0;
+				break;
 			case 'v':
 				g_verbosity++;
 				break;
@@ -270,12 +538,121 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if (do_gen_wisdom) {
+		const int fcch[] = { FFT_SIZE, (int)fcch_detector::fft_len(2 * GSM_RATE),
+				     (int)fcch_detector::fft_len(DSP_RESAMPLER_MAX_SPS * GSM_RATE) };
+		std::vector<int> sizes(1, WB_FFT_SIZE), howmany(1, 1);
+
+		// FCCH sizes alone and in every scan_all() batch
+		for (unsigned int i = 0; i < sizeof(fcch) / sizeof(fcch[0]); i++) {
+			for (int m = 1; m <= FCCH_BATCH_MAX; m <<= 1) {
+				sizes.push_back(fcch[i]);
+				howmany.push_back(m);
+			}
+		}
+		return fft_wisdom_generate(&sizes[0], &howmany[0], (unsigned int)sizes.size()) ? 1 : 0;
+	}
+
+	if (bench_spec)
+		return bench_suite_run(bench_spec, bench_json, replay_path,
+				       PACKAGE_VERSION "-hydrasdr") ? 1 : 0;
+	if (device_spec && parse_devices(device_spec, &serials))
+		return -1;
+
 	if (do_read_cal || do_write_cal) {
 		if (do_read_cal && do_write_cal) {
 			fprintf(stderr, "Error: Cannot Read (-R) and Write (-W) at the same time.\n");
 			return -1;
 		}
-		return handle_calibration(do_write_cal, write_cal_val);
+		if (do_write_cal && serials.size() > 1) {
+			fprintf(stderr, "Error: Write (-W) takes one device (-d serial).\n");
+			return -1;
+		}
+		if (serials.size() <= 1)
+			return handle_calibration(do_write_cal, write_cal_val, serials.empty() ? 0 : serials[0]);
+
+		for (size_t i = 0; i < serials.size(); i++) {
+			printf("Device 0x%016llX:\n", (unsigned long long)serials[i]);
+			if (handle_calibration(false, 0, serials[i]))
+				result = -1;
+		}
+		return result;
+	}
+
+	if (serials.size() > 1 && (record_path || replay_path || monitor_interval > 0.0)) {
+		fprintf(stderr, "error: -w, -r and -M take one device\n");
+		usage(argv[0]);
+	}
+
+	if (auto_mode && (bts_scan || freq >= 0.0 || chan >= 0 || record_path ||
+			  monitor_interval > 0.0 || serials.size() > 1)) {
+		fprintf(stderr, "error: -a takes one device and no -s, -f, -c, -w or -M\n");
+		usage(argv[0]);
+	}
+	if (server_path && (bts_scan || freq >= 0.0 || chan >= 0 || auto_mode || record_path ||
+			    monitor_interval > 0.0)) {
+		fprintf(stderr, "error: -S takes no -s, -f, -c, -a, -w or -M (they are requests)\n");
+		usage(argv[0]);
+	}
+	if (auto_mode && !*kal_state_path()) {
+		fprintf(stderr, "error: -a needs the state file (-C)\n");
+		return -1;
+	}
+
+	if (record_path && (bts_scan || monitor_interval > 0.0)) {
+		fprintf(stderr, "error: recording (-w) takes one frequency (-f or -c)\n");
+		usage(argv[0]);
+	}
+
+	if(g_debug) {
+		printf("debug: Gain                 : %f\n", gain);
+	}
+
+	if (replay_path) {
+		u = replay = new replay_source(replay_path, gain);
+		u->set_oversampling(sps);
+		if (u->open() == -1) {
+			fprintf(stderr, "error: failed to open I/Q recording\n");
+			delete u;
+			return -1;
+		}
+		// Without -f/-c/-s, measure the recorded frequency
+		if (!bts_scan && freq < 0.0 && chan < 0)
+			freq = replay->file().meta().center_freq;
+		srcs.push_back(u);
+	} else {
+		// Results are saved per device: name the default one
+		if (serials.empty() && !bts_scan) {
+			uint64_t sn;
+
+			if (hydrasdr_list_devices(&sn, 1) == 1)
+				serials.push_back(sn);
+		}
+		if (serials.empty())
+			serials.push_back(0);
+
+		for (size_t i = 0; i < serials.size(); i++) {
+			hydrasdr_source *h = new hydrasdr_source(gain);
+			char name[24];
+
+			// One worker core per device when pinned
+			h->set_serial(serials[i]);
+			h->set_int16(use_int16);
+			h->set_sample_rate(native_rate);
+			h->set_oversampling(sps);
+			h->set_worker(use_worker, worker_cpu < 0 ? -1 : worker_cpu + (int)i, worker_prio);
+			srcs.push_back(h);
+			if(h->open() == -1) {
+				fprintf(stderr, "error: failed to open HydraSDR device\n");
+				result = -1;
+				goto cleanup;
+			}
+			snprintf(name, sizeof(name), "0x%016llX", (unsigned long long)serials[i]);
+			names.push_back(name);
+		}
+		for (size_t i = 0; i < names.size(); i++)
+			name_ptrs.push_back(names[i].c_str());
+		u = srcs[0];
 	}
 
 	if(bts_scan) {
@@ -283,7 +660,7 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "error: scanning requires band (-s)\n");
 			usage(argv[0]);
 		}
-	} else {
+	} else if (!auto_mode && !server_path) {
 		if(freq < 0.0) {
 			if(chan < 0) {
 				fprintf(stderr, "error: must enter scan band -s or channel -c or frequency -f or -R or -W to read or write calibration\n");
@@ -297,45 +674,130 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	for (size_t i = 0; i < srcs.size(); i++)
+		srcs[i]->set_resampler_engine(engine);
+	if (u->oversampling() != sps)
+		fprintf(stderr, "warning: %u samples per symbol not available here, using %u\n",
+			sps, u->oversampling());
 	if(g_debug) {
-		printf("debug: Gain                 : %f\n", gain);
+		printf("debug: Resampler engine     : %s at %.3f MSPS, %u sps (%.1f MACs/output)\n",
+		       dsp_engine_name(u->get_resampler()->engine()), u->native_rate() / 1e6,
+		       u->oversampling(), u->get_resampler()->macs_per_output());
+		if(use_worker && !replay)
+			printf("debug: Resampler worker     : cpu %d, priority %d\n", worker_cpu, worker_prio);
+		if(srcs.size() > 1)
+			printf("debug: Devices              : %zu\n", srcs.size());
+		printf("debug: Peak refinement      : %s\n", fcch_peak_mode_name((fcch_peak_mode)g_peak_mode));
+		if (!bts_scan) {
+			const offset_precision prec = offset_get_precision();
+
+			if (prec.ppb > 0.0)
+				printf("debug: Precision            : %.2f ppb after %u bursts%s\n", prec.ppb,
+				       prec.min_bursts, prec.pm_weight ? ", weighted by peak-to-mean" : "");
+			else
+				printf("debug: Precision            : 100 bursts\n");
+		}
+		if(bts_scan || auto_mode || server_path)
+			printf("debug: Power scan           : %s\n", c0_scan_mode_name(scan_mode));
+		printf("debug: FFT wisdom file      : %s\n", *fft_wisdom_path() ? fft_wisdom_path() : "(disabled)");
+		printf("debug: State file           : %s\n", *kal_state_path() ? kal_state_path() : "(disabled)");
+		if(replay) {
+			const iq_meta &m = replay->file().meta();
+			printf("debug: Replay               : %s, %s, %.3f kSPS at %.3f MHz, %.2f s\n",
+			       replay_path, iq_format_name(m.format), m.sample_rate / 1e3,
+			       m.center_freq / 1e6, m.samples / m.sample_rate);
+		}
 	}
 
-	u = new hydrasdr_source(gain);
-	if(!u) {
-		fprintf(stderr, "error: failed to allocate hydrasdr_source\n");
-		return -1;
+	if ((g_verbosity > 0 || g_debug) && kal_stats_dump_start(STATS_DUMP_INTERVAL, g_debug != 0)) {
+		result = -1;
+		goto cleanup;
 	}
 
-	if(u->open() == -1) {
-		fprintf(stderr, "error: failed to open HydraSDR device\n");
-		delete u;
-		return -1;
+	if (server_path) {
+		kal_server_config cfg;
+
+		if (replay)
+			serials.assign(1, 0);
+		cfg.path = server_path;
+		cfg.srcs = &srcs[0];
+		cfg.serials = &serials[0];
+		cfg.count = (unsigned int)srcs.size();
+		cfg.workers = (unsigned int)scan_workers;
+		cfg.mode = scan_mode;
+		cfg.version = PACKAGE_VERSION "-hydrasdr";
+		result = kal_server_run(&cfg);
+		goto cleanup;
+	}
+
+	if (auto_mode) {
+		warm_start_result w;
+
+		fprintf(stderr, "%s: Calculating clock frequency offset from the last results.\n",
+			basename(argv[0]));
+		result = warm_start_run(u, replay ? 0 : serials[0], bi, (unsigned int)scan_workers,
+					scan_mode, false, &w);
+		if (result && w.error)
+			fprintf(stderr, "error: %s\n", w.error);
+		else if (!result && !g_kal_exit_req)
+			result = offset_print(u, &w.res);
+		goto cleanup;
 	}
 
 	if(!bts_scan) {
-		if(u->tune(freq) == -1) {
-			fprintf(stderr, "error: hydrasdr_source::tune failed\n");
+		for (size_t i = 0; i < srcs.size(); i++) {
+			if(srcs[i]->tune(freq) == -1) {
+				fprintf(stderr, "error: hydrasdr_source::tune failed\n");
+				result = -1;
+				goto cleanup;
+			}
+		}
+
+		if (!u->covers(freq, WB_CHAN_HALF_BW)) {
+			fprintf(stderr, "error: %.1fMHz is not in the recording\n", freq / 1e6);
 			result = -1;
 			goto cleanup;
 		}
 
+		if (record_path) {
+			fprintf(stderr, "Recording %s channel %d (%.1fMHz)\n", bi_to_str(bi), chan, freq / 1e6);
+			result = iq_record(u, record_path, record_seconds, record_gsm);
+			goto cleanup;
+		}
+
 		float tuner_error = 0.0f;
 
 		fprintf(stderr, "%s: Calculating clock frequency offset.\n", basename(argv[0]));
 		fprintf(stderr, "Using %s channel %d (%.1fMHz)\n", bi_to_str(bi), chan, freq / 1e6);
 		
-		result = offset_detect(u, 0, tuner_error);
+		if (monitor_interval > 0.0)
+			result = offset_monitor(u, 0, tuner_error, monitor_interval, monitor_alpha);
+		else if (srcs.size() > 1)
+			result = offset_detect_multi(&srcs[0], &name_ptrs[0], (unsigned int)srcs.size(),
+						     0, tuner_error);
+		else {
+			offset_result res;
+
+			result = offset_detect(u, 0, tuner_error, &res);
+			if (!result && !g_kal_exit_req)
+				warm_start_save(replay ? 0 : serials[0], bi, chan, res);
+		}
 		goto cleanup;
 	}
 
 	fprintf(stderr, "%s: Scanning for %s base stations.\n", basename(argv[0]), bi_to_str(bi));
 
-	result = c0_detect(u, bi);
+	result = c0_detect(&srcs[0], (unsigned int)srcs.size(), bi, (unsigned int)scan_workers, scan_mode);
 
 cleanup:
-	if(u) {
-		delete u;
-	}
+	for (size_t i = 0; i < srcs.size(); i++)
+		delete srcs[i];
+
+	kal_stats_dump_stop();
+	if (g_verbosity > 0 || g_debug)
+		kal_stats_print(stderr, g_debug != 0);
+	if (bench_json && kal_stats_write_json(bench_json))
+		result = -1;
+	free(record_path);
 	return result;
 }
\ No newline at end of file
@@ -14,6 +14,8 @@
 extern int g_verbosity;
 extern int g_debug;
 extern int g_show_fft;
+extern int g_peak_mode;   /* fcch_peak_mode used by new detectors */
+extern int g_fcch_track;  /* predict FCCH bursts from frame timing (offset_detect) */
 extern volatile sig_atomic_t g_kal_exit_req;
 
 #endif /* KAL_GLOBALS_H */
@@ -0,0 +1,827 @@
+/**
+ * @file kal_server.cc
+ * @brief Implementation of the service mode.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#include "sample_source.h"
+#include "arfcn_freq.h"
+#include "wideband_scan.h"
+#include "offset.h"
+#include "kal_state.h"
+#include "warm_start.h"
+#include "kal_globals.h"
+#include "kal_server.h"
+
+#ifdef _WIN32
+
+int kal_server_run(const kal_server_config *cfg)
+{
+	(void)cfg;
+	fprintf(stderr, "error: server mode (-S) needs Unix domain sockets, not available on Windows\n");
+	return -1;
+}
+
+#else
+
+typedef std::chrono::steady_clock server_clock;
+
+/* Poll timeout: how often Ctrl-C is noticed while idle */
+static const int POLL_MS = 500;
+
+static double elapsed_ms(server_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(server_clock::now() - t0).count();
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Requests: one flat JSON object (string, number, true/false/null values)
+ * ---------------------------------------------------------------------------
+ */
+
+struct json_value {
+	std::string text;    // Unescaped string, or the literal as written
+	bool is_string;
+};
+
+typedef std::map<std::string, json_value> json_fields;
+
+static void skip_ws(const char **p)
+{
+	while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n')
+		(*p)++;
+}
+
+static int parse_string(const char **p, std::string *s)
+{
+	const char *c = *p;
+
+	if (*c++ != '"')
+		return -1;
+	s->clear();
+	for (; *c && *c != '"'; c++) {
+		if (*c != '\\') {
+			s->push_back(*c);
+			continue;
+		}
+		switch (*++c) {
+		case '"': case '\\': case '/': s->push_back(*c); break;
+		case 'b': s->push_back('\b'); break;
+		case 'f': s->push_back('\f'); break;
+		case 'n': s->push_back('\n'); break;
+		case 'r': s->push_back('\r'); break;
+		case 't': s->push_back('\t'); break;
+		case 'u': {
+			/* Only ASCII is meaningful in a request */
+			char hex[5];
+			unsigned long u;
+
+			for (int k = 1; k <= 4; k++) {
+				if (!isxdigit((unsigned char)c[k]))
+					return -1;
+			}
+			memcpy(hex, c + 1, 4);
+			hex[4] = '\0';
+			u = strtoul(hex, NULL, 16);
+			s->push_back(u < 0x80 ? (char)u : '?');
+			c += 4;
+			break;
+		}
+		default:
+			return -1;
+		}
+	}
+	if (*c != '"')
+		return -1;
+	*p = c + 1;
+	return 0;
+}
+
+/* true, false, null or a number as JSON spells it */
+static bool is_json_literal(const std::string &t)
+{
+	const char *c = t.c_str();
+
+	if (t == "true" || t == "false" || t == "null")
+		return true;
+	if (*c == '-')
+		c++;
+	if (*c == '0')
+		c++;
+	else if (isdigit((unsigned char)*c))
+		while (isdigit((unsigned char)*c)) c++;
+	else
+		return false;
+	if (*c == '.') {
+		if (!isdigit((unsigned char)*++c))
+			return false;
+		while (isdigit((unsigned char)*c)) c++;
+	}
+	if (*c == 'e' || *c == 'E') {
+		c++;
+		if (*c == '+' || *c == '-')
+			c++;
+		if (!isdigit((unsigned char)*c))
+			return false;
+		while (isdigit((unsigned char)*c)) c++;
+	}
+	return !*c;
+}
+
+static int parse_request(const char *line, json_fields *f)
+{
+	const char *p = line;
+	std::string key;
+	json_value v;
+
+	f->clear();
+	skip_ws(&p);
+	if (*p++ != '{')
+		return -1;
+	skip_ws(&p);
+	if (*p == '}') {
+		p++;
+	} else {
+		for (;;) {
+			skip_ws(&p);
+			if (parse_string(&p, &key))
+				return -1;
+			skip_ws(&p);
+			if (*p++ != ':')
+				return -1;
+			skip_ws(&p);
+			if (*p == '"') {
+				if (parse_string(&p, &v.text))
+					return -1;
+				v.is_string = true;
+			} else {
+				const char *t = p;
+
+				while (*p && !strchr(",} \t\r\n", *p))
+					p++;
+				v.text.assign(t, p - t);
+				if (!is_json_literal(v.text))
+					return -1;
+				v.is_string = false;
+			}
+			(*f)[key] = v;
+			skip_ws(&p);
+			if (*p == ',') {
+				p++;
+				continue;
+			}
+			if (*p++ != '}')
+				return -1;
+			break;
+		}
+	}
+	skip_ws(&p);
+	return *p ? -1 : 0;
+}
+
+static const json_value *field(const json_fields &f, const char *key)
+{
+	json_fields::const_iterator it = f.find(key);
+
+	return it == f.end() ? NULL : &it->second;
+}
+
+/* 1 if present and a number, 0 if absent, -1 if not a number */
+static int get_number(const json_fields &f, const char *key, double *v)
+{
+	const json_value *j = field(f, key);
+	char *end;
+
+	if (!j)
+		return 0;
+	if (j->is_string)
+		return -1;
+	*v = strtod(j->text.c_str(), &end);
+	return (*end || !std::isfinite(*v)) ? -1 : 1;
+}
+
+static const char *get_string(const json_fields &f, const char *key)
+{
+	const json_value *j = field(f, key);
+
+	return (j && j->is_string) ? j->text.c_str() : NULL;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Replies
+ * ---------------------------------------------------------------------------
+ */
+
+static void put_key(std::string *o, const char *key)
+{
+	const char last = o->empty() ? 0 : (*o)[o->size() - 1];
+
+	if (last && last != '{' && last != '[')
+		o->push_back(',');
+	if (key) {
+		o->push_back('"');
+		o->append(key);
+		o->append("\":");
+	}
+}
+
+static void put_string(std::string *o, const char *key, const char *s)
+{
+	char u[8];
+
+	put_key(o, key);
+	o->push_back('"');
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			o->push_back('\\');
+			o->push_back(*s);
+		} else if ((unsigned char)*s < 0x20) {
+			snprintf(u, sizeof(u), "\\u%04x", *s);
+			o->append(u);
+		} else {
+			o->push_back(*s);
+		}
+	}
+	o->push_back('"');
+}
+
+/* Non-finite values are not JSON numbers */
+static void put_number(std::string *o, const char *key, double v, const char *fmt = "%.6g")
+{
+	char b[32];
+
+	put_key(o, key);
+	if (std::isfinite(v)) {
+		snprintf(b, sizeof(b), fmt, v);
+		o->append(b);
+	} else {
+		o->append("null");
+	}
+}
+
+static void put_raw(std::string *o, const char *key, const char *raw)
+{
+	put_key(o, key);
+	o->append(raw);
+}
+
+static void put_serial(std::string *o, const char *key, uint64_t serial)
+{
+	char b[24];
+
+	snprintf(b, sizeof(b), "0x%016llX", (unsigned long long)serial);
+	put_string(o, key, b);
+}
+
+/* Fields of an offset measurement */
+static void put_result(std::string *o, const offset_result &r, double freq)
+{
+	put_number(o, "bursts", (double)r.bursts, "%.0f");
+	put_number(o, "windows", r.iterations, "%.0f");
+	put_number(o, "tracked", r.tracked, "%.0f");
+	put_number(o, "notfound", r.notfound, "%.0f");
+	put_number(o, "overruns", r.overruns, "%.0f");
+	if (!r.bursts)
+		return;
+	put_number(o, "offset", r.offset, "%.3f");
+	put_number(o, "stddev", r.stddev, "%.3f");
+	put_number(o, "se", r.se, "%.3f");
+	put_number(o, "se_ppb", r.se / freq * 1e9, "%.4f");
+	put_number(o, "min", r.min, "%.3f");
+	put_number(o, "max", r.max, "%.3f");
+	put_number(o, "ppm", r.ppm, "%.6f");
+	put_number(o, "ppb", r.ppm * 1000.0, "%.3f");
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Commands
+ * ---------------------------------------------------------------------------
+ */
+
+struct server {
+	const kal_server_config *cfg;
+	server_clock::time_point start;
+	unsigned long requests;
+	bool stop;
+};
+
+/* Source picked by "device": index or hex serial; -1 if unknown */
+static int pick_device(const server *sv, const json_fields &f, const char **error)
+{
+	const char *s = get_string(f, "device");
+	double v;
+	int r;
+
+	if (s) {
+		char *end;
+		unsigned long long sn = strtoull(s, &end, 16);
+
+		for (unsigned int i = 0; !*end && i < sv->cfg->count; i++) {
+			if (sv->cfg->serials[i] == sn)
+				return (int)i;
+		}
+		*error = "unknown device";
+		return -1;
+	}
+	if ((r = get_number(f, "device", &v)) == 0)
+		return 0;
+	if (r < 0 || v < 0 || v >= sv->cfg->count || v != floor(v)) {
+		*error = "unknown device";
+		return -1;
+	}
+	return (int)v;
+}
+
+/* "band" as a band indicator, BI_NOT_DEFINED if absent or "auto" */
+static int get_band(const json_fields &f, const char **error)
+{
+	const char *s = get_string(f, "band");
+	char name[32];
+	int bi;
+
+	if (!s || !strcmp(s, "auto"))
+		return BI_NOT_DEFINED;
+	snprintf(name, sizeof(name), "%s", s);
+	if ((bi = str_to_bi(name)) == -1) {
+		*error = "bad band";
+		return -1;
+	}
+	return bi;
+}
+
+/* Applies the -E settings of a request; restored by the caller */
+static int set_precision(const json_fields &f, const char **error)
+{
+	offset_precision p = offset_get_precision();
+	const json_value *pm = field(f, "pm");
+	double v;
+	int r;
+
+	if ((r = get_number(f, "ppb", &v)) < 0 || (r && v < 0.0))
+		goto bad;
+	if (r)
+		p.ppb = v;
+	if ((r = get_number(f, "min_bursts", &v)) < 0 || (r && (v < 2 || v > 1e6)))
+		goto bad;
+	if (r)
+		p.min_bursts = (unsigned int)v;
+	if (pm) {
+		if (pm->is_string || (pm->text != "true" && pm->text != "false"))
+			goto bad;
+		p.pm_weight = pm->text == "true";
+	}
+	offset_set_precision(&p);
+	return 0;
+bad:
+	*error = "bad precision";
+	return -1;
+}
+
+static int cmd_measure(server *sv, const json_fields &f, std::string *o, const char **error)
+{
+	const offset_precision saved = offset_get_precision();
+	server_clock::time_point t0 = server_clock::now();
+	int dev, bi, chan = -1, r;
+	double freq = -1.0, v, tune_ms;
+	offset_result res;
+	sample_source *u;
+
+	if ((dev = pick_device(sv, f, error)) < 0 || (bi = get_band(f, error)) < 0)
+		return -1;
+	u = sv->cfg->srcs[dev];
+
+	if ((r = get_number(f, "freq", &v)) > 0) {
+		freq = v;
+		chan = freq_to_arfcn(freq, &bi);
+	} else if (!r && (r = get_number(f, "chan", &v)) > 0 && v >= 0 && v == floor(v)) {
+		chan = (int)v;
+		freq = arfcn_to_freq(chan, &bi);
+	}
+	if (freq <= 0.0) {
+		*error = "measure needs a freq or a chan (and band)";
+		return -1;
+	}
+	if (!u->covers(freq, WB_CHAN_HALF_BW)) {
+		*error = "frequency not in the recording";
+		return -1;
+	}
+	if (u->tune(freq) == -1) {
+		*error = "tune failed";
+		return -1;
+	}
+	tune_ms = elapsed_ms(t0);
+
+	if (set_precision(f, error))
+		return -1;
+	r = offset_measure(u, 0, 0.0f, true, &res);
+	offset_set_precision(&saved);
+	if (r) {
+		*error = "measurement failed";
+		return -1;
+	}
+	if (!g_kal_exit_req)
+		warm_start_save(sv->cfg->serials[dev], bi, chan, res);
+
+	put_serial(o, "device", sv->cfg->serials[dev]);
+	if (bi != BI_NOT_DEFINED)
+		put_string(o, "band", bi_to_str(bi));
+	put_number(o, "chan", chan, "%.0f");
+	put_number(o, "freq", freq, "%.0f");
+	put_result(o, res, freq);
+	put_raw(o, "timings", "{");
+	put_number(o, "tune_ms", tune_ms, "%.1f");
+	put_number(o, "measure_ms", elapsed_ms(t0) - tune_ms, "%.1f");
+	o->push_back('}');
+
+	if (!res.bursts) {
+		*error = "no FCCH burst found";
+		return -1;
+	}
+	return 0;
+}
+
+static int cmd_calibrate(server *sv, const json_fields &f, std::string *o, const char **error)
+{
+	const offset_precision saved = offset_get_precision();
+	server_clock::time_point t0 = server_clock::now();
+	warm_start_result w;
+	int dev, bi, r;
+
+	if ((dev = pick_device(sv, f, error)) < 0 || (bi = get_band(f, error)) < 0)
+		return -1;
+	if (!*kal_state_path()) {
+		*error = "calibrate needs the state file";
+		return -1;
+	}
+	if (set_precision(f, error))
+		return -1;
+	r = warm_start_run(sv->cfg->srcs[dev], sv->cfg->serials[dev], bi, sv->cfg->workers,
+			   sv->cfg->mode, true, &w);
+	offset_set_precision(&saved);
+
+	put_serial(o, "device", sv->cfg->serials[dev]);
+	if (w.chan >= 0) {
+		int b = w.bi;
+		const double freq = arfcn_to_freq(w.chan, &b);
+
+		put_string(o, "band", bi_to_str(w.bi));
+		put_number(o, "chan", w.chan, "%.0f");
+		put_number(o, "freq", freq, "%.0f");
+		put_raw(o, "scanned", w.scanned ? "true" : "false");
+		if (!r)
+			put_result(o, w.res, freq);
+	}
+	put_raw(o, "timings", "{");
+	put_number(o, "total_ms", elapsed_ms(t0), "%.1f");
+	o->push_back('}');
+
+	if (r) {
+		*error = w.error ? w.error : "interrupted";
+		return -1;
+	}
+	if (!w.res.bursts) {
+		*error = "no FCCH burst found";
+		return -1;
+	}
+	return 0;
+}
+
+static int cmd_scan(server *sv, const json_fields &f, std::string *o, const char **error)
+{
+	server_clock::time_point t0 = server_clock::now();
+	std::vector<kal_c0> found;
+	c0_scan_mode mode = sv->cfg->mode;
+	unsigned int workers = sv->cfg->workers;
+	const char *m = get_string(f, "mode");
+	double v;
+	int bi, r;
+
+	if ((bi = get_band(f, error)) < 0)
+		return -1;
+	if (bi == BI_NOT_DEFINED) {
+		*error = "scan needs a band";
+		return -1;
+	}
+	if (m) {
+		if ((r = str_to_scan_mode(m)) < 0) {
+			*error = "bad scan mode";
+			return -1;
+		}
+		mode = (c0_scan_mode)r;
+	}
+	if ((r = get_number(f, "workers", &v)) < 0 || (r && (v < 1 || v > 64))) {
+		*error = "bad workers";
+		return -1;
+	}
+	if (r)
+		workers = (unsigned int)v;
+
+	if (c0_detect(sv->cfg->srcs, sv->cfg->count, bi, workers, mode, &found) ||
+	    g_kal_exit_req) {
+		*error = g_kal_exit_req ? "interrupted" : "band scan failed";
+		return -1;
+	}
+
+	put_string(o, "band", bi_to_str(bi));
+	put_string(o, "mode", c0_scan_mode_name(mode));
+	put_raw(o, "carriers", "[");
+	for (size_t i = 0; i < found.size(); i++) {
+		int b = bi;
+
+		put_raw(o, NULL, "{");
+		put_number(o, "chan", found[i].chan, "%.0f");
+		put_number(o, "freq", arfcn_to_freq(found[i].chan, &b), "%.0f");
+		put_number(o, "dbfs", found[i].dbfs, "%.1f");
+		put_number(o, "offset", found[i].offset, "%.1f");
+		o->push_back('}');
+	}
+	o->push_back(']');
+	put_raw(o, "timings", "{");
+	put_number(o, "total_ms", elapsed_ms(t0), "%.1f");
+	o->push_back('}');
+	return 0;
+}
+
+static int cmd_status(server *sv, std::string *o)
+{
+	const kal_server_config *cfg = sv->cfg;
+
+	put_string(o, "version", cfg->version);
+	put_number(o, "uptime_s", elapsed_ms(sv->start) / 1e3, "%.1f");
+	put_number(o, "requests", (double)sv->requests, "%.0f");
+	put_string(o, "state_file", kal_state_path());
+	put_raw(o, "devices", "[");
+	for (unsigned int i = 0; i < cfg->count; i++) {
+		put_raw(o, NULL, "{");
+		put_serial(o, "serial", cfg->serials[i]);
+		put_number(o, "native_rate", cfg->srcs[i]->native_rate(), "%.0f");
+		put_number(o, "sps", cfg->srcs[i]->oversampling(), "%.0f");
+		put_number(o, "center_freq", cfg->srcs[i]->center_freq(), "%.0f");
+		o->push_back('}');
+	}
+	o->push_back(']');
+	return 0;
+}
+
+/* One request line to one reply line */
+static std::string handle(server *sv, const char *line)
+{
+	server_clock::time_point t0 = server_clock::now();
+	std::string o = "{", body;
+	const char *error = NULL, *cmd = "";
+	json_fields f;
+	int r = -1;
+
+	sv->requests++;
+	if (parse_request(line, &f)) {
+		error = "bad request (one flat JSON object per line)";
+	} else {
+		const json_value *id = field(f, "id");
+
+		if (id) {
+			if (id->is_string)
+				put_string(&o, "id", id->text.c_str());
+			else
+				put_raw(&o, "id", id->text.c_str());
+		}
+		cmd = get_string(f, "cmd") ? get_string(f, "cmd") : "";
+		body = o;
+
+		if (!strcmp(cmd, "measure"))
+			r = cmd_measure(sv, f, &body, &error);
+		else if (!strcmp(cmd, "calibrate"))
+			r = cmd_calibrate(sv, f, &body, &error);
+		else if (!strcmp(cmd, "scan"))
+			r = cmd_scan(sv, f, &body, &error);
+		else if (!strcmp(cmd, "status"))
+			r = cmd_status(sv, &body);
+		else if (!strcmp(cmd, "shutdown")) {
+			sv->stop = true;
+			r = 0;
+		} else
+			error = "unknown cmd (measure, calibrate, scan, status, shutdown)";
+
+		// Partial results of a failed measurement are still worth returning
+		if (!r || body.size() > o.size())
+			o = body;
+	}
+
+	put_raw(&o, "ok", r ? "false" : "true");
+	if (*cmd)
+		put_string(&o, "cmd", cmd);
+	if (r)
+		put_string(&o, "error", error ? error : "failed");
+	o.append("}\n");
+
+	if (g_verbosity > 0)
+		fprintf(stderr, "server: %s %s (%.1f ms)\n", *cmd ? cmd : "?",
+			r ? (error ? error : "failed") : "ok", elapsed_ms(t0));
+	return o;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Socket loop
+ * ---------------------------------------------------------------------------
+ */
+
+struct client {
+	int fd;
+	std::string in;
+};
+
+static int send_all(int fd, const std::string &s)
+{
+	size_t done = 0;
+
+	while (done < s.size()) {
+		ssize_t n = send(fd, s.data() + done, s.size() - done, 0);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+static int open_socket(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat sb;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "error: socket path too long: '%s'\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		fprintf(stderr, "error: socket: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/*
+	 * A socket left by a server that died refuses connections: only that
+	 * one is removed. A live server keeps its endpoint, and nothing but
+	 * a socket is ever removed.
+	 */
+	if (!lstat(path, &sb) && S_ISSOCK(sb.st_mode)) {
+		if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+			fprintf(stderr, "error: '%s': already serving\n", path);
+			close(fd);
+			return -1;
+		}
+		if (errno != ECONNREFUSED) {
+			fprintf(stderr, "error: '%s': %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		close(fd);
+		unlink(path);
+		if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+			fprintf(stderr, "error: socket: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, KAL_SERVER_CLIENTS_MAX)) {
+		fprintf(stderr, "error: cannot listen on '%s': %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int kal_server_run(const kal_server_config *cfg)
+{
+	std::vector<client> clients;
+	std::vector<struct pollfd> pfd;
+	char buf[1024];
+	server sv;
+	int lfd;
+
+	if ((lfd = open_socket(cfg->path)) < 0)
+		return -1;
+#ifdef SIGPIPE
+	// A client gone before its reply must not stop the server
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	sv.cfg = cfg;
+	sv.start = server_clock::now();
+	sv.requests = 0;
+	sv.stop = false;
+	fprintf(stderr, "Serving %u device%s on '%s' (Ctrl-C to stop)\n", cfg->count,
+		cfg->count > 1 ? "s" : "", cfg->path);
+
+	while (!sv.stop && !g_kal_exit_req) {
+		pfd.resize(clients.size() + 1);
+		pfd[0].fd = lfd;
+		pfd[0].events = POLLIN;
+		for (size_t i = 0; i < clients.size(); i++) {
+			pfd[i + 1].fd = clients[i].fd;
+			pfd[i + 1].events = POLLIN;
+		}
+		if (poll(&pfd[0], pfd.size(), POLL_MS) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "error: poll: %s\n", strerror(errno));
+			break;
+		}
+
+		// Clients in connection order, each request served to completion
+		std::vector<char> drops(clients.size(), 0);
+		for (size_t i = 0; i < clients.size(); i++) {
+			client &c = clients[i];
+			bool drop = false;
+			size_t nl;
+
+			if (!pfd[i + 1].revents)
+				continue;
+			ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+			if (n <= 0) {
+				drop = !(n < 0 && errno == EINTR);
+			} else {
+				c.in.append(buf, (size_t)n);
+				while (!drop && !sv.stop && (nl = c.in.find('\n')) != std::string::npos) {
+					std::string line = c.in.substr(0, nl);
+
+					c.in.erase(0, nl + 1);
+					if (line.find_first_not_of(" \t\r") == std::string::npos)
+						continue;
+					drop = send_all(c.fd, handle(&sv, line.c_str())) != 0;
+				}
+				if (c.in.size() > KAL_SERVER_LINE_MAX) {
+					send_all(c.fd, "{\"ok\":false,\"error\":\"request too long\"}\n");
+					drop = true;
+				}
+			}
+			drops[i] = drop;
+		}
+		for (size_t i = clients.size(); i-- > 0; ) {
+			if (drops[i]) {
+				close(clients[i].fd);
+				clients.erase(clients.begin() + i);
+			}
+		}
+
+		if (pfd[0].revents & POLLIN) {
+			int fd = accept(lfd, NULL, NULL);
+
+			if (fd >= 0 && clients.size() >= KAL_SERVER_CLIENTS_MAX) {
+				send_all(fd, "{\"ok\":false,\"error\":\"too many clients\"}\n");
+				close(fd);
+			} else if (fd >= 0) {
+				client c;
+
+				c.fd = fd;
+				clients.push_back(c);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < clients.size(); i++)
+		close(clients[i].fd);
+	close(lfd);
+	unlink(cfg->path);
+	fprintf(stderr, "Server stopped after %lu requests\n", sv.requests);
+	return 0;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,72 @@
+/**
+ * @file kal_server.h
+ * @brief Long-running service mode (-S): requests over a local socket.
+ *
+ * A one-shot run opens the device, plans its FFTs, scans and exits. The
+ * server opens its sources once and keeps them, with their resamplers,
+ * the FFT plan cache, the band plans and the state file, for every
+ * request. Streaming only runs while a request needs samples, so an
+ * idle server puts no load on USB.
+ *
+ * Clients connect to a Unix domain stream socket and send one JSON
+ * object per line; each gets one JSON object per line back, in order.
+ * Requests from every client are served one at a time, so several
+ * clients can share one radio:
+ *
+ *     {"cmd": "measure", "chan": 58, "band": "EGSM"}    or "freq": Hz
+ *     {"cmd": "scan", "band": "EGSM", "mode": "wide"}
+ *     {"cmd": "calibrate", "band": "auto"}              -a warm start
+ *     {"cmd": "status"}
+ *     {"cmd": "shutdown"}
+ *
+ * measure and calibrate also take "device" (index or hex serial string,
+ * default the first source) and the -E settings "ppb", "min_bursts" and
+ * "pm". An "id" member is echoed back. Replies carry "ok" and either
+ * the results (offset, ppm, stddev, standard error, bursts, overruns,
+ * timings in ms) or "error".
+ *
+ * Not available on Windows (no Unix domain sockets in this build).
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __KAL_SERVER_H__
+#define __KAL_SERVER_H__
+
+#include <stdint.h>
+
+#include "c0_detect.h"
+
+class sample_source;
+
+/** @brief Longest request line accepted (bytes). */
+#define KAL_SERVER_LINE_MAX 4096
+
+/** @brief Most clients connected at once. */
+#define KAL_SERVER_CLIENTS_MAX 16
+
+/** @brief What the server serves. */
+struct kal_server_config {
+	const char *path;            /**< Socket path (replaced if stale) */
+	sample_source **srcs;        /**< Opened sources, all on the same antenna */
+	const uint64_t *serials;     /**< Serial of each source, 0 for a recording */
+	unsigned int count;          /**< Number of sources */
+	unsigned int workers;        /**< Default band scan FCCH threads */
+	c0_scan_mode mode;           /**< Default band scan method */
+	const char *version;         /**< Reported by status */
+};
+
+/**
+ * @brief Serves requests until shutdown or Ctrl-C.
+ * @return 0 on a clean stop, -1 if the socket could not be set up.
+ */
+int kal_server_run(const kal_server_config *cfg);
+
+#endif /* __KAL_SERVER_H__ */
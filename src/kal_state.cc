@@ -0,0 +1,265 @@
+/**
+ * @file kal_state.cc
+ * @brief Implementation of the persistent state file.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include "win_compat.h"
+#include <process.h>
+#define kal_getpid _getpid
+#else
+#include <unistd.h>
+#define kal_getpid getpid
+#endif
+
+#include "arfcn_freq.h"
+#include "kal_globals.h"
+#include "kal_state.h"
+
+/* Longest line kept from the file */
+static const unsigned int LINE_MAX_LEN = 256;
+
+static std::mutex s_mutex;
+static std::string s_path;
+static bool s_path_set = false;
+
+static void resolve_path_locked()
+{
+	const char *env, *home;
+
+	if (s_path_set)
+		return;
+	s_path_set = true;
+
+	if ((env = getenv(KAL_STATE_ENV))) {
+		s_path = env;
+		return;
+	}
+
+	home = getenv("HOME");
+	if (!home)
+		home = ".";
+	s_path = std::string(home) + "/" + KAL_STATE_DEFAULT_NAME;
+}
+
+/* Every line of the file, without its newline; empty without a file */
+static std::vector<std::string> read_lines_locked()
+{
+	std::vector<std::string> lines;
+	char line[LINE_MAX_LEN];
+	FILE *f;
+
+	if (s_path.empty() || !(f = fopen(s_path.c_str(), "r")))
+		return lines;
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = 0;
+		lines.push_back(line);
+	}
+	fclose(f);
+	return lines;
+}
+
+/* Parses a c0 record; returns its band indicator, -1 for other lines */
+static int parse_c0(const std::string &line, kal_c0 *c)
+{
+	char band[32];
+
+	if (sscanf(line.c_str(), "c0 %31s %d %lf %f", band, &c->chan, &c->dbfs, &c->offset) != 4)
+		return -1;
+	return str_to_bi(band);
+}
+
+/* Parses a result record; returns 0, -1 for other lines */
+static int parse_result(const std::string &line, kal_result *r)
+{
+	char band[32];
+	unsigned long long serial;
+
+	if (sscanf(line.c_str(), "result %llx %31s %d %lf %lf %lld", &serial, band, &r->chan,
+		   &r->ppm, &r->offset, &r->time) != 6)
+		return -1;
+	r->serial = serial;
+	r->bi = str_to_bi(band);
+	return 0;
+}
+
+/* Same scheme as the FFT wisdom file: temporary file, then rename */
+static int write_lines_locked(const std::vector<std::string> &lines)
+{
+	std::string tmp;
+	char suffix[32];
+	FILE *f;
+	int r = 0;
+
+	snprintf(suffix, sizeof(suffix), ".tmp.%ld", (long)kal_getpid());
+	tmp = s_path + suffix;
+
+	if (!(f = fopen(tmp.c_str(), "w"))) {
+		if (g_debug)
+			printf("debug: state not saved: cannot write '%s'\n", tmp.c_str());
+		return -1;
+	}
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (fprintf(f, "%s\n", lines[i].c_str()) < 0)
+			r = -1;
+	}
+	if (fclose(f) || r) {
+		remove(tmp.c_str());
+		if (g_debug)
+			printf("debug: state not saved: cannot write '%s'\n", tmp.c_str());
+		return -1;
+	}
+
+#ifdef _WIN32
+	if (!MoveFileExA(tmp.c_str(), s_path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+	if (rename(tmp.c_str(), s_path.c_str())) {
+#endif
+		remove(tmp.c_str());
+		if (g_debug)
+			printf("debug: state not saved: cannot replace '%s'\n", s_path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------------
+ */
+
+void kal_state_set_path(const char *path)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (!path) {
+		s_path_set = false;
+		s_path.clear();
+		return;
+	}
+	s_path = path;
+	s_path_set = true;
+}
+
+const char *kal_state_path()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	resolve_path_locked();
+	return s_path.c_str();
+}
+
+unsigned int kal_state_load_c0(int bi, std::vector<kal_c0> *c0)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::vector<std::string> lines;
+	kal_c0 c;
+
+	c0->clear();
+	resolve_path_locked();
+	lines = read_lines_locked();
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (parse_c0(lines[i], &c) == bi)
+			c0->push_back(c);
+	}
+
+	if (g_debug && !s_path.empty())
+		printf("debug: state: %zu known %s carriers in '%s'\n", c0->size(), bi_to_str(bi),
+		       s_path.c_str());
+	return (unsigned int)c0->size();
+}
+
+int kal_state_save_c0(int bi, const std::vector<kal_c0> &c0)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::vector<std::string> lines, out;
+	char line[LINE_MAX_LEN];
+	kal_c0 c;
+
+	resolve_path_locked();
+	if (s_path.empty())
+		return 0;
+
+	// Keep everything but this band's carriers
+	lines = read_lines_locked();
+	if (lines.empty())
+		out.push_back("# kal state");
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (parse_c0(lines[i], &c) != bi)
+			out.push_back(lines[i]);
+	}
+	for (size_t i = 0; i < c0.size(); i++) {
+		snprintf(line, sizeof(line), "c0 %s %d %.1f %.1f", bi_to_str(bi), c0[i].chan,
+			 c0[i].dbfs, c0[i].offset);
+		out.push_back(line);
+	}
+
+	if (write_lines_locked(out))
+		return -1;
+	if (g_debug)
+		printf("debug: state: %zu %s carriers saved to '%s'\n", c0.size(), bi_to_str(bi),
+		       s_path.c_str());
+	return 0;
+}
+
+int kal_state_load_result(uint64_t serial, kal_result *r)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::vector<std::string> lines;
+
+	resolve_path_locked();
+	lines = read_lines_locked();
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (!parse_result(lines[i], r) && r->serial == serial && r->bi > 0)
+			return 0;
+	}
+	return -1;
+}
+
+int kal_state_save_result(const kal_result &r)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::vector<std::string> lines, out;
+	char line[LINE_MAX_LEN];
+	kal_result old;
+
+	resolve_path_locked();
+	if (s_path.empty())
+		return 0;
+
+	// Keep everything but this device's result
+	lines = read_lines_locked();
+	if (lines.empty())
+		out.push_back("# kal state");
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (parse_result(lines[i], &old) || old.serial != r.serial)
+			out.push_back(lines[i]);
+	}
+	snprintf(line, sizeof(line), "result %016llx %s %d %.4f %.2f %lld",
+		 (unsigned long long)r.serial, bi_to_str(r.bi), r.chan, r.ppm, r.offset, r.time);
+	out.push_back(line);
+
+	if (write_lines_locked(out))
+		return -1;
+	if (g_debug)
+		printf("debug: state: result of %016llx saved to '%s'\n", (unsigned long long)r.serial,
+		       s_path.c_str());
+	return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file kal_state.h
+ * @brief Persistent state kept between runs (C0 carriers, last results).
+ *
+ * A band scan records the C0 carriers it found, per band, so the next
+ * scan of that band visits them first instead of after every weaker
+ * candidate below them in frequency. An offset measurement records its
+ * result per device, so -a can go straight to a known carrier.
+ *
+ * The file is plain text, one record per line, so it can be read and
+ * edited by hand:
+ *
+ *     # kal state
+ *     c0 <band> <arfcn> <power dBFS> <offset Hz>
+ *     result <serial> <band> <arfcn> <ppm> <offset Hz> <unix time>
+ *
+ * with band as printed by bi_to_str() and serial in hex (0 for a
+ * replayed recording). Unknown records are kept when the file is
+ * rewritten. Writes go to a temporary file renamed over the old
+ * one, so a reader never sees a partial file.
+ *
+ * File location, first match wins:
+ * - kal_state_set_path() (command line -C)
+ * - KAL_STATE environment variable
+ * - $HOME/.kal_state
+ * An empty path disables reading and writing the state.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __KAL_STATE_H__
+#define __KAL_STATE_H__
+
+#include <stdint.h>
+#include <vector>
+
+/** @brief Name of the default state file in $HOME. */
+#define KAL_STATE_DEFAULT_NAME ".kal_state"
+
+/** @brief Environment variable overriding the state file path. */
+#define KAL_STATE_ENV "KAL_STATE"
+
+/** @brief One C0 carrier found by a band scan. */
+struct kal_c0 {
+	int chan;       /**< ARFCN */
+	double dbfs;    /**< Power when found */
+	float offset;   /**< FCCH offset from GSM_RATE / 4 (Hz) */
+};
+
+/** @brief Last offset measurement of a device. */
+struct kal_result {
+	uint64_t serial;   /**< Device serial, 0 for a replayed recording */
+	int bi;            /**< Band indicator of the channel */
+	int chan;          /**< ARFCN */
+	double ppm;        /**< Clock error */
+	double offset;     /**< Trimmed mean FCCH offset (Hz) */
+	long long time;    /**< When it was measured (Unix time) */
+};
+
+/**
+ * @brief Overrides the state file path (takes precedence over the
+ *        environment).
+ * @param path File path, "" to disable the state file, NULL for default.
+ */
+void kal_state_set_path(const char *path);
+
+/** @brief Returns the state file path in use ("" if disabled). */
+const char *kal_state_path();
+
+/**
+ * @brief Reads the C0 carriers last found in a band.
+ * @param bi Band indicator.
+ * @param c0 Output: carriers in file order (cleared first).
+ * @return Number of carriers, 0 without a file or none for the band.
+ */
+unsigned int kal_state_load_c0(int bi, std::vector<kal_c0> *c0);
+
+/**
+ * @brief Replaces the C0 carriers of a band and rewrites the file.
+ * @param bi Band indicator.
+ * @param c0 Carriers found by the last scan of the band.
+ * @return 0 on success (or state disabled), -1 if the file could not be
+ *         written.
+ */
+int kal_state_save_c0(int bi, const std::vector<kal_c0> &c0);
+
+/**
+ * @brief Reads the last result of a device.
+ * @param serial Device serial.
+ * @param r      Output: the result.
+ * @return 0 if found, -1 without a file or no result for the device.
+ */
+int kal_state_load_result(uint64_t serial, kal_result *r);
+
+/**
+ * @brief Replaces the result of r.serial and rewrites the file.
+ * @return 0 on success (or state disabled), -1 if the file could not be
+ *         written.
+ */
+int kal_state_save_result(const kal_result &r);
+
+#endif /* __KAL_STATE_H__ */
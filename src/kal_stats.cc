@@ -0,0 +1,272 @@
+/**
+ * @file kal_stats.cc
+ * @brief Implementation of the pipeline statistics snapshot, dumps and JSON summary.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <math.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "kal_stats.h"
+#include "sample_source.h"
+
+/*
+ * ---------------------------------------------------------------------------
+ * Histogram
+ * ---------------------------------------------------------------------------
+ */
+
+void stats_histogram::reset()
+{
+	for (unsigned int b = 0; b < STATS_HIST_BUCKETS; b++)
+		m_bucket[b].store(0, std::memory_order_relaxed);
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+double stats_histogram::percentile(double p) const
+{
+	uint64_t n = 0, total = 0;
+	uint64_t b[STATS_HIST_BUCKETS];
+
+	/* Snapshot: buckets may move while being read, count them once */
+	for (unsigned int i = 0; i < STATS_HIST_BUCKETS; i++) {
+		b[i] = m_bucket[i].load(std::memory_order_relaxed);
+		total += b[i];
+	}
+	if (!total)
+		return 0.0;
+
+	const double rank = p / 100.0 * total;
+	for (unsigned int i = 0; i < STATS_HIST_BUCKETS; i++) {
+		n += b[i];
+		if (n >= rank && b[i]) {
+			double v = ldexp(M_SQRT2, (int)i);
+			return (std::min)(v, (double)max());
+		}
+	}
+	return (double)max();
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Statistics
+ * ---------------------------------------------------------------------------
+ */
+
+void kal_stats::reset()
+{
+	callback_ns.reset();
+	interval_ns.reset();
+	resample_ns.reset();
+	fcch_scan_ns.reset();
+
+	resample_samples = 0;
+	input_rate = SAMPLE_SOURCE_INPUT_RATE;
+	ring_capacity = 0;
+	ring_high = 0;
+	drops_usb = 0;
+	drops_dsp = 0;
+	drops_ring = 0;
+	fcch_found = 0;
+	fcch_tracks = 0;
+	fcch_tracked = 0;
+	fcch_regions = 0;
+	fcch_ffts = 0;
+	fcch_batches = 0;
+	fcch_bursts = 0;
+	fcch_prescreens = 0;
+	fcch_prescreened = 0;
+}
+
+/* Derived figures of one snapshot */
+struct stats_view {
+	double callback_duty;      // Fraction of the time spent in the callback
+	double ns_per_sample;      // Resampler cost
+	double resample_load;      // Fraction of one core the resampler needs in real time
+	double ring_high_pct;
+	double regions_per_scan;
+	double ffts_per_detection;
+	uint64_t detections;
+};
+
+static stats_view view(const kal_stats &s)
+{
+	stats_view v;
+	const uint64_t samples = s.resample_samples.load();
+	const uint64_t cap = s.ring_capacity.load();
+	const uint64_t scans = s.fcch_scan_ns.count();
+
+	v.callback_duty = s.interval_ns.sum() ? (double)s.callback_ns.sum() / s.interval_ns.sum() : 0.0;
+	v.ns_per_sample = samples ? (double)s.resample_ns.sum() / samples : 0.0;
+	v.resample_load = v.ns_per_sample * 1e-9 * s.input_rate.load();
+	v.ring_high_pct = cap ? 100.0 * s.ring_high.load() / cap : 0.0;
+	v.regions_per_scan = scans ? (double)s.fcch_regions.load() / scans : 0.0;
+	v.detections = s.fcch_found.load() + s.fcch_tracked.load();
+	v.ffts_per_detection = v.detections ? (double)s.fcch_ffts.load() / v.detections : 0.0;
+	return v;
+}
+
+static void print_hist(FILE *f, const char *name, const stats_histogram &h)
+{
+	fprintf(f, "  %-18s %9llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+		(unsigned long long)h.count(), h.mean() / 1e3, h.percentile(50) / 1e3,
+		h.percentile(90) / 1e3, h.percentile(99) / 1e3, h.max() / 1e3);
+}
+
+void kal_stats_print(FILE *f, bool full)
+{
+	const kal_stats &s = g_stats;
+	stats_view v = view(s);
+
+	if (!full) {
+		fprintf(f, "stats: callback %.0f us (max %.0f) every %.1f ms, resampler %.2f ns/sample "
+			"(%.1f%% of real time), ring high %.1f%%, drops usb %llu dsp %llu ring %llu, "
+			"fcch %llu scans (%.0f us) %.1f regions/scan %.1f FFTs/detection\n",
+			s.callback_ns.mean() / 1e3, s.callback_ns.max() / 1e3, s.interval_ns.mean() / 1e6,
+			v.ns_per_sample, 100.0 * v.resample_load, v.ring_high_pct,
+			(unsigned long long)s.drops_usb.load(), (unsigned long long)s.drops_dsp.load(),
+			(unsigned long long)s.drops_ring.load(), (unsigned long long)s.fcch_scan_ns.count(),
+			s.fcch_scan_ns.mean() / 1e3, v.regions_per_scan, v.ffts_per_detection);
+		return;
+	}
+
+	fprintf(f, "stats:\n");
+	fprintf(f, "  %-18s %9s %10s %10s %10s %10s %10s\n", "(us)", "count", "mean", "p50", "p90", "p99", "max");
+	print_hist(f, "callback", s.callback_ns);
+	print_hist(f, "callback interval", s.interval_ns);
+	print_hist(f, "resampler block", s.resample_ns);
+	print_hist(f, "fcch scan", s.fcch_scan_ns);
+	fprintf(f, "  callback duty      %.2f%%\n", 100.0 * v.callback_duty);
+	fprintf(f, "  resampler          %.2f ns/sample, %.1f%% of one core at %.1f MSPS (%llu samples)\n",
+		v.ns_per_sample, 100.0 * v.resample_load, s.input_rate.load() / 1e6,
+		(unsigned long long)s.resample_samples.load());
+	fprintf(f, "  ring high-water    %llu / %llu samples (%.1f%%)\n",
+		(unsigned long long)s.ring_high.load(), (unsigned long long)s.ring_capacity.load(),
+		v.ring_high_pct);
+	fprintf(f, "  drops              usb %llu, dsp %llu, ring %llu\n",
+		(unsigned long long)s.drops_usb.load(), (unsigned long long)s.drops_dsp.load(),
+		(unsigned long long)s.drops_ring.load());
+	fprintf(f, "  fcch               %llu found, %llu/%llu tracked, %.2f regions/scan, %.2f FFTs/detection\n",
+		(unsigned long long)s.fcch_found.load(), (unsigned long long)s.fcch_tracked.load(),
+		(unsigned long long)s.fcch_tracks.load(), v.regions_per_scan, v.ffts_per_detection);
+	fprintf(f, "  fcch batches       %llu batched FFT calls, %llu bursts from scan_all()\n",
+		(unsigned long long)s.fcch_batches.load(), (unsigned long long)s.fcch_bursts.load());
+	fprintf(f, "  fcch prescreen     %llu/%llu passed\n",
+		(unsigned long long)s.fcch_prescreened.load(), (unsigned long long)s.fcch_prescreens.load());
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Periodic Dump
+ * ---------------------------------------------------------------------------
+ */
+
+static std::thread dump_thread;
+static std::mutex dump_mutex;
+static std::condition_variable dump_cv;
+static bool dump_exit;
+
+int kal_stats_dump_start(double interval, bool full)
+{
+	if (dump_thread.joinable())
+		return 0;
+
+	dump_exit = false;
+	try {
+		dump_thread = std::thread([interval, full] {
+			std::unique_lock<std::mutex> lock(dump_mutex);
+			const std::chrono::milliseconds period((long long)(interval * 1e3));
+
+			while (!dump_cv.wait_for(lock, period, [] { return dump_exit; }))
+				kal_stats_print(stderr, full);
+		});
+	} catch (const std::exception& e) {
+		fprintf(stderr, "Failed to start stats dump: %s\n", e.what());
+		return -1;
+	}
+	return 0;
+}
+
+void kal_stats_dump_stop()
+{
+	if (!dump_thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(dump_mutex);
+		dump_exit = true;
+	}
+	dump_cv.notify_all();
+	dump_thread.join();
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * JSON Summary
+ * ---------------------------------------------------------------------------
+ */
+
+static void json_hist(FILE *f, const char *name, const stats_histogram &h, bool last = false)
+{
+	fprintf(f, "  \"%s\": {\"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+		"\"p99\": %.3f, \"max\": %.3f}%s\n", name, (unsigned long long)h.count(),
+		h.mean() / 1e3, h.percentile(50) / 1e3, h.percentile(90) / 1e3,
+		h.percentile(99) / 1e3, h.max() / 1e3, last ? "" : ",");
+}
+
+int kal_stats_write_json(const char *path)
+{
+	const kal_stats &s = g_stats;
+	stats_view v = view(s);
+	FILE *f = fopen(path, "w");
+
+	if (!f) {
+		fprintf(stderr, "error: cannot write '%s'\n", path);
+		return -1;
+	}
+
+	fprintf(f, "{\n  \"unit\": \"us\",\n");
+	json_hist(f, "callback", s.callback_ns);
+	json_hist(f, "callback_interval", s.interval_ns);
+	json_hist(f, "resampler_block", s.resample_ns);
+	json_hist(f, "fcch_scan", s.fcch_scan_ns);
+	fprintf(f, "  \"callback_duty\": %.6f,\n", v.callback_duty);
+	fprintf(f, "  \"resampler\": {\"samples\": %llu, \"ns_per_sample\": %.4f, \"realtime_load\": %.6f},\n",
+		(unsigned long long)s.resample_samples.load(), v.ns_per_sample, v.resample_load);
+	fprintf(f, "  \"ring\": {\"capacity\": %llu, \"high_water\": %llu},\n",
+		(unsigned long long)s.ring_capacity.load(), (unsigned long long)s.ring_high.load());
+	fprintf(f, "  \"drops\": {\"usb\": %llu, \"dsp\": %llu, \"ring\": %llu},\n",
+		(unsigned long long)s.drops_usb.load(), (unsigned long long)s.drops_dsp.load(),
+		(unsigned long long)s.drops_ring.load());
+	fprintf(f, "  \"fcch\": {\"found\": %llu, \"tracks\": %llu, \"tracked\": %llu, \"regions\": %llu, "
+		"\"ffts\": %llu, \"batches\": %llu, \"bursts\": %llu, \"regions_per_scan\": %.4f, "
+		"\"ffts_per_detection\": %.4f, \"prescreens\": %llu, \"prescreened\": %llu}\n}\n",
+		(unsigned long long)s.fcch_found.load(), (unsigned long long)s.fcch_tracks.load(),
+		(unsigned long long)s.fcch_tracked.load(), (unsigned long long)s.fcch_regions.load(),
+		(unsigned long long)s.fcch_ffts.load(), (unsigned long long)s.fcch_batches.load(),
+		(unsigned long long)s.fcch_bursts.load(), v.regions_per_scan, v.ffts_per_detection,
+		(unsigned long long)s.fcch_prescreens.load(), (unsigned long long)s.fcch_prescreened.load());
+
+	if (fclose(f)) {
+		fprintf(stderr, "error: cannot write '%s'\n", path);
+		return -1;
+	}
+	return 0;
+}
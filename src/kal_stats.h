@@ -0,0 +1,149 @@
+/**
+ * @file kal_stats.h
+ * @brief Lock-free receive pipeline counters and duration histograms.
+ *
+ * The hot paths (USB callback, resampler, ring, FCCH detector) only do
+ * relaxed atomic adds into g_stats, so they never block and never
+ * contend on a lock. Readers take a snapshot at any time:
+ *
+ * - kal_stats_print(): a one-line summary, or a table with -D.
+ * - kal_stats_dump_start(): the same printed periodically from a thread.
+ * - kal_stats_write_json(): the machine-readable summary written at exit.
+ *
+ * Counters are process-wide: with several devices (-d) they add up.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __KAL_STATS_H__
+#define __KAL_STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+/** @brief Seconds between the -v / -D periodic dumps. */
+#define STATS_DUMP_INTERVAL 5.0
+
+/** @brief Histogram buckets: bucket b counts durations in [2^b, 2^(b+1)) ns. */
+#define STATS_HIST_BUCKETS 40
+
+/** @brief Monotonic time in nanoseconds, for the durations below. */
+static inline uint64_t stats_now_ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** @brief Raises a high-water mark (lock-free). */
+static inline void stats_max(std::atomic<uint64_t> &m, uint64_t v)
+{
+	uint64_t cur = m.load(std::memory_order_relaxed);
+
+	while (v > cur && !m.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+		;
+}
+
+/**
+ * @brief Log2 histogram of durations, safe to update from any thread.
+ */
+class stats_histogram {
+public:
+	stats_histogram() { reset(); }
+
+	/** @brief Records one duration (ns). */
+	void add(uint64_t ns) {
+		unsigned int b = 0;
+
+		while (b + 1 < STATS_HIST_BUCKETS && (ns >> (b + 1)))
+			b++;
+		m_bucket[b].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(ns, std::memory_order_relaxed);
+		stats_max(m_max, ns);
+	}
+
+	void reset();
+
+	uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+	uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+	double mean() const { return count() ? (double)sum() / count() : 0.0; }
+
+	/**
+	 * @brief Estimated percentile (ns): geometric middle of the bucket
+	 *        holding it, at most max().
+	 * @param p Percentile, 0-100.
+	 */
+	double percentile(double p) const;
+
+private:
+	std::atomic<uint64_t> m_bucket[STATS_HIST_BUCKETS];
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sum;
+	std::atomic<uint64_t> m_max;
+};
+
+/**
+ * @brief Receive pipeline statistics (see g_stats).
+ */
+struct kal_stats {
+	stats_histogram callback_ns;    /**< USB callback duration */
+	stats_histogram interval_ns;    /**< Time between USB callbacks of a device */
+	stats_histogram resample_ns;    /**< Resampler time per block */
+	std::atomic<uint64_t> resample_samples;  /**< Input samples resampled */
+	std::atomic<uint64_t> input_rate;        /**< Resampler input rate (Hz, last source opened) */
+
+	std::atomic<uint64_t> ring_capacity;     /**< Output ring size (samples) */
+	std::atomic<uint64_t> ring_high;         /**< Ring fill high-water mark (samples) */
+
+	std::atomic<uint64_t> drops_usb;         /**< Dropped by the hardware / driver */
+	std::atomic<uint64_t> drops_dsp;         /**< Worker pool exhausted */
+	std::atomic<uint64_t> drops_ring;        /**< Output ring full */
+
+	stats_histogram fcch_scan_ns;            /**< fcch_detector::scan() duration */
+	std::atomic<uint64_t> fcch_found;        /**< Successful scan() and scan_all() calls */
+	std::atomic<uint64_t> fcch_tracks;       /**< track() calls */
+	std::atomic<uint64_t> fcch_tracked;      /**< Successful track() calls */
+	std::atomic<uint64_t> fcch_regions;      /**< Low error regions tested by scan() */
+	std::atomic<uint64_t> fcch_ffts;         /**< FFTs, one per transform of a batch */
+	std::atomic<uint64_t> fcch_batches;      /**< Batched FFT calls of scan_all() */
+	std::atomic<uint64_t> fcch_bursts;       /**< Bursts reported by scan_all() */
+	std::atomic<uint64_t> fcch_prescreens;   /**< fcch_detector::prescreen() calls */
+	std::atomic<uint64_t> fcch_prescreened;  /**< prescreen() calls passed on to scan() */
+
+	kal_stats() { reset(); }
+	void reset();
+};
+
+/** @brief Process-wide pipeline statistics (defined in kal.cc). */
+extern kal_stats g_stats;
+
+/**
+ * @brief Prints a snapshot of g_stats.
+ * @param full One line when false, one line per figure with percentiles when true.
+ */
+void kal_stats_print(FILE *f, bool full);
+
+/**
+ * @brief Prints g_stats to stderr every interval seconds until kal_stats_dump_stop().
+ * @return 0 on success, -1 if the thread could not be started.
+ */
+int kal_stats_dump_start(double interval, bool full);
+void kal_stats_dump_stop();
+
+/**
+ * @brief Writes g_stats as JSON.
+ * @return 0 on success, -1 on failure (error printed to stderr).
+ */
+int kal_stats_write_json(const char *path);
+
+#endif /* __KAL_STATS_H__ */
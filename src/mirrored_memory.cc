@@ -0,0 +1,133 @@
+/**
+ * @file mirrored_memory.cc
+ * @brief Double mapping of one buffer (Windows/Linux/MacOS).
+ */
+
+/*
+ * @author Joshua Lackey (original)
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com> (improvements)
+ * @copyright 2010 Joshua Lackey, 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include "mirrored_memory.h"
+
+#include <stdlib.h>
+#include <stdexcept>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// Windows Implementation
+// ----------------------------------------------------------------------------
+#ifdef _WIN32
+mirrored_memory::mirrored_memory(unsigned int min_size) {
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	unsigned int granularity = sysInfo.dwAllocationGranularity;
+
+	m_size = (min_size + granularity - 1) & ~(granularity - 1);
+
+	d_handle = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, m_size, NULL);
+	if (!d_handle) throw std::runtime_error("mirrored_memory: CreateFileMapping failed");
+
+	LPVOID desired_base = VirtualAlloc(NULL, 2 * m_size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!desired_base) {
+		CloseHandle(d_handle);
+		throw std::runtime_error("mirrored_memory: VirtualAlloc reserve failed");
+	}
+	VirtualFree(desired_base, 0, MEM_RELEASE);
+
+	d_first_copy = MapViewOfFileEx(d_handle, FILE_MAP_WRITE, 0, 0, m_size, desired_base);
+	if (d_first_copy != desired_base) {
+		CloseHandle(d_handle);
+		throw std::runtime_error("mirrored_memory: MapViewOfFileEx (1) failed");
+	}
+
+	d_second_copy = MapViewOfFileEx(d_handle, FILE_MAP_WRITE, 0, 0, m_size, (char*)desired_base + m_size);
+	if (d_second_copy != (char*)desired_base + m_size) {
+		UnmapViewOfFile(d_first_copy);
+		CloseHandle(d_handle);
+		throw std::runtime_error("mirrored_memory: MapViewOfFileEx (2) failed");
+	}
+
+	m_base = (char*)d_first_copy;
+}
+
+mirrored_memory::~mirrored_memory() {
+	UnmapViewOfFile(d_second_copy);
+	UnmapViewOfFile(d_first_copy);
+	CloseHandle(d_handle);
+}
+
+#else
+// ----------------------------------------------------------------------------
+// POSIX Implementation
+// ----------------------------------------------------------------------------
+mirrored_memory::mirrored_memory(unsigned int min_size) {
+	long page_size = sysconf(_SC_PAGESIZE);
+	if (page_size < 0) page_size = 4096;
+
+	m_size = (min_size + page_size - 1) & ~(page_size - 1);
+
+	/*
+	 * Anonymous memory file where the kernel has one (no /tmp entry, no
+	 * tmpfs quota), otherwise an unlinked temporary file.
+	 */
+	m_shm_fd = -1;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	m_shm_fd = memfd_create("kal.ring", MFD_CLOEXEC);
+#endif
+	if (m_shm_fd < 0) {
+		char tmp_path[] = "/tmp/kal.shm.XXXXXX";
+		m_shm_fd = mkstemp(tmp_path);
+		if (m_shm_fd < 0) throw std::runtime_error("mirrored_memory: mkstemp failed");
+		unlink(tmp_path);
+	}
+
+	if (ftruncate(m_shm_fd, m_size) < 0) {
+		close(m_shm_fd);
+		throw std::runtime_error("mirrored_memory: ftruncate failed");
+	}
+
+	void *reserve_addr = mmap(NULL, 2 * m_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (reserve_addr == MAP_FAILED) {
+		close(m_shm_fd);
+		throw std::runtime_error("mirrored_memory: mmap reserve failed");
+	}
+
+	void *first_map = mmap(reserve_addr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_shm_fd, 0);
+	if (first_map != reserve_addr) {
+		munmap(reserve_addr, 2 * m_size);
+		close(m_shm_fd);
+		throw std::runtime_error("mirrored_memory: mmap copy 1 failed");
+	}
+
+	void *second_map = mmap((char*)reserve_addr + m_size, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_shm_fd, 0);
+	if (second_map != (char*)reserve_addr + m_size) {
+		munmap(reserve_addr, 2 * m_size);
+		close(m_shm_fd);
+		throw std::runtime_error("mirrored_memory: mmap copy 2 failed");
+	}
+
+	m_base = (char*)reserve_addr;
+}
+
+mirrored_memory::~mirrored_memory() {
+	munmap(m_base, 2 * m_size);
+	close(m_shm_fd);
+}
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file mirrored_memory.h
+ * @brief Physical buffer mapped twice back-to-back in virtual memory.
+ *
+ * Shared by the ring buffers: any span of up to size() bytes starting
+ * anywhere in the first copy is contiguous, so reads and writes never
+ * need manual wrapping logic.
+ */
+
+/*
+ * @author Joshua Lackey (original)
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com> (improvements)
+ * @copyright 2010 Joshua Lackey, 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+#ifndef __MIRRORED_MEMORY_H__
+#define __MIRRORED_MEMORY_H__
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class mirrored_memory {
+public:
+	/**
+	 * @brief Maps at least min_size bytes twice.
+	 *
+	 * The size is rounded up to the page size (allocation granularity
+	 * on Windows).
+	 *
+	 * @throws std::runtime_error if the mapping cannot be created.
+	 */
+	mirrored_memory(unsigned int min_size);
+	~mirrored_memory();
+
+	/** @brief Start of the first copy (2 * size() bytes are valid). */
+	char *base() { return m_base; }
+
+	/** @brief Size of one copy in bytes. */
+	unsigned int size() const { return m_size; }
+
+private:
+	char *m_base;
+	unsigned int m_size;
+
+#ifdef _WIN32
+	HANDLE d_handle;
+	LPVOID d_first_copy;
+	LPVOID d_second_copy;
+#else
+	int m_shm_fd;
+#endif
+};
+
+#endif // __MIRRORED_MEMORY_H__
@@ -14,6 +14,9 @@
 #include <string.h>
 #include <math.h>
 #include <signal.h> // For sig_atomic_t
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include "win_compat.h"
@@ -25,180 +28,588 @@
 #include <sys/time.h>
 #endif
 
-#include "hydrasdr_source.h"
+#include "sample_source.h"
 #include "fcch_detector.h"
-#include "circular_buffer.h"
+#include "spsc_buffer.h"
+#include "offset_stats.h"
 #include "util.h"
 #include "kal_globals.h"
+#include "offset.h"
 
 static const unsigned int TARGET_COUNT = 100; // We want 100 good samples
 static const unsigned int MAX_ITERATIONS = 500; // But quit if we process 500 frames without success
 
+// Bursts behind the running median and trimmed mean in monitor mode
+static const unsigned int MONITOR_WINDOW = 100;
+
+// FCCH frame spacing in the 51-multiframe: 10, 10, 10, 10 then 11 frames
+static const unsigned int FCCH_GAP = 10;
+static const unsigned int FCCH_PER_MULTIFRAME = 5;
+
+// Symbols dropped at each end of a predicted burst (timing slack)
+static const float TRACK_GUARD = 8.0f;
+
+// Bursts taken from one search window (12 frames hold one or two)
+static const unsigned int WINDOW_BURSTS = 4;
+
+// Set before the measurement threads start, read only while they run
+static offset_precision s_precision = { 0.0, OFFSET_MIN_BURSTS, false };
+
+void offset_set_precision(const offset_precision *p) {
+
+	static const offset_precision defaults = { 0.0, OFFSET_MIN_BURSTS, false };
+
+	s_precision = p ? *p : defaults;
+}
+
+offset_precision offset_get_precision() {
+
+	return s_precision;
+}
+
 /**
- * @brief Calculates the frequency offset by averaging multiple FCCH detections.
+ * @brief FCCH search over overlapping windows of the live output ring.
+ *
+ * Each window is whatever the ring holds (at least s_len samples) and
+ * gives every burst fcch_detector::scan_all() finds in it. Only what it
+ * reports as consumed is purged, so the next window keeps the unscanned
+ * tail and waits for new samples only.
+ *
+ * Tracking: after a burst is found, the next one is 10 frames later (11
+ * after the fifth of a multiframe), so only that window is captured and
+ * checked with fcch_detector::track(). A miss or an overrun (the ring is
+ * flushed, timing is lost) goes back to a full search.
  */
-int offset_detect(hydrasdr_source *u, int hz_adjust, float tuner_error) {
+struct fcch_stream {
+	sample_source *u;
+	fcch_detector *l;
+	spsc_buffer *cb;
+	unsigned int s_len;
+	float tuner_error;
+	bool quiet;            // No '.' heartbeat (several streams at once)
 
-	unsigned int new_overruns = 0, overruns = 0;
-	unsigned int notfound = 0;
-	unsigned int s_len, b_len, consumed = 0;
-	unsigned int count = 0;
-	unsigned int iterations = 0;
-	
-	float offset = 0.0, min = 0.0, max = 0.0;
-	double avg_offset = 0.0, stddev = 0.0;
-	float sps;
-	float offsets[TARGET_COUNT]; // Storage for up to 100 samples
-	
-	double total_ppm;
+	double frame_len;      // Samples per TDMA frame
+	double pos;            // Stream index of the ring head
+	bool locked;           // Tracking a known burst timing
+	double burst;          // Stream index of the last burst
+	int phase;             // Burst index in the multiframe, -1 = unknown
+
+	const offset_seed *seed;  // Previous measurement, NULL if none
+
+	unsigned int iterations;
+	unsigned int overruns;
+	unsigned int notfound;
+	unsigned int tracked;  // Bursts found by tracking
+};
+
+static void stream_purge(fcch_stream *st, unsigned int len) {
+
+	st->pos += st->cb->purge(len);
+}
+
+// Sanity check: rejects wild offsets (aliasing or false positives)
+static bool valid_offset(const fcch_stream *st, float offset) {
+
+	if (!(fabs(offset) < FCCH_OFFSET_MAX))
+		return false;
+	return !st->seed || fabs(offset - st->seed->offset) <= st->seed->tolerance;
+}
+
+/**
+ * @brief Checks the predicted window of the next burst.
+ * @param weight Output: weight of the burst (see offset_precision).
+ * @return 1 with a valid offset (Hz), 0 on a miss, -1 on error or exit.
+ */
+static int track_offset(fcch_stream *st, float *offset, float *weight) {
+
+	const double sps = st->frame_len / (8 * 156.25);
+	const unsigned int guard = (unsigned int)lrint(TRACK_GUARD * sps);
+	const unsigned int w_len = st->l->burst_len() - 2 * guard;
+	unsigned int gaps[2] = { FCCH_GAP, FCCH_GAP + 1 };
+	unsigned int new_overruns = 0, b_len;
 	complex *cbuf;
-	fcch_detector *l;
-	circular_buffer *cb;
 
-	l = new fcch_detector((float)u->sample_rate());
+	st->iterations++;
+
+	// Fifth burst of the multiframe: the idle frame comes first
+	if (st->phase == FCCH_PER_MULTIFRAME - 1)
+		std::swap(gaps[0], gaps[1]);
+
+	for (int g = 0; g < 2; g++) {
+		const double start = st->burst + gaps[g] * st->frame_len;
+		const long ahead = lrint(start) - lrint(st->pos);
+
+		// The ring head is already past this window: a miss there
+		if (ahead < 0)
+			continue;
+		const unsigned int w0 = (unsigned int)ahead + guard;
+
+		if (st->u->capture(w0 + w_len, &new_overruns)) {
+			if (!g_kal_exit_req)
+				fprintf(stderr, "Error: Source fill failed.\n");
+			return -1;
+		}
+		st->overruns += new_overruns;
+		if (new_overruns)
+			break;
+
+		cbuf = (complex *)st->cb->peek(&b_len);
+		if (st->l->track(cbuf + w0, w_len, offset, weight)) {
+			*offset = *offset - (float)(GSM_RATE / 4) - st->tuner_error;
+			if (!valid_offset(st, *offset))
+				break;
+
+			st->burst = start;
+			if (gaps[g] != FCCH_GAP)
+				st->phase = 0;
+			else if (st->phase >= 0)
+				st->phase = (st->phase + 1) % FCCH_PER_MULTIFRAME;
+			st->tracked++;
+			stream_purge(st, w0 + w_len);
+			if (!s_precision.pm_weight)
+				*weight = 1.0f;
+			return 1;
+		}
+	}
+
+	// Lost: search the ring from its head again
+	st->locked = false;
+	st->phase = -1;
+	st->notfound++;
+	if (new_overruns)
+		st->pos = 0;
+
+	if(g_verbosity > 0) {
+	    fprintf(stderr, "  [---] Tracking lost in frame %u\n", st->iterations);
+	} else if (!st->quiet) {
+		fprintf(stderr, ".");
+		fflush(stderr);
+	}
+	return 0;
+}
+
+/**
+ * @brief (Re)builds the detector and window sizes for the source's
+ *        current output rate, then waits for its segment.
+ * @return 0 on success, -1 on error or exit.
+ */
+static int fcch_stream_rate(fcch_stream *st) {
+
+	sample_source *u = st->u;
+	const float sps = (float)(u->sample_rate() / GSM_RATE);
+
+	delete st->l;
+	st->l = new fcch_detector((float)u->sample_rate());
+	st->l->set_peak_mode((fcch_peak_mode)g_peak_mode);
 
 	/*
 	 * We grab slightly more than 1 frame length to ensure overlap
 	 */
-	sps = (float)(u->sample_rate() / GSM_RATE);
-	s_len = (unsigned int)ceil((12 * 8 * 156.25 + 156.25) * sps);
-	cb = u->get_buffer();
+	st->frame_len = 8 * 156.25 * u->sample_rate() / GSM_RATE;
+	st->s_len = (unsigned int)ceil((12 * 8 * 156.25 + 156.25) * sps);
+	st->pos = 0;
+	st->locked = false;
+	st->phase = -1;
 
-	u->start();
-	u->flush();
-	
-	if (g_verbosity == 0) {
-		printf("Scanning for FCCH bursts ('.' = searching, '+' = found)\n");
+	if (u->wait_settled()) {
+		if (!g_kal_exit_req)
+			fprintf(stderr, "Error: Source start failed.\n");
+		return -1;
 	}
+	return 0;
+}
 
-	// Main Loop: Run until we have enough samples OR we tried too many times
-	while(count < TARGET_COUNT && iterations < MAX_ITERATIONS) {
-		if (g_kal_exit_req) break;
+/**
+ * @brief Scans the next window.
+ * @param offsets Output: up to WINDOW_BURSTS valid offsets (Hz).
+ * @param weights Output: their weights (see offset_precision).
+ * @return Number of offsets, 0 if none, -1 on error or exit.
+ */
+static int next_offset(fcch_stream *st, float *offsets, float *weights) {
 
-		iterations++;
+	unsigned int new_overruns = 0, purged, consumed = 0, len, count, locked_i = 0;
+	fcch_burst bursts[WINDOW_BURSTS];
+	int found = 0;
 
-		// 1. Fill Buffer
-		do {
-			if(u->fill(s_len, &new_overruns)) {
-				// If interrupted by signal, break cleanly without error
-				if (g_kal_exit_req) break;
-				fprintf(stderr, "Error: Source fill failed.\n");
-				delete l;
-				return -1;
-			}
-			if(new_overruns) {
-				overruns += new_overruns;
-				u->flush();
+	// Oversampled and falling behind: the source went back to 1 sps
+	if (st->u->check_load() && fcch_stream_rate(st))
+		return -1;
+
+	if (st->locked)
+		return track_offset(st, offsets, weights);
+
+	st->iterations++;
+
+	// 1. Fill Buffer
+	if(st->u->capture(st->s_len, &new_overruns)) {
+		// If interrupted by signal, break cleanly without error
+		if (!g_kal_exit_req)
+			fprintf(stderr, "Error: Source fill failed.\n");
+		return -1;
+	}
+	st->overruns += new_overruns;
+	if (new_overruns)
+		st->pos = 0;
+
+	// FFT VISUALIZATION
+	if (g_show_fft && !st->quiet && (st->iterations % 5 == 0)) {
+		unsigned int b_len;
+		complex *cbuf = (complex *)st->cb->peek(&b_len);
+
+		// Draw ASCII FFT
+		// 270kHz sample rate. 
+		// 2048 samples gives ~130Hz resolution
+		// Use width 80 or 100
+		printf("\nFrame %u:", st->iterations);
+		draw_ascii_fft((std::complex<float>*)cbuf, 2048, 80);
+	}
+
+	// 2. Scan for every FCCH burst in place; what was consumed is purged,
+	// the overlap that could hold the start of a burst stays for the next
+	// window
+	const complex *s = (const complex *)st->cb->peek(&len);
+
+	count = st->l->scan_all(s, len, bursts, WINDOW_BURSTS, &consumed);
+	for (unsigned int i = 0; i < count; i++) {
+		// FCCH is a sine wave at GSM_RATE / 4 (approx 67.7 kHz)
+		float offset = bursts[i].offset - (float)(GSM_RATE / 4) - st->tuner_error;
+
+		if(valid_offset(st, offset)) {
+			weights[found] = s_precision.pm_weight ? bursts[i].pm : 1.0f;
+			offsets[found++] = offset;
+			if (g_fcch_track) {
+				st->locked = true;
+				st->burst = st->pos + bursts[i].start;
+				st->phase = -1;
+				locked_i = i;
 			}
-		} while(new_overruns);
+		} else {
+			// Found something, but offset was crazy
+			if(g_verbosity > 0) fprintf(stderr, "  [Ignored] Offset %.2f Hz out of range\n", offset);
+		}
+	}
+
+	if (!count) {
+		// NOT FOUND
+		st->notfound++;
 		
+		if(g_verbosity > 0) {
+		    fprintf(stderr, "  [---] No FCCH found in frame %u\n", st->iterations);
+		} else if (!st->quiet) {
+			fprintf(stderr, ".");
+			fflush(stderr);
+		}
+	}
+
+	// 3. Purge what was consumed, but never past the burst tracking
+	// locked on: a rejected burst after it would put its next window
+	// behind the ring head
+	if (st->locked)
+		consumed = bursts[locked_i].end;
+	purged = st->cb->purge(consumed ? consumed : len);
+	st->pos += purged;
+
+	return found;
+}
+
+static int fcch_stream_init(fcch_stream *st, sample_source *u, float tuner_error,
+			    bool quiet = false, const offset_seed *seed = NULL) {
+
+	st->u = u;
+	st->seed = seed;
+	st->tuner_error = tuner_error;
+	st->quiet = quiet;
+	st->iterations = 0;
+	st->overruns = 0;
+	st->notfound = 0;
+	st->tracked = 0;
+	st->burst = 0;
+	st->l = NULL;
+	st->cb = u->get_buffer();
+
+	if (fcch_stream_rate(st) && !g_kal_exit_req) {
+		delete st->l;
+		return -1;
+	}
+	return 0;
+}
+
+static void print_overruns(sample_source *u, unsigned int overruns) {
+
+	printf("overruns: %u\n", overruns);
+	if (overruns && g_verbosity > 0) {
+		sample_source::drop_stats d = u->get_drop_stats();
+		printf("  usb: %u, dsp: %u (input samples), ring: %u (output samples)\n",
+		       d.usb, d.dsp, d.ring);
+	}
+}
+
+int offset_measure(sample_source *u, int hz_adjust, float tuner_error, bool quiet,
+		   offset_result *res, const offset_seed *seed) {
+
+	const offset_precision prec = s_precision;
+	fcch_stream st;
+	offset_stats stats(TARGET_COUNT);
+	float offsets[WINDOW_BURSTS], weights[WINDOW_BURSTS];
+	double target = 0.0;
+	bool done = false;
+	int r;
+
+	memset(res, 0, sizeof(*res));
+	if (fcch_stream_init(&st, u, tuner_error, quiet, seed))
+		return -1;
+	
+	if (g_verbosity == 0 && !quiet) {
+		printf("Scanning for FCCH bursts ('.' = searching, '+' = found)\n");
+	}
+
+	// Target standard error in Hz at this frequency
+	if (prec.ppb > 0.0)
+		target = prec.ppb * 1e-9 * u->center_freq();
+
+	// Main Loop: Run until we have enough samples OR we tried too many times
+	while(!done && stats.count() < TARGET_COUNT && st.iterations < MAX_ITERATIONS) {
 		if (g_kal_exit_req) break;
 
-		// 2. Peek at data
-		cbuf = (complex *)cb->peek(&b_len);
-
-		// FFT VISUALIZATION
-		if (g_show_fft && (iterations % 5 == 0)) {
-			// Draw ASCII FFT
-			// 270kHz sample rate. 
-			// 2048 samples gives ~130Hz resolution
-			// Use width 80 or 100
-			printf("\nFrame %u:", iterations);
-			draw_ascii_fft((std::complex<float>*)cbuf, 2048, 80);
+		// Warm start: the carrier is not where it was
+		if (seed && seed->probe_windows && !stats.count() && st.iterations >= seed->probe_windows)
+			break;
+
+		r = next_offset(&st, offsets, weights);
+		if (r < 0) {
+			if (g_kal_exit_req) break;
+			u->stop();
+			delete st.l;
+			return -1;
 		}
 
-		// 3. Scan for FCCH
-		if(l->scan(cbuf, b_len, &offset, &consumed)) {
-			// FOUND!
-			
-			// FCCH is a sine wave at GSM_RATE / 4 (approx 67.7 kHz)
-			offset = offset - (float)(GSM_RATE / 4) - tuner_error;
-
-			// Sanity check: Reject wild offsets (aliasing or false positives)
-			if(fabs(offset) < FCCH_OFFSET_MAX) {
-				offsets[count] = offset;
-				count++;
-
-				if(g_verbosity > 0) {
-					fprintf(stderr, "  [%3u/%u] Offset: %+.2f Hz\n", count, TARGET_COUNT, offset);
-				} else {
-					// Visual heartbeat
-					fprintf(stderr, "+"); 
-					fflush(stderr);
-				}
-			} else {
-				// Found something, but offset was crazy
-				if(g_verbosity > 0) fprintf(stderr, "  [Ignored] Offset %.2f Hz out of range\n", offset);
-			}
-		} else {
-			// NOT FOUND
-			notfound++;
-			
+		for (int i = 0; i < r && !done && stats.count() < TARGET_COUNT; i++) {
+			stats.add(offsets[i], weights[i]);
 			if(g_verbosity > 0) {
-			    fprintf(stderr, "  [---] No FCCH found in frame %u\n", iterations);
-			} else {
-				fprintf(stderr, ".");
+				fprintf(stderr, "  [%3lu/%u] Offset: %+.2f Hz\n", stats.count(), TARGET_COUNT, offsets[i]);
+			} else if (!quiet) {
+				// Visual heartbeat
+				fprintf(stderr, "+"); 
 				fflush(stderr);
 			}
 
-			// IMPORTANT: If scan failed, it might not set 'consumed'.
-			// We MUST consume this block of data to move forward in time.
-			if (consumed == 0) {
-				consumed = s_len; // Skip this entire frame
-			}
+			// Sequential estimation: precise enough already
+			done = target > 0.0 && stats.count() >= prec.min_bursts &&
+				stats.trimmed_se() <= target;
 		}
-
-		// 4. Purge used data from ring buffer
-		cb->purge(consumed);
 	}
 	
 	// End of loop cleanup
-	if (g_verbosity == 0) fprintf(stderr, "\n"); // Newline after dots
+	if (g_verbosity == 0 && !quiet) fprintf(stderr, "\n"); // Newline after dots
 	u->stop();
-	delete l;
-	
-	if (g_kal_exit_req) return 0; // Clean exit
+	delete st.l;
 
-	// -------------------------------------------------------
-	// Analysis
-	// -------------------------------------------------------
+	res->bursts = stats.count();
+	res->iterations = st.iterations;
+	res->overruns = st.overruns;
+	res->notfound = st.notfound;
+	res->tracked = st.tracked;
+	if (!res->bursts)
+		return 0;
+
+	// If we have enough samples, drop the top/bottom 10% outliers
+	res->offset = stats.trimmed(&res->stddev, &res->min, &res->max);
+	res->se = stats.count() > 1 ? stats.trimmed_se() : 0.0;
 
-	if (count == 0) {
-		printf("\nError: No valid FCCH bursts found after %u attempts.\n", iterations);
+	// PPM Calculation
+	// Formula: PPM = (Offset_Hz / Center_Freq_Hz) * 1e6
+	res->ppm = ((res->offset + hz_adjust) / u->center_freq()) * 1000000.0;
+
+	return 0;
+}
+
+int offset_print(sample_source *u, const offset_result *res) {
+
+	if (res->bursts == 0) {
+		printf("\nError: No valid FCCH bursts found after %u attempts.\n", res->iterations);
 		printf("Tips:\n");
 		printf(" - Use '-s' scan to find a stronger channel.\n");
 		printf(" - Use '-g' to increase gain.\n");
 		return -1;
 	}
 
-	// Sort only the valid samples we found
-	sort(offsets, count);
+	printf("\n--------------------------------------------------\n");
+	printf("Results (%lu valid bursts out of %u attempts)\n", res->bursts, res->iterations);
+	printf("--------------------------------------------------\n");
+	printf("average\t\t[min, max]\t(range, stddev)\n");
+	display_freq((float)res->offset);
+	printf("\t\t[%d, %d]\t(%d, %f)\n", (int)round(res->min), (int)round(res->max),
+	       (int)round(res->max - res->min), res->stddev);
+	print_overruns(u, res->overruns);
+	printf("not found: %u\n", res->notfound);
+	if (g_debug)
+		printf("debug: FCCH tracking: %u bursts tracked, %u windows\n", res->tracked, res->iterations);
+
+	printf("\nAverage Error: %.3f ppm (%.3f ppb)\n", res->ppm, res->ppm * 1000.0);
+	printf("Standard Error: %.3f ppb (%.2f Hz)\n", res->se / u->center_freq() * 1e9, res->se);
+
+	return 0;
+}
+
+/**
+ * @brief Calculates the frequency offset by averaging multiple FCCH detections.
+ */
+int offset_detect(sample_source *u, int hz_adjust, float tuner_error, offset_result *out) {
+
+	offset_result res;
+
+	if (offset_measure(u, hz_adjust, tuner_error, false, &res))
+		return -1;
+	if (out)
+		*out = res;
 	
-	// Calculate stats
-	// If we have enough samples, drop the top/bottom 10% outliers
-	unsigned int threshold = 0;
-	if (count >= 10) {
-		threshold = count / 10;
+	if (g_kal_exit_req) return 0; // Clean exit
+
+	// -------------------------------------------------------
+	// Analysis
+	// -------------------------------------------------------
+
+	return offset_print(u, &res);
+}
+
+/**
+ * @brief Measures the same station on several sources at once.
+ *
+ * One thread per source runs offset_measure(); each source has its own
+ * ring, resampler and detector, so nothing is shared but the FFT plan
+ * cache. Results are printed per source once every thread is done.
+ */
+int offset_detect_multi(sample_source **u, const char **names, unsigned int count,
+			int hz_adjust, float tuner_error) {
+
+	std::vector<offset_result> res(count);
+	std::vector<int> r(count, -1);
+	std::vector<std::thread> threads;
+	unsigned int found = 0;
+
+	printf("Measuring on %u devices...\n", count);
+	try {
+		for (unsigned int i = 0; i < count; i++) {
+			threads.push_back(std::thread([&, i] {
+				r[i] = offset_measure(u[i], hz_adjust, tuner_error, true, &res[i]);
+			}));
+		}
+	} catch (const std::exception &e) {
+		// Let the started ones finish; the others report a failure
+		fprintf(stderr, "error: offset_detect_multi: %s\n", e.what());
 	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
 
-	avg_offset = avg(offsets + threshold, count - 2 * threshold, &stddev);
-	min = offsets[threshold];
-	max = offsets[count - threshold - 1];
+	if (g_kal_exit_req) return 0; // Clean exit
 
-	printf("\n--------------------------------------------------\n");
-	printf("Results (%u valid bursts out of %u attempts)\n", count, iterations);
-	printf("--------------------------------------------------\n");
-	printf("average\t\t[min, max]\t(range, stddev)\n");
-	display_freq((float)avg_offset);
-	printf("\t\t[%d, %d]\t(%d, %f)\n", (int)round(min), (int)round(max), (int)round(max - min), stddev);
-	printf("overruns: %u\n", overruns);
-	printf("not found: %u\n", notfound);
+	printf("\n--------------------------------------------------------------------------\n");
+	printf("%-20s %9s %11s %8s %9s %11s %12s\n",
+	       "device", "bursts", "offset", "stddev", "overruns", "error (ppm)", "(ppb)");
+	printf("--------------------------------------------------------------------------\n");
+	for (unsigned int i = 0; i < count; i++) {
+		if (r[i]) {
+			printf("%-20s failed\n", names[i]);
+			continue;
+		}
+		if (!res[i].bursts) {
+			printf("%-20s %4lu/%-4u no FCCH found\n", names[i], res[i].bursts, res[i].iterations);
+			continue;
+		}
+		printf("%-20s %4lu/%-4u %8.1f Hz %8.2f %9u %11.3f %12.3f\n", names[i],
+		       res[i].bursts, res[i].iterations, res[i].offset, res[i].stddev,
+		       res[i].overruns, res[i].ppm, res[i].ppm * 1000.0);
+		found++;
+	}
 
-	// PPM Calculation
-	// Formula: PPM = (Offset_Hz / Center_Freq_Hz) * 1e6
-	total_ppm = ((avg_offset + hz_adjust) / u->m_center_freq) * 1000000.0;
+	return (found == count) ? 0 : -1;
+}
+
+/**
+ * @brief Tracks the frequency offset until interrupted.
+ *
+ * Prints one line per interval with the running estimates; the stream
+ * is never stopped in between.
+ */
+int offset_monitor(sample_source *u, int hz_adjust, float tuner_error,
+		   double interval, double alpha) {
+
+	fcch_stream st;
+	offset_stats stats(MONITOR_WINDOW, alpha);
+	float offsets[WINDOW_BURSTS], weights[WINDOW_BURSTS];
+	double estimate, trimmed, stddev, ppm, elapsed;
+	unsigned long last_count = 0;
+	int r = 0;
+
+	if (fcch_stream_init(&st, u, tuner_error))
+		return -1;
+
+	printf("Monitoring FCCH offset, one line every %.1f s (Ctrl-C to stop)\n", interval);
+	printf("time (s)  bursts  median (Hz)  trimmed (Hz)  stddev  %serror\n",
+	       stats.has_ema() ? "ema (Hz)  " : "");
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point next = t0 +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(interval));
+
+	while (!g_kal_exit_req) {
+		r = next_offset(&st, offsets, weights);
+		if (r < 0)
+			break;
+		for (int i = 0; i < r; i++) {
+			stats.add(offsets[i], weights[i]);
+			if (g_verbosity > 0)
+				fprintf(stderr, "  [%5lu] Offset: %+.2f Hz\n", stats.count(), offsets[i]);
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now < next)
+			continue;
+		while (next <= now)
+			next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(interval));
+
+		elapsed = std::chrono::duration<double>(now - t0).count();
+		if (stats.count() == last_count) {
+			printf("%8.1f  %6lu  no new FCCH burst\n", elapsed, stats.count());
+			fflush(stdout);
+			continue;
+		}
+		last_count = stats.count();
 
-	printf("\nAverage Error: %.3f ppm (%.3f ppb)\n", total_ppm, total_ppm * 1000.0);
+		trimmed = stats.trimmed(&stddev, 0, 0);
+		estimate = stats.has_ema() ? stats.ema() : trimmed;
+		ppm = ((estimate + hz_adjust) / u->center_freq()) * 1000000.0;
+
+		printf("%8.1f  %6lu  %+11.1f  %+12.1f  %6.1f  ", elapsed, stats.count(),
+		       stats.median(), trimmed, stddev);
+		if (stats.has_ema())
+			printf("%+8.1f  ", stats.ema());
+		printf("%+.3f ppm (%+.1f ppb)\n", ppm, ppm * 1000.0);
+		fflush(stdout);
+	}
+
+	if (g_verbosity == 0) fprintf(stderr, "\n");
+	u->stop();
+	delete st.l;
+
+	if (r < 0 && !g_kal_exit_req)
+		return -1;
+
+	// Whole run: every burst, not only the window
+	printf("\n--------------------------------------------------\n");
+	printf("Monitor summary (%lu valid bursts out of %u attempts)\n", stats.count(), st.iterations);
+	printf("--------------------------------------------------\n");
+	if (stats.count()) {
+		ppm = ((stats.mean() + hz_adjust) / u->center_freq()) * 1000000.0;
+		printf("mean: %+.2f Hz, stddev: %.2f Hz\n", stats.mean(), stats.stddev());
+		printf("Mean Error: %.3f ppm (%.3f ppb)\n", ppm, ppm * 1000.0);
+	}
+	print_overruns(u, st.overruns);
+	printf("not found: %u\n", st.notfound);
+	if (g_debug)
+		printf("debug: FCCH tracking: %u bursts tracked, %u windows\n", st.tracked, st.iterations);
 
 	return 0;
-}
\ No newline at end of file
+}
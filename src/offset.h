@@ -33,8 +33,92 @@
 #ifndef OFFSET_H
 #define OFFSET_H
 
-class hydrasdr_source;
+class sample_source;
 
-int offset_detect(hydrasdr_source *u, int hz_adjust, float tuner_error);
+/** @brief Outcome of one offset_measure() run. */
+struct offset_result {
+	unsigned long bursts;     /**< Valid bursts, 0 if none were found */
+	unsigned int iterations;  /**< Windows searched or tracked */
+	unsigned int overruns;
+	unsigned int notfound;
+	unsigned int tracked;     /**< Bursts found by tracking */
+	double offset;            /**< Trimmed mean offset (Hz) */
+	double stddev;            /**< Of the trimmed bursts (Hz) */
+	double se;                /**< Standard error of offset (Hz) */
+	float min, max;           /**< Trimmed range (Hz) */
+	double ppm;               /**< Clock error */
+};
+
+/**
+ * @brief What an earlier run measured on the channel (warm start).
+ *
+ * Bursts further than tolerance from the previous offset are taken as
+ * false detections, in the search and in tracking, and a channel that
+ * gives no valid burst in probe_windows search windows is given up
+ * early instead of after the full iteration budget.
+ */
+struct offset_seed {
+	float offset;                /**< Previous offset on the channel (Hz) */
+	float tolerance;             /**< Largest accepted change (Hz) */
+	unsigned int probe_windows;  /**< 0 = never give up early */
+};
+
+/**
+ * @brief When offset_measure() stops and how it weighs bursts.
+ *
+ * By default a measurement takes 100 bursts. With a target, it stops as
+ * soon as the standard error of the trimmed mean is at or below it
+ * (offset_stats::trimmed_se()), once it has at least min_bursts; 100
+ * bursts stay the ceiling.
+ */
+struct offset_precision {
+	double ppb;                /**< Target standard error, 0 = fixed burst count */
+	unsigned int min_bursts;   /**< Bursts before the target is checked */
+	bool pm_weight;            /**< Weight bursts by their peak-to-mean ratio */
+};
+
+/** @brief Default burst floor of offset_precision. */
+#define OFFSET_MIN_BURSTS 10
+
+/**
+ * @brief Sets the precision of the following measurements (all sources).
+ * @param p Settings, NULL to restore the default (fixed count, unweighted).
+ */
+void offset_set_precision(const offset_precision *p);
+
+/** @brief Current precision settings. */
+offset_precision offset_get_precision();
+
+/**
+ * @brief Measures the clock offset on the tuned channel without printing results.
+ * @param quiet No progress output (for several measurements at once).
+ * @param seed  Previous measurement of the channel (may be NULL).
+ * @return 0 on success (res->bursts may be 0), -1 on error.
+ */
+int offset_measure(sample_source *u, int hz_adjust, float tuner_error, bool quiet,
+		   offset_result *res, const offset_seed *seed = 0);
+
+/**
+ * @brief Prints the result of offset_measure() (or the no-burst error).
+ * @return 0 if bursts were found, -1 otherwise.
+ */
+int offset_print(sample_source *u, const offset_result *res);
+
+/**
+ * @brief Measures and prints the clock offset on the tuned channel.
+ * @param res Output: the measurement (may be NULL).
+ * @return 0 on success, -1 on error or if no burst was found.
+ */
+int offset_detect(sample_source *u, int hz_adjust, float tuner_error, offset_result *res = 0);
+
+/**
+ * @brief Runs offset_measure() on every source in parallel and prints one line each.
+ * @param names Label printed for each source (e.g. its serial number).
+ * @return 0 if every source found the station, -1 otherwise.
+ */
+int offset_detect_multi(sample_source **u, const char **names, unsigned int count,
+			int hz_adjust, float tuner_error);
+int offset_monitor(sample_source *u, int hz_adjust, float tuner_error,
+		   double interval, double alpha);
 
 #endif /* OFFSET_H */
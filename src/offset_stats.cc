@@ -0,0 +1,152 @@
+/**
+ * @file offset_stats.cc
+ * @brief Implementation of the running FCCH offset statistics.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include "offset_stats.h"
+
+offset_stats::offset_stats(unsigned int window, double alpha)
+{
+	m_window = window ? window : 1;
+	m_alpha = alpha;
+	m_ring.reserve(m_window);
+	m_sorted.reserve(m_window);
+	reset();
+}
+
+void offset_stats::reset()
+{
+	m_ring.clear();
+	m_sorted.clear();
+	m_head = 0;
+	m_count = 0;
+	m_mean = 0.0;
+	m_m2 = 0.0;
+	m_ema = 0.0;
+}
+
+void offset_stats::add(float offset, float weight)
+{
+	const sample s = { offset, weight };
+	double delta;
+
+	/* Window: replace the oldest burst, keeping m_sorted in order */
+	if (m_ring.size() < m_window) {
+		m_ring.push_back(s);
+	} else {
+		const sample old = m_ring[m_head];
+		std::vector<sample>::iterator it =
+			std::lower_bound(m_sorted.begin(), m_sorted.end(), old, by_offset);
+
+		/* Equal offsets may differ in weight */
+		while (it->weight != old.weight)
+			++it;
+		m_sorted.erase(it);
+		m_ring[m_head] = s;
+		m_head = (m_head + 1) % m_window;
+	}
+	m_sorted.insert(std::upper_bound(m_sorted.begin(), m_sorted.end(), s, by_offset), s);
+
+	m_count++;
+	delta = offset - m_mean;
+	m_mean += delta / m_count;
+	m_m2 += delta * (offset - m_mean);
+
+	if (m_count == 1)
+		m_ema = offset;
+	else
+		m_ema += m_alpha * (offset - m_ema);
+}
+
+double offset_stats::stddev() const
+{
+	return m_count ? sqrt(m_m2 / m_count) : 0.0;
+}
+
+double offset_stats::median() const
+{
+	size_t n = m_sorted.size();
+
+	if (!n)
+		return 0.0;
+	if (n & 1)
+		return m_sorted[n / 2].offset;
+	return 0.5 * ((double)m_sorted[n / 2 - 1].offset + m_sorted[n / 2].offset);
+}
+
+double offset_stats::trimmed(double *stddev, float *min, float *max) const
+{
+	unsigned int n = (unsigned int)m_sorted.size();
+	unsigned int t = (n >= OFFSET_STATS_TRIM_MIN) ? n / OFFSET_STATS_TRIM_DIV : 0;
+	double sum = 0.0, sum_sq = 0.0, sum_w = 0.0, mean;
+
+	if (!n) {
+		if (stddev) *stddev = 0.0;
+		if (min) *min = 0.0f;
+		if (max) *max = 0.0f;
+		return 0.0;
+	}
+
+	/* Same sums as avg() with unit weights, so batch results do not change */
+	for (unsigned int i = t; i < n - t; i++) {
+		const float x = m_sorted[i].offset, w = m_sorted[i].weight;
+
+		sum += x * w;
+		sum_sq += x * x * w;
+		sum_w += w;
+	}
+	mean = sum / sum_w;
+	if (stddev)
+		*stddev = sqrt((sum_sq / sum_w) - (mean * mean));
+	if (min)
+		*min = m_sorted[t].offset;
+	if (max)
+		*max = m_sorted[n - t - 1].offset;
+	return mean;
+}
+
+double offset_stats::trimmed_se() const
+{
+	unsigned int n = (unsigned int)m_sorted.size();
+	unsigned int t = (n >= OFFSET_STATS_TRIM_MIN) ? n / OFFSET_STATS_TRIM_DIV : 0;
+	double sum = 0.0, sum_w = 0.0, sum_w2 = 0.0, kept_w = 0.0;
+	double mean, var = 0.0, n_eff;
+
+	if (n < 2)
+		return HUGE_VAL;
+
+	const float lo = m_sorted[t].offset, hi = m_sorted[n - t - 1].offset;
+
+	for (unsigned int i = 0; i < n; i++) {
+		const double x = std::min(std::max(m_sorted[i].offset, lo), hi), w = m_sorted[i].weight;
+
+		sum += x * w;
+		sum_w += w;
+		sum_w2 += w * w;
+		if (i >= t && i < n - t)
+			kept_w += w;
+	}
+	mean = sum / sum_w;
+	for (unsigned int i = 0; i < n; i++) {
+		const double x = std::min(std::max(m_sorted[i].offset, lo), hi) - mean;
+
+		var += x * x * m_sorted[i].weight;
+	}
+
+	/* Unbiased with n_eff = (sum w)^2 / sum w^2 samples */
+	n_eff = sum_w * sum_w / sum_w2;
+	var = var / sum_w * n_eff / (n_eff - 1.0);
+	return sqrt(var * sum_w2) / kept_w;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file offset_stats.h
+ * @brief Running statistics of FCCH frequency offsets.
+ *
+ * Estimates are updated per burst, so a long-running measurement can
+ * report at any time without keeping or re-sorting its whole history:
+ * - median and trimmed mean over a sliding window of the last bursts,
+ *   kept in a sorted copy that is updated by insertion (no full sort);
+ * - mean and standard deviation of every burst since reset() (Welford);
+ * - optional exponential moving average (alpha > 0).
+ *
+ * Bursts can be weighted (e.g. by their FCCH peak-to-mean ratio, which
+ * grows with SNR): the weights apply to trimmed() and trimmed_se(), the
+ * window is still trimmed by rank. Every other estimate is unweighted.
+ *
+ * With a window as large as the number of bursts, trimmed() gives the
+ * same figures as sorting them and calling avg() on the trimmed range.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __OFFSET_STATS_H__
+#define __OFFSET_STATS_H__
+
+#include <vector>
+
+/** @brief Window fraction dropped at each end by trimmed() (1/10). */
+#define OFFSET_STATS_TRIM_DIV 10
+
+/** @brief Smallest window that gets trimmed. */
+#define OFFSET_STATS_TRIM_MIN 10
+
+class offset_stats {
+public:
+	/**
+	 * @param window Bursts kept for median() and trimmed() (at least 1).
+	 * @param alpha  Exponential filter coefficient, 0 = disabled.
+	 */
+	offset_stats(unsigned int window, double alpha = 0.0);
+
+	/** @brief Forgets every burst. */
+	void reset();
+
+	/**
+	 * @brief Adds one offset (Hz).
+	 * @param weight Relative weight in trimmed() and trimmed_se() (> 0).
+	 */
+	void add(float offset, float weight = 1.0f);
+
+	/** @brief Bursts added since reset(). */
+	unsigned long count() const { return m_count; }
+
+	/** @brief Bursts currently in the window. */
+	unsigned int window_count() const { return (unsigned int)m_sorted.size(); }
+
+	/** @brief Mean of every burst since reset() (Welford). */
+	double mean() const { return m_mean; }
+
+	/** @brief Population standard deviation of every burst since reset(). */
+	double stddev() const;
+
+	/** @brief Exponential moving average, or mean() when disabled. */
+	double ema() const { return m_alpha > 0.0 ? m_ema : m_mean; }
+
+	/** @brief true if the exponential filter is enabled. */
+	bool has_ema() const { return m_alpha > 0.0; }
+
+	/** @brief Median of the window (0 if empty). */
+	double median() const;
+
+	/**
+	 * @brief Mean of the window without its top and bottom tenth.
+	 *
+	 * Windows under OFFSET_STATS_TRIM_MIN bursts are not trimmed.
+	 *
+	 * @param stddev Output: population standard deviation of the kept bursts (can be NULL).
+	 * @param min    Output: smallest kept burst (can be NULL).
+	 * @param max    Output: largest kept burst (can be NULL).
+	 * @return Trimmed mean, 0 if the window is empty.
+	 */
+	double trimmed(double *stddev, float *min, float *max) const;
+
+	/**
+	 * @brief Standard error of trimmed().
+	 *
+	 * Tukey-McLaughlin estimate: standard deviation of the winsorized
+	 * window (trimmed bursts clamped to the kept range) times
+	 * sqrt(sum w^2) / (kept weight), i.e. s_w * sqrt(n) / (n - 2t)
+	 * with unit weights.
+	 *
+	 * @return Standard error (Hz), HUGE_VAL with fewer than 2 bursts.
+	 */
+	double trimmed_se() const;
+
+private:
+	struct sample {
+		float offset;
+		float weight;
+	};
+
+	static bool by_offset(const sample &a, const sample &b) { return a.offset < b.offset; }
+
+	unsigned int m_window;
+	double m_alpha;
+
+	std::vector<sample> m_ring;     // Window in arrival order
+	unsigned int m_head;            // Oldest entry once m_ring is full
+	std::vector<sample> m_sorted;   // Window in ascending offset order
+
+	unsigned long m_count;
+	double m_mean, m_m2;            // Welford running mean and sum of squares
+	double m_ema;
+};
+
+#endif /* __OFFSET_STATS_H__ */
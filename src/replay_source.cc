@@ -0,0 +1,227 @@
+/**
+ * @file replay_source.cc
+ * @brief Implementation of the I/Q recording playback source.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include "replay_source.h"
+#include "util.h"
+
+replay_source::replay_source(const char *path, float gain) : sample_source(gain)
+{
+	m_path = path;
+	m_exit = false;
+	m_offset = 0.0;
+	m_buf = NULL;
+
+	/* A chunk is read after the change: no PLL, nothing in flight */
+	m_settle_samples = 0;
+	m_settle_first = false;
+}
+
+replay_source::~replay_source()
+{
+	close();
+}
+
+int replay_source::open()
+{
+	double rate;
+
+	if (m_file.open(m_path.c_str()))
+		return -1;
+
+	rate = m_file.meta().sample_rate;
+	if (dsp_resampler::supports_rate(rate)) {
+		if (set_input_rate(rate)) {
+			m_file.close();
+			return -1;
+		}
+	} else if (set_passthrough(rate)) {
+		fprintf(stderr, "Unsupported recording rate %.3f Hz (a HydraSDR rate the resampler "
+			"supports, or 270.833 kSPS x 1, 2 or 4)\n", rate);
+		m_file.close();
+		return -1;
+	}
+
+	m_buf = (std::complex<float>*)aligned_malloc(REPLAY_CHUNK * sizeof(std::complex<float>));
+	if (!m_buf) {
+		fprintf(stderr, "Failed to allocate replay buffer\n");
+		m_file.close();
+		return -1;
+	}
+	if (alloc_ring() != 0) {
+		close();
+		return -1;
+	}
+
+	m_center_freq = m_file.meta().center_freq;
+	m_offset = 0.0;
+	if (m_file.meta().gain > 0.0f)
+		m_gain = m_file.meta().gain;
+
+	return 0;
+}
+
+int replay_source::close()
+{
+	stop();
+
+	m_file.close();
+	aligned_free(m_buf);
+	m_buf = NULL;
+
+	return sample_source::close();
+}
+
+int replay_source::tune(double freq)
+{
+	if (!m_file.data())
+		return -1;
+
+	/* Published to the reader by the segment bump */
+	m_offset.store(m_file.meta().center_freq - freq, std::memory_order_relaxed);
+	retuned(freq);
+
+	return 0;
+}
+
+int replay_source::set_gain(float gain)
+{
+	m_gain = gain;
+	return 0;
+}
+
+double replay_source::native_rate() const
+{
+	return m_file.data() ? m_file.meta().sample_rate : SAMPLE_SOURCE_INPUT_RATE;
+}
+
+bool replay_source::covers(double freq, double half_bw) const
+{
+	const iq_meta &m = m_file.meta();
+
+	if (m_passthrough)
+		return fabs(freq - m.center_freq) < 1.0 && half_bw <= m.sample_rate / 2;
+	return fabs(freq - m.center_freq) + half_bw <= m.sample_rate / 2;
+}
+
+int replay_source::start()
+{
+	if (!m_file.data() || !cb)
+		return -1;
+
+	if (streaming.load(std::memory_order_acquire))
+		return 0;
+
+	reset_stream();
+
+	/* The reader thread takes the place of the USB callback */
+	m_exit.store(false, std::memory_order_release);
+	streaming.store(true, std::memory_order_release);
+	try {
+		m_thread = std::thread(&replay_source::replay_loop, this);
+	} catch (const std::exception& e) {
+		fprintf(stderr, "Failed to start replay: %s\n", e.what());
+		streaming.store(false, std::memory_order_release);
+		return -1;
+	}
+
+	return 0;
+}
+
+int replay_source::stop()
+{
+	if (streaming.load(std::memory_order_acquire)) {
+		streaming.store(false, std::memory_order_release);
+		m_exit.store(true, std::memory_order_release);
+		if (m_thread.joinable())
+			m_thread.join();
+
+		/* Wake up any threads waiting in fill() for graceful exit */
+		if (cb)
+			cb->notify();
+	}
+
+	return 0;
+}
+
+void replay_source::replay_loop()
+{
+	const iq_meta &m = m_file.meta();
+	const size_t bytes = iq_format_bytes(m.format);
+	const char *data = (const char *)m_file.data();
+	const sample_format format = (m.format == IQ_FORMAT_CI16) ?
+		SAMPLE_FORMAT_CI16 : SAMPLE_FORMAT_CF32;
+	uint64_t pos = 0;
+	double phase = 0.0;   /* Mixer phase (cycles) */
+
+	while (!m_exit.load(std::memory_order_acquire)) {
+		const bool wide = m_wideband.load(std::memory_order_acquire);
+		const bool bypass = wide || m_passthrough;
+
+		/*
+		 * Back-pressure instead of overflow: wait for room for the
+		 * whole chunk output (at most 1/8 of it once resampled, per
+		 * output sample per symbol).
+		 */
+		const unsigned int room = bypass ? REPLAY_CHUNK : REPLAY_CHUNK / 8 * oversampling();
+		if (cb->space_available() < room) {
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+
+		const uint32_t segment = m_segment.load(std::memory_order_acquire);
+		const double offset = m_offset.load(std::memory_order_relaxed);
+		const size_t n = (size_t)(std::min)((uint64_t)REPLAY_CHUNK, m.samples - pos);
+		const char *in = data + pos * bytes;
+
+		if (!wide && !covers(m.center_freq - offset, REPLAY_CHAN_HALF_BW)) {
+			/* Not in the recording: silence, not an aliased neighbour */
+			std::fill(m_buf, m_buf + n, std::complex<float>(0.0f, 0.0f));
+			process_samples(m_buf, n, SAMPLE_FORMAT_CF32, segment);
+		} else if (offset == 0.0) {
+			process_samples(in, n, format, segment);
+		} else {
+			/* Shift the tuned frequency to DC: x[t] * e^{j2π(center - freq)t/fs} */
+			const double step = offset / m.sample_rate;
+			const std::complex<double> rot = std::polar(1.0, 2.0 * M_PI * step);
+			std::complex<double> lo = std::polar(1.0, 2.0 * M_PI * phase);
+
+			for (size_t i = 0; i < n; i++) {
+				std::complex<float> x;
+				if (format == SAMPLE_FORMAT_CI16) {
+					const int16_t *s = (const int16_t *)in + 2 * i;
+					x = std::complex<float>(s[0] * INT16_IQ_SCALE, s[1] * INT16_IQ_SCALE);
+				} else {
+					x = ((const std::complex<float> *)in)[i];
+				}
+				m_buf[i] = x * std::complex<float>((float)lo.real(), (float)lo.imag());
+				lo *= rot;
+			}
+			phase = fmod(phase + step * n, 1.0);
+			process_samples(m_buf, n, SAMPLE_FORMAT_CF32, segment);
+		}
+
+		pos += n;
+		if (pos >= m.samples)
+			pos = 0;
+	}
+}
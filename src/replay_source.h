@@ -0,0 +1,99 @@
+/**
+ * @file replay_source.h
+ * @brief sample_source playing back an I/Q recording (see iq_file.h).
+ *
+ * The recording is memory-mapped and played in a loop by a reader thread
+ * through the sample_source pipeline, as fast as the consumer takes the
+ * output: the reader waits for ring space, so nothing is ever overrun.
+ *
+ * - Native rate (2.5 MSPS, or another rate dsp_resampler supports)
+ *   recordings are "tuned" digitally, by mixing,
+ *   anywhere covers() accepts; other frequencies read as silence.
+ * - GSM rate recordings bypass the resampler and only cover their
+ *   center frequency.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __REPLAY_SOURCE_H__
+#define __REPLAY_SOURCE_H__
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include "sample_source.h"
+#include "iq_file.h"
+
+/** @brief Recording samples fed to the pipeline per replay step. */
+#define REPLAY_CHUNK 65536
+
+/** @brief Half bandwidth a narrowband replay tune must cover (Hz, as WB_CHAN_HALF_BW). */
+#define REPLAY_CHAN_HALF_BW 90e3
+
+class replay_source : public sample_source {
+public:
+	/**
+	 * @param path Data file; its sidecar is path + IQ_META_SUFFIX.
+	 * @param gain Reported by gain() until open() reads the recorded one.
+	 */
+	replay_source(const char *path, float gain);
+	~replay_source();
+
+	/**
+	 * @brief Maps the recording and allocates the output ring.
+	 *
+	 * The center frequency starts at the recorded one.
+	 *
+	 * @return 0 on success, -1 on failure (error printed to stderr).
+	 */
+	int open();
+	int close();
+
+	/** @brief Digital tune: sets the mixer for the next segment. */
+	int tune(double freq);
+
+	/** @brief Only recorded: a recording has no gain to set. */
+	int set_gain(float gain);
+
+	int start();
+	int stop();
+
+	/** @brief Recording sample rate. */
+	double native_rate() const;
+
+	/**
+	 * @brief true if [freq - half_bw, freq + half_bw] was recorded.
+	 *
+	 * A GSM rate recording only covers its center frequency.
+	 */
+	bool covers(double freq, double half_bw) const;
+
+	/** @brief The open recording. */
+	inline const iq_file &file() const { return m_file; }
+
+private:
+	std::string m_path;
+	iq_file m_file;
+	std::thread m_thread;
+	std::atomic<bool> m_exit;
+
+	/*
+	 * tune() stores the mixer offset before bumping m_segment; the
+	 * reader loads it after sampling the segment, so each chunk is
+	 * mixed for its segment.
+	 */
+	std::atomic<double> m_offset;   // Recording center - tuned frequency (Hz)
+	std::complex<float>* m_buf;     // REPLAY_CHUNK converted or mixed samples
+
+	/** @brief Reader thread body. */
+	void replay_loop();
+};
+
+#endif /* __REPLAY_SOURCE_H__ */
@@ -0,0 +1,477 @@
+/**
+ * @file sample_source.cc
+ * @brief Implementation of the device-independent stream pipeline.
+ *
+ * @section DSP Pipeline
+ *
+ * The resampling pipeline converts the native hardware rate to GSM symbol rate
+ * (or 2x / 4x that, see set_oversampling()):
+ *
+ * @code
+ *   2,500,000 Hz ─▶ [Stage 1: ÷5] ─▶ 500,000 Hz ─▶ [Stage 2: ×13/24] ─▶ 270,833.333 Hz
+ *                   (61-tap LPF)                   (729-tap Polyphase)
+ *                                                  [×13/12, ×13/6]  ─▶ ×2, ×4
+ * @endcode
+ *
+ * @see dsp_resampler for filter coefficient details.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "sample_source.h"
+#include "kal_globals.h"
+#include "kal_stats.h"
+
+/*
+ * ---------------------------------------------------------------------------
+ * Constructor / Destructor
+ * ---------------------------------------------------------------------------
+ */
+
+sample_source::sample_source(float gain)
+{
+	m_gain = gain;
+
+	/* Target GSM symbol rate: 13 MHz / 48 = 270833.333... Hz */
+	m_sample_rate = 270833.333333;
+	m_center_freq = 0.0;
+	m_overflow_count = 0;
+	m_drops_usb = 0;
+	m_drops_dsp = 0;
+	m_drops_ring = 0;
+
+	cb = NULL;
+	streaming = false;
+
+	m_wideband = false;
+	m_passthrough = false;
+	m_settle_samples = 0;
+	m_settle_first = false;
+	m_segment = 0;
+	m_ready_segment = 0;
+	m_ready_mark = 0;
+	m_prod_segment = 0;
+	m_prod_ready = true;
+	m_settle_left = 0;
+	m_warmup_left = 0;
+	m_capture_freq = 0.0;
+	m_input_rate = DSP_RESAMPLER_INPUT_RATE;
+	m_sps = 1;
+	m_load = 0.0f;
+	m_load_drops = 0;
+
+	/* Initialize DSP resampling pipeline */
+	m_resampler = new dsp_resampler();
+}
+
+sample_source::~sample_source()
+{
+	delete cb;
+	delete m_resampler;
+}
+
+int sample_source::close()
+{
+	if (cb) {
+		delete cb;
+		cb = NULL;
+	}
+
+	return 0;
+}
+
+int sample_source::alloc_ring()
+{
+	if (cb)
+		return 0;
+
+	try {
+		cb = new spsc_buffer(SAMPLE_SOURCE_RING_SAMPLES * oversampling(), sizeof(complex));
+	} catch (const std::exception& e) {
+		fprintf(stderr, "Failed to allocate circular buffer: %s\n", e.what());
+		return -1;
+	}
+	g_stats.ring_capacity.store(cb->capacity(), std::memory_order_relaxed);
+
+	return 0;
+}
+
+int sample_source::set_input_rate(double rate)
+{
+	unsigned int sps = oversampling();
+
+	m_passthrough = false;
+	if (!dsp_resampler::supports_rate(rate, sps)) {
+		fprintf(stderr, "No %u sps resampler at %.3f MSPS, using 1 sps\n", sps, rate / 1e6);
+		sps = 1;
+	}
+	/* Not streaming yet: the resampler is still ours to configure */
+	if (m_resampler->set_input_rate(rate) || m_resampler->set_output_sps(sps))
+		return -1;
+	m_input_rate = rate;
+	m_sps = sps;
+	m_sample_rate = m_resampler->output_rate();
+	g_stats.input_rate.store((uint64_t)rate, std::memory_order_relaxed);
+
+	return 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Control Side
+ * ---------------------------------------------------------------------------
+ */
+
+void sample_source::retuned(double freq)
+{
+	m_center_freq = freq;
+
+	/*
+	 * New segment: the producer resets the filter history and drops the
+	 * settle interval, so transients from the old frequency never reach
+	 * the ring as samples of this one.
+	 */
+	m_segment.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void sample_source::reset_stream()
+{
+	/* Reset DSP state before streaming begins */
+	m_resampler->reset();
+	m_segment.fetch_add(1, std::memory_order_acq_rel);
+	m_overflow_count = 0;
+	m_drops_usb = 0;
+	m_drops_dsp = 0;
+	m_drops_ring = 0;
+	m_load = 0.0f;
+	m_load_drops = 0;
+}
+
+dsp_engine_id sample_source::set_resampler_engine(dsp_engine_id id)
+{
+	return m_resampler->set_engine(id);
+}
+
+void sample_source::set_wideband(bool enable)
+{
+	if (m_wideband.exchange(enable, std::memory_order_acq_rel) != enable)
+		m_segment.fetch_add(1, std::memory_order_acq_rel);
+}
+
+int sample_source::set_passthrough(double rate)
+{
+	const unsigned int sps = (unsigned int)lrint(rate / GSM_RATE);
+
+	if (sps < 1 || sps > DSP_RESAMPLER_MAX_SPS || (sps & (sps - 1)) ||
+	    fabs(rate - GSM_RATE * sps) >= 1.0)
+		return -1;
+	m_passthrough = true;
+	m_input_rate = rate;
+	m_sample_rate = rate;
+	m_sps = sps;
+	g_stats.input_rate.store((uint64_t)rate, std::memory_order_relaxed);
+
+	return 0;
+}
+
+unsigned int sample_source::set_oversampling(unsigned int sps)
+{
+	if (m_passthrough)
+		return oversampling();
+	if (!dsp_resampler::supports_rate(m_input_rate, sps))
+		sps = 1;
+
+	if (m_sps.exchange(sps, std::memory_order_acq_rel) != sps) {
+		m_sample_rate = GSM_RATE * sps;
+		m_segment.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	return sps;
+}
+
+bool sample_source::check_load()
+{
+	const unsigned int drops = m_drops_usb.load() + m_drops_dsp.load();
+	const bool dropped = drops != m_load_drops;
+	const float load = m_load.load(std::memory_order_relaxed);
+
+	m_load_drops = drops;
+	if (oversampling() == 1 || (!dropped && load <= SAMPLE_SOURCE_LOAD_MAX))
+		return false;
+
+	if (dropped)
+		fprintf(stderr, "Warning: samples dropped at %u sps, falling back to 1 sps\n",
+			oversampling());
+	else
+		fprintf(stderr, "Warning: resampler load %.0f%% at %u sps, falling back to 1 sps\n",
+			load * 100.0f, oversampling());
+	set_oversampling(1);
+
+	return true;
+}
+
+sample_source::drop_stats sample_source::get_drop_stats() const
+{
+	drop_stats d;
+
+	d.usb = m_drops_usb.load();
+	d.dsp = m_drops_dsp.load();
+	d.ring = m_drops_ring.load();
+
+	return d;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Producer Side
+ * ---------------------------------------------------------------------------
+ */
+
+void sample_source::process_samples(const void* input, size_t count,
+				    sample_format format, uint32_t segment)
+{
+	const size_t sample_bytes = sample_format_bytes(format);
+
+	/*
+	 * First block of a new segment: drop the settle interval (after the
+	 * block itself if it may predate the change), then the resampler
+	 * warm-up (history is zeroed here, on the producer side). A new
+	 * oversampling takes effect here too.
+	 */
+	if (segment != m_prod_segment) {
+		m_prod_segment = segment;
+		m_prod_ready = false;
+		if (!m_passthrough)
+			m_resampler->set_output_sps(m_sps.load(std::memory_order_acquire));
+		m_resampler->reset();
+		m_settle_left = (m_settle_first ? count : 0) + m_settle_samples;
+		m_warmup_left = (m_wideband.load(std::memory_order_acquire) || m_passthrough) ?
+				0 : m_resampler->warmup_outputs();
+	}
+
+	if (m_settle_left) {
+		size_t n = (std::min)(count, m_settle_left);
+		m_settle_left -= n;
+		input = (const char*)input + n * sample_bytes;
+		count -= n;
+		if (!count)
+			return;
+	}
+
+	/*
+	 * Sanity check: Verify input won't overflow batch buffer.
+	 * Output ratio is approximately 1/9.23, so max output = count/9.23
+	 * With BATCH_SIZE=32768 and ratio ~9.23, max safe input is ~302K samples.
+	 */
+	if (count > 262144) {
+		fprintf(stderr, "Warning: USB transfer size %zu exceeds expected maximum\n", count);
+		/* Process anyway, resampler will clamp output */
+	}
+
+	/* Wideband output, or input already at the output rate */
+	if (m_wideband.load(std::memory_order_acquire) || m_passthrough) {
+		if (format != SAMPLE_FORMAT_CI16) {
+			push_output((const std::complex<float>*)input, count);
+			return;
+		}
+
+		const int16_t *in = (const int16_t*)input;
+		while (count) {
+			size_t n = count < (size_t)BATCH_SIZE ? count : (size_t)BATCH_SIZE;
+			for (size_t i = 0; i < n; i++) {
+				m_batch_buffer[i] = std::complex<float>(in[2 * i] * INT16_IQ_SCALE,
+									in[2 * i + 1] * INT16_IQ_SCALE);
+			}
+			push_output(m_batch_buffer, n);
+			in += 2 * n;
+			count -= n;
+		}
+		return;
+	}
+
+	/*
+	 * Run DSP Pipeline: native rate → 270.833 kSPS x sps
+	 * Stage 1: Decimate to 500 kSPS with anti-alias filter (61 taps at 2.5 MSPS)
+	 * Stage 2: Rational resample 13/24 (13/12, 13/6) with polyphase filter (729 taps)
+	 *
+	 * Oversampled output of a whole transfer can exceed the batch buffer,
+	 * so feed the resampler in slices whose output always fits.
+	 */
+	const double in_rate = m_resampler->input_rate();
+	const size_t in_max = (size_t)((BATCH_SIZE - 2) * in_rate / m_resampler->output_rate());
+
+	while (count) {
+		const size_t n = (std::min)(count, in_max);
+		size_t produced;
+		const uint64_t t0 = stats_now_ns();
+		if (format == SAMPLE_FORMAT_CI16)
+			produced = m_resampler->process_int16((const int16_t*)input, n,
+							      m_batch_buffer, BATCH_SIZE);
+		else
+			produced = m_resampler->process((const std::complex<float>*)input, n,
+							m_batch_buffer, BATCH_SIZE);
+		const uint64_t dt = stats_now_ns() - t0;
+		g_stats.resample_ns.add(dt);
+		g_stats.resample_samples.fetch_add(n, std::memory_order_relaxed);
+
+		/* Share of real time spent resampling, 1/16 moving average */
+		float load = m_load.load(std::memory_order_relaxed);
+		load += ((float)(dt * 1e-9 * in_rate / n) - load) * (1.0f / 16.0f);
+		m_load.store(load, std::memory_order_relaxed);
+
+		size_t skip = (std::min)(produced, m_warmup_left);
+		m_warmup_left -= skip;
+		push_output(m_batch_buffer + skip, produced - skip);
+
+		input = (const char*)input + n * sample_bytes;
+		count -= n;
+	}
+}
+
+void sample_source::push_output(const std::complex<float>* samples, size_t count)
+{
+	/*
+	 * Push processed samples to the SPSC ring. This never blocks and
+	 * never contends with the consumer: samples are only dropped (and
+	 * counted as overflow) when the ring is genuinely full.
+	 */
+	if (count > 0 && cb) {
+		/* First sample of the segment: tell wait_settled() where it is */
+		if (!m_prod_ready) {
+			m_prod_ready = true;
+			m_ready_mark.store(cb->write_mark(), std::memory_order_relaxed);
+			m_ready_segment.store(m_prod_segment, std::memory_order_release);
+		}
+
+		unsigned int written = cb->write(samples, (unsigned int)count);
+		if (written < (unsigned int)count) {
+			/* Software overflow: buffer full */
+			m_overflow_count += (unsigned int)(count - written);
+			m_drops_ring += (unsigned int)(count - written);
+			g_stats.drops_ring.fetch_add(count - written, std::memory_order_relaxed);
+		}
+		stats_max(g_stats.ring_high, cb->data_available());
+	}
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Sample Consumer (Main Thread)
+ * ---------------------------------------------------------------------------
+ */
+
+int sample_source::fill(unsigned int num_samples, unsigned int *overruns)
+{
+	if (!cb)
+		return -1;
+
+	/* Auto-start streaming if not already running */
+	if (!streaming.load(std::memory_order_acquire))
+		start();
+
+	while (true) {
+		/* Check global exit flag to allow graceful shutdown */
+		if (g_kal_exit_req)
+			return -1;
+
+		/* Exit loop when enough samples available or streaming stopped */
+		if (!streaming.load(std::memory_order_acquire))
+			break;
+
+		/*
+		 * Sleep with 100ms timeout to periodically check exit flag.
+		 * This prevents indefinite blocking if no samples arrive.
+		 */
+		if (cb->wait(num_samples, 100))
+			break;
+	}
+
+	if (!streaming.load(std::memory_order_acquire))
+		return -1;
+
+	/* Report and atomically reset overflow counter */
+	if (overruns) {
+		*overruns = m_overflow_count.exchange(0);
+	}
+
+	return 0;
+}
+
+int sample_source::wait_settled()
+{
+	if (!cb)
+		return -1;
+
+	if (!streaming.load(std::memory_order_acquire) && start() != 0)
+		return -1;
+
+	const uint32_t segment = m_segment.load(std::memory_order_acquire);
+	const double freq = m_center_freq;
+
+	/* All of it precedes the segment; this also leaves room for it */
+	cb->flush();
+
+	while (m_ready_segment.load(std::memory_order_acquire) != segment) {
+		if (g_kal_exit_req || !streaming.load(std::memory_order_acquire))
+			return -1;
+		cb->wait(cb->data_available() + 1, 100);
+	}
+
+	cb->purge_to(m_ready_mark.load(std::memory_order_relaxed));
+	m_overflow_count = 0;
+	m_capture_freq = freq;
+
+	return 0;
+}
+
+int sample_source::capture(unsigned int num_samples, unsigned int *overruns)
+{
+	unsigned int dropped, total = 0;
+
+	while (true) {
+		if (fill(num_samples, &dropped))
+			return -1;
+		total += dropped;
+		if (!dropped)
+			break;
+		/* The gap is somewhere in the ring: start over after it */
+		cb->flush();
+	}
+
+	if (overruns)
+		*overruns = total;
+	return 0;
+}
+
+int sample_source::tune_capture(double freq, unsigned int num_samples, unsigned int *overruns)
+{
+	if (tune(freq) || wait_settled())
+		return -1;
+
+	return capture(num_samples, overruns);
+}
+
+int sample_source::flush()
+{
+	if (cb)
+		cb->flush();
+
+	m_overflow_count = 0;
+
+	return 0;
+}
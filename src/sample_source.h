@@ -0,0 +1,458 @@
+/**
+ * @file sample_source.h
+ * @brief Device-independent sample source: output ring, resampler, stream segments.
+ *
+ * The scan and offset engines only see this interface. A source owns the
+ * output ring and the DSP pipeline; the derived class drives the device
+ * (open/tune/start/stop) and feeds raw input from its producer thread
+ * through process_samples():
+ *
+ * @code
+ *   producer (USB callback, worker, file reader)
+ *      │ process_samples(raw, count, format, segment)
+ *      ▼
+ *   [settle drop] ─▶ [dsp_resampler or bypass] ─▶ [warm-up drop] ─▶ spsc_buffer ─▶ fill()/peek()
+ * @endcode
+ *
+ * Derived sources: hydrasdr_source (HydraSDR RFOne, libhydrasdr),
+ * replay_source (iq_file recordings) and the DSP benchmark mock.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __SAMPLE_SOURCE_H__
+#define __SAMPLE_SOURCE_H__
+
+#include <atomic>
+#include "spsc_buffer.h"
+#include "kal_types.h"
+#include "dsp_resampler.h"
+
+/** @brief Default input rate the resampler converts from (Hz). */
+#define SAMPLE_SOURCE_INPUT_RATE DSP_RESAMPLER_INPUT_RATE
+
+/**
+ * @brief Output ring capacity in samples, per output sample per symbol.
+ *
+ * ~0.97 s at the GSM rate (at any oversampling, see set_oversampling()),
+ * ~0.1 s of wideband 2.5 MSPS output at 1 sps.
+ */
+#define SAMPLE_SOURCE_RING_SAMPLES (256 * 1024)
+
+/**
+ * @brief Resampler share of real time above which check_load() drops
+ *        the oversampling back to 1 sps.
+ */
+#define SAMPLE_SOURCE_LOAD_MAX 0.5f
+
+/** @brief Raw input formats accepted by process_samples(). */
+enum sample_format {
+	SAMPLE_FORMAT_CF32 = 0,   /**< Interleaved float32 I/Q */
+	SAMPLE_FORMAT_CI16        /**< Interleaved int16 I/Q (full scale 32768) */
+};
+
+/** @brief Bytes per complex sample of a format. */
+inline size_t sample_format_bytes(sample_format f)
+{
+	return (f == SAMPLE_FORMAT_CI16) ? 2 * sizeof(int16_t) : sizeof(std::complex<float>);
+}
+
+/**
+ * @class sample_source
+ * @brief Abstract I/Q source delivering GSM rate (or wideband) samples.
+ *
+ * @par Consumer Usage:
+ * @code
+ *     unsigned int overruns;
+ *     src->tune_capture(935.2e6, 1024, &overruns);
+ *     complex* samples = (complex*)src->get_buffer()->peek(nullptr);
+ *     // Process samples...
+ *     src->get_buffer()->purge(1024);
+ * @endcode
+ *
+ * The thread calling fill(), wait_settled() and get_buffer() is the only
+ * ring reader; the derived producer thread is the only writer.
+ */
+class sample_source {
+public:
+	/**
+	 * @param gain Initial gain (device specific units).
+	 */
+	sample_source(float gain);
+
+	/** @brief Derived destructors must call their own close(). */
+	virtual ~sample_source();
+
+	/*
+	 * Device interface
+	 */
+
+	/**
+	 * @brief Opens the device or file and allocates the output ring.
+	 * @return 0 on success, -1 on failure (error printed to stderr).
+	 */
+	virtual int open() = 0;
+
+	/**
+	 * @brief Stops streaming and releases the device and the ring.
+	 * @return 0 on success.
+	 */
+	virtual int close();
+
+	/**
+	 * @brief Tunes to freq and starts a new stream segment.
+	 *
+	 * The producer resets the resampler and drops the settle interval
+	 * before publishing samples of the new frequency (see
+	 * wait_settled()). Use tune_capture() to wait for them.
+	 *
+	 * @return 0 on success, -1 on failure.
+	 */
+	virtual int tune(double freq) = 0;
+
+	/** @brief Sets the front-end gain. @return 0 on success, -1 on failure. */
+	virtual int set_gain(float gain) = 0;
+
+	/**
+	 * @brief Starts the producer. Returns 0 at once if already streaming.
+	 * @return 0 on success, -1 on failure.
+	 */
+	virtual int start() = 0;
+
+	/**
+	 * @brief Stops the producer and wakes threads waiting in fill().
+	 * @return 0 on success.
+	 */
+	virtual int stop() = 0;
+
+	/**
+	 * @brief Sample rate of the raw input and of the wideband output (Hz).
+	 *
+	 * The resampler input rate (see set_input_rate()) unless overridden.
+	 */
+	virtual double native_rate() const { return m_input_rate; }
+
+	/**
+	 * @brief Tells whether a band around freq can be received.
+	 *
+	 * True for tunable hardware; a recording only covers its span.
+	 *
+	 * @param freq    Band center (Hz).
+	 * @param half_bw Half bandwidth (Hz).
+	 */
+	virtual bool covers(double, double) const { return true; }
+
+	/*
+	 * Stream pipeline
+	 */
+
+	/**
+	 * @brief Returns the output sample rate after resampling.
+	 * @return Sample rate in Hz (270833.333... x oversampling()).
+	 */
+	inline double sample_rate() const { return m_sample_rate; }
+
+	/** @brief Current center frequency in Hz (last tune()). */
+	inline double center_freq() const { return m_center_freq; }
+
+	/** @brief Current gain setting. */
+	inline float gain() const { return m_gain; }
+
+	/**
+	 * @brief Returns the output ring (consumer side).
+	 *
+	 * Used to access processed samples via peek()/read()/purge().
+	 */
+	inline spsc_buffer* get_buffer() { return cb; }
+
+	/**
+	 * @brief Selects the resampler engine (two-stage or fused).
+	 *
+	 * Must be called before start(); the resampler state is reset.
+	 *
+	 * @param id Engine identifier.
+	 * @return The engine actually selected.
+	 */
+	dsp_engine_id set_resampler_engine(dsp_engine_id id);
+
+	/**
+	 * @brief Selects the output samples per GSM symbol (1, 2 or 4).
+	 *
+	 * Oversampled output gives the detector more samples per burst, so
+	 * each offset measurement is more precise. Call before open() so the
+	 * output ring is sized for it; changing it while streaming starts a
+	 * new stream segment like set_wideband() (the producer switches the
+	 * resampler at the segment start). Sources whose input is already
+	 * at the output rate keep theirs (see set_passthrough()).
+	 *
+	 * @param sps Samples per symbol.
+	 * @return The oversampling actually selected.
+	 */
+	unsigned int set_oversampling(unsigned int sps);
+
+	/** @brief Returns the output samples per GSM symbol. */
+	inline unsigned int oversampling() const { return m_sps.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Adaptive oversampling: falls back to 1 sps under CPU pressure.
+	 *
+	 * Above 1 sps, drops since the last call or a resampler load over
+	 * SAMPLE_SOURCE_LOAD_MAX (see load()) switch the output to 1 sps
+	 * with set_oversampling(), so callers must rebuild whatever depends
+	 * on sample_rate() and wait for the new segment. Call between
+	 * captures.
+	 *
+	 * @return true if the oversampling was lowered.
+	 */
+	bool check_load();
+
+	/**
+	 * @brief Resampler time as a share of real time (moving average).
+	 *
+	 * Time spent in the resampler per input block over the time the
+	 * block covers at native_rate(); 1.0 is a full core.
+	 */
+	inline float load() const { return m_load.load(std::memory_order_relaxed); }
+
+	/** @brief Returns the resampler, e.g. to query macs_per_output(). */
+	inline const dsp_resampler* get_resampler() const { return m_resampler; }
+
+	/**
+	 * @brief Bypasses the resampler and streams at native_rate().
+	 *
+	 * In wideband mode the output ring receives the raw I/Q (int16 is
+	 * converted to float) for power scans that cover several channels
+	 * per tune, see wideband_scan. May be switched while streaming;
+	 * like tune() this starts a new stream segment, so samples of the
+	 * previous rate are dropped by the next wait_settled() or
+	 * tune_capture().
+	 *
+	 * @param enable true for native rate output.
+	 */
+	void set_wideband(bool enable);
+
+	/** @brief Returns true if the resampler is bypassed (set_wideband()). */
+	inline bool wideband() const { return m_wideband.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Sample drops since start(), split by where they happened.
+	 */
+	struct drop_stats {
+		unsigned int usb;   /**< Reported by the device (input samples) */
+		unsigned int dsp;   /**< Producer behind its input (input samples) */
+		unsigned int ring;  /**< Output ring full (output samples) */
+	};
+
+	/** @brief Returns the drop counters accumulated since start(). */
+	drop_stats get_drop_stats() const;
+
+	/**
+	 * @brief Blocks until the requested number of samples are available.
+	 *
+	 * Sleeps in spsc_buffer::wait() with a 100ms timeout to periodically
+	 * check the global exit flag (g_kal_exit_req). Starts streaming if
+	 * needed.
+	 *
+	 * @param num_samples Minimum number of samples to wait for.
+	 * @param overruns    Output: number of samples dropped since last call
+	 *                    due to buffer overflow (can be NULL).
+	 * @return 0 on success, -1 if streaming stopped or exit requested.
+	 */
+	int fill(unsigned int num_samples, unsigned int *overruns);
+
+	/**
+	 * @brief Discards all buffered samples and resets overflow counter.
+	 * @return 0 on success.
+	 */
+	int flush();
+
+	/**
+	 * @brief Waits for the current stream segment and drops what precedes it.
+	 *
+	 * A segment starts at tune(), start() and set_wideband(). Its first
+	 * published sample follows the settle interval of the source and
+	 * the resampler warm-up (dsp_resampler::warmup_outputs());
+	 * everything before it is purged from the ring. Starts streaming if
+	 * needed.
+	 *
+	 * @return 0 on success, -1 if streaming stopped or exit requested.
+	 */
+	int wait_settled();
+
+	/**
+	 * @brief Waits for num_samples contiguous samples.
+	 *
+	 * Like fill(), but if samples were dropped on the way the ring is
+	 * flushed and the wait restarts, so the samples at the head of the
+	 * ring never span a gap.
+	 *
+	 * @param overruns Output: samples dropped while waiting (can be NULL).
+	 * @return 0 on success, -1 if streaming stopped or exit requested.
+	 */
+	int capture(unsigned int num_samples, unsigned int *overruns);
+
+	/**
+	 * @brief tune(), wait_settled() and capture() in one call.
+	 *
+	 * On success the ring starts with the first settled sample at freq.
+	 *
+	 * @return 0 on success, -1 on failure.
+	 */
+	int tune_capture(double freq, unsigned int num_samples, unsigned int *overruns);
+
+	/** @brief Center frequency of the samples settled by wait_settled(). */
+	inline double capture_freq() const { return m_capture_freq; }
+
+protected:
+	/*
+	 * For derived classes: control side
+	 */
+
+	/** @brief Allocates the output ring. @return 0 on success, -1 on failure. */
+	int alloc_ring();
+
+	/**
+	 * @brief Selects the resampler configuration for the raw input rate.
+	 *
+	 * Call from open(), before streaming (see
+	 * dsp_resampler::set_input_rate()).
+	 *
+	 * @param rate Raw input rate (Hz).
+	 * @return 0 on success, -1 if no configuration matches the rate.
+	 */
+	int set_input_rate(double rate);
+
+	/**
+	 * @brief Marks the input as already at the output rate (no resampler).
+	 *
+	 * Call from open(). The oversampling follows the rate and cannot be
+	 * changed with set_oversampling().
+	 *
+	 * @param rate Input rate (Hz): GSM_RATE x 1, 2 or 4.
+	 * @return 0 on success, -1 if the rate is not one of those.
+	 */
+	int set_passthrough(double rate);
+
+	/** @brief Records the tuned frequency and starts a new segment. */
+	void retuned(double freq);
+
+	/** @brief Resets the pipeline and drop counters before streaming starts. */
+	void reset_stream();
+
+	/*
+	 * For derived classes: producer side (one thread at a time)
+	 */
+
+	/**
+	 * @brief Resamples raw input and pushes it to the output ring.
+	 * @param input   Interleaved I/Q, per format.
+	 * @param segment Value of m_segment when the input was received.
+	 */
+	void process_samples(const void* input, size_t count,
+			     sample_format format, uint32_t segment);
+
+	/** @brief Pushes output samples to the ring, counting drops. */
+	void push_output(const std::complex<float>* samples, size_t count);
+
+	/** @brief Wait-free SPSC ring for producer/consumer sample handoff. */
+	spsc_buffer* cb;
+
+	/** @brief Set while the producer may write to the ring. */
+	std::atomic<bool> streaming;
+
+	/** @brief Current gain setting. */
+	float m_gain;
+
+	/** @brief Current center frequency in Hz. */
+	double m_center_freq;
+
+	/** @brief Output sample rate after resampling (Hz). */
+	double m_sample_rate;
+
+	/** @brief Resampler input rate (Hz, see set_input_rate()). */
+	double m_input_rate;
+
+	/** @brief Resampler bypass (see set_wideband()). */
+	std::atomic<bool> m_wideband;
+
+	/** @brief Input is already at m_sample_rate: never resample. */
+	bool m_passthrough;
+
+	/*
+	 * Settle interval dropped at the start of a segment, set by the
+	 * derived class: m_settle_samples input samples, after the whole
+	 * first input block if m_settle_first (it may have been sampled
+	 * before the change, as a USB transfer in flight).
+	 */
+
+	size_t m_settle_samples;
+	bool m_settle_first;
+
+	/*
+	 * Stream segments (see wait_settled()). m_segment is bumped by the
+	 * consumer; the producer samples it per input block and publishes
+	 * m_ready_mark, then m_ready_segment, right before writing the
+	 * segment's first sample.
+	 */
+
+	std::atomic<uint32_t> m_segment;
+	std::atomic<uint32_t> m_ready_segment;
+	std::atomic<unsigned int> m_ready_mark;
+
+	/** @brief Atomic overflow counter (samples dropped). */
+	std::atomic<unsigned int> m_overflow_count;
+
+	/** @brief Cumulative drop counters, see drop_stats. */
+	std::atomic<unsigned int> m_drops_usb;
+	std::atomic<unsigned int> m_drops_dsp;
+	std::atomic<unsigned int> m_drops_ring;
+
+private:
+	/** @brief Producer: segment being produced and samples left to drop. */
+	uint32_t m_prod_segment;
+	bool m_prod_ready;
+	size_t m_settle_left;
+	size_t m_warmup_left;
+
+	/** @brief Frequency of the segment last waited for. */
+	double m_capture_freq;
+
+	/** @brief Requested oversampling, applied by the producer per segment. */
+	std::atomic<unsigned int> m_sps;
+
+	/** @brief Producer: resampler load average (see load()). */
+	std::atomic<float> m_load;
+
+	/** @brief Drop count at the last check_load() (consumer). */
+	unsigned int m_load_drops;
+
+	/** @brief DSP resampler instance (native rate → m_sample_rate). */
+	dsp_resampler* m_resampler;
+
+	/**
+	 * @brief Size of intermediate batch buffer for DSP output.
+	 *
+	 * Calculation for maximum USB transfer of 128K samples:
+	 *   Input:  131072 samples (128K, conservative upper bound)
+	 *   Stage1: 131072 / 5 = 26214 samples
+	 *   Stage2: 26214 * 13/24 ≈ 14200 samples
+	 *
+	 * BATCH_SIZE = 32768 provides 2x safety margin.
+	 *
+	 * @note If a producer ever provides larger blocks, this must
+	 *       be increased proportionally to avoid data loss.
+	 */
+	static const int BATCH_SIZE = 32768;
+
+	/** @brief Intermediate buffer for DSP pipeline output. */
+	std::complex<float> m_batch_buffer[BATCH_SIZE];
+};
+
+#endif /* __SAMPLE_SOURCE_H__ */
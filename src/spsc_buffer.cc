@@ -0,0 +1,216 @@
+/**
+ * @file spsc_buffer.cc
+ * @brief Implementation of the wait-free SPSC Magic Ring Buffer.
+ */
+
+/*
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+#include "spsc_buffer.h"
+
+#include <string.h>
+#include <climits>
+#include <stdexcept>
+#include <chrono>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+spsc_buffer::spsc_buffer(unsigned int buf_len, unsigned int item_size) {
+	if (!buf_len) throw std::runtime_error("spsc_buffer: buffer len is 0");
+	if (!item_size) throw std::runtime_error("spsc_buffer: item size is 0");
+
+	/* One slot is reserved, so map buf_len + 1 items */
+	if (buf_len >= UINT_MAX / item_size)
+		throw std::runtime_error("spsc_buffer: buffer size overflow");
+
+	m_mem = new mirrored_memory(item_size * (buf_len + 1));
+
+	/*
+	 * The mirror repeats every m_mem->size() bytes, so an item straddling
+	 * the end of the first copy only reads back correctly if that size is
+	 * a whole number of items.
+	 */
+	if (m_mem->size() % item_size) {
+		delete m_mem;
+		throw std::runtime_error("spsc_buffer: item size does not divide the mapped size");
+	}
+
+	m_item_size = item_size;
+	m_buf = m_mem->base();
+	m_buf_size = m_mem->size();
+
+	m_w.store(0, std::memory_order_relaxed);
+	m_r.store(0, std::memory_order_relaxed);
+	m_seq.store(0, std::memory_order_relaxed);
+	m_waiting.store(0, std::memory_order_relaxed);
+}
+
+spsc_buffer::~spsc_buffer() {
+	delete m_mem;
+}
+
+unsigned int spsc_buffer::capacity() {
+	return m_buf_size / m_item_size - 1;
+}
+
+unsigned int spsc_buffer::buf_len() {
+	return capacity();
+}
+
+unsigned int spsc_buffer::data_available() {
+	unsigned int r = m_r.load(std::memory_order_acquire);
+	unsigned int w = m_w.load(std::memory_order_acquire);
+	return used_bytes(r, w) / m_item_size;
+}
+
+unsigned int spsc_buffer::space_available() {
+	return capacity() - data_available();
+}
+
+// ----------------------------------------------------------------------------
+// Producer
+// ----------------------------------------------------------------------------
+
+unsigned int spsc_buffer::write(const void *s, unsigned int len) {
+	unsigned int w = m_w.load(std::memory_order_relaxed);
+	unsigned int r = m_r.load(std::memory_order_acquire);
+	unsigned int items_free = (m_buf_size - m_item_size - used_bytes(r, w)) / m_item_size;
+	unsigned int to_write = MIN(len, items_free);
+
+	if (to_write > 0) {
+		/* Mirrored mapping: the span past m_buf_size lands at offset 0 */
+		memcpy(m_buf + w, s, to_write * m_item_size);
+		w += to_write * m_item_size;
+		if (w >= m_buf_size)
+			w -= m_buf_size;
+
+		m_w.store(w, std::memory_order_release);
+		wake();
+	}
+
+	return to_write;
+}
+
+void spsc_buffer::notify() {
+	m_waiting.store(1, std::memory_order_seq_cst);
+	wake();
+}
+
+void spsc_buffer::wake() {
+	m_seq.fetch_add(1, std::memory_order_seq_cst);
+
+	/* Fast path: nobody asleep, no syscall and no lock */
+	if (!m_waiting.load(std::memory_order_seq_cst))
+		return;
+
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t *)&m_seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+	std::lock_guard<std::mutex> lock(m_wait_mutex);
+	m_wait_cv.notify_all();
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Consumer
+// ----------------------------------------------------------------------------
+
+unsigned int spsc_buffer::read(void *s, unsigned int len) {
+	unsigned int r = m_r.load(std::memory_order_relaxed);
+	unsigned int w = m_w.load(std::memory_order_acquire);
+	unsigned int to_read = MIN(len, used_bytes(r, w) / m_item_size);
+
+	if (to_read > 0) {
+		memcpy(s, m_buf + r, to_read * m_item_size);
+		r += to_read * m_item_size;
+		if (r >= m_buf_size)
+			r -= m_buf_size;
+		m_r.store(r, std::memory_order_release);
+	}
+
+	return to_read;
+}
+
+void *spsc_buffer::peek(unsigned int *len) {
+	unsigned int r = m_r.load(std::memory_order_relaxed);
+	unsigned int w = m_w.load(std::memory_order_acquire);
+
+	if (len)
+		*len = used_bytes(r, w) / m_item_size;
+
+	return (void *)(m_buf + r);
+}
+
+unsigned int spsc_buffer::purge(unsigned int len) {
+	unsigned int r = m_r.load(std::memory_order_relaxed);
+	unsigned int w = m_w.load(std::memory_order_acquire);
+	unsigned int to_purge = MIN(len, used_bytes(r, w) / m_item_size);
+
+	r += to_purge * m_item_size;
+	if (r >= m_buf_size)
+		r -= m_buf_size;
+	m_r.store(r, std::memory_order_release);
+
+	return to_purge;
+}
+
+unsigned int spsc_buffer::purge_to(unsigned int mark) {
+	unsigned int r = m_r.load(std::memory_order_relaxed);
+	unsigned int w = m_w.load(std::memory_order_acquire);
+	unsigned int to_purge = used_bytes(r, mark);
+
+	if (to_purge > used_bytes(r, w))
+		return 0;
+
+	m_r.store(mark, std::memory_order_release);
+
+	return to_purge / m_item_size;
+}
+
+void spsc_buffer::flush() {
+	m_r.store(m_w.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+bool spsc_buffer::wait(unsigned int len, unsigned int timeout_ms) {
+	if (data_available() >= len)
+		return true;
+
+	/*
+	 * Announce the sleep before sampling the sequence: a producer that
+	 * publishes after this point either bumps m_seq before our load
+	 * (and the re-check below sees its data) or sees m_waiting set and
+	 * wakes us; the futex/cv wait then returns on the changed value.
+	 */
+	m_waiting.store(1, std::memory_order_seq_cst);
+	uint32_t seq = m_seq.load(std::memory_order_seq_cst);
+
+	if (data_available() < len) {
+#ifdef __linux__
+		struct timespec ts;
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+		syscall(SYS_futex, (uint32_t *)&m_seq, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+#else
+		std::unique_lock<std::mutex> lock(m_wait_mutex);
+		m_wait_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+			return m_seq.load(std::memory_order_seq_cst) != seq;
+		});
+#endif
+	}
+
+	m_waiting.store(0, std::memory_order_relaxed);
+
+	return data_available() >= len;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file spsc_buffer.h
+ * @brief Wait-free single-producer/single-consumer Magic Ring Buffer.
+ *
+ * Contiguous view over a double mapping (mirrored_memory), without a
+ * mutex: the producer owns the write index and the consumer owns the
+ * read index, each published with release and observed with acquire
+ * ordering. One item slot stays empty so "full" and "empty" never share
+ * an index value.
+ *
+ * The consumer can sleep in wait() until enough data is published. On
+ * Linux this is a futex on a publish sequence counter and the producer
+ * only enters the kernel when a consumer is actually asleep; elsewhere
+ * a condition variable is used for the sleep and its mutex is taken by
+ * the producer only in that same case.
+ *
+ * Producer side: write(), write_mark(), notify().
+ * Consumer side: read(), peek(), purge(), purge_to(), flush(), wait().
+ */
+
+/*
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+#ifndef __SPSC_BUFFER_H__
+#define __SPSC_BUFFER_H__
+
+#include <atomic>
+#include <stdint.h>
+#include <new>
+#include "mirrored_memory.h"
+#include "util.h"
+
+#ifndef __linux__
+#include <mutex>
+#include <condition_variable>
+#endif
+
+class spsc_buffer {
+public:
+	spsc_buffer(unsigned int buf_len, unsigned int obj_size);
+	~spsc_buffer();
+
+	/** @brief Producer: copies up to len items, returns items written. */
+	unsigned int write(const void *s, unsigned int len);
+
+	/** @brief Consumer: copies up to len items, returns items read. */
+	unsigned int read(void *s, unsigned int len);
+
+	/** @brief Consumer: returns a contiguous view of all readable items. */
+	void *peek(unsigned int *len);
+
+	/** @brief Consumer: discards up to len items, returns items dropped. */
+	unsigned int purge(unsigned int len);
+
+	/** @brief Consumer: discards everything published so far. */
+	void flush();
+
+	/**
+	 * @brief Producer: position the next write() will start at.
+	 *
+	 * Lets the producer tell the consumer where a new segment of the
+	 * stream begins, see purge_to().
+	 */
+	unsigned int write_mark() const { return m_w.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Consumer: discards everything before a write_mark().
+	 *
+	 * Does nothing if the mark was already read past.
+	 *
+	 * @return Items dropped.
+	 */
+	unsigned int purge_to(unsigned int mark);
+
+	unsigned int buf_len();
+	unsigned int data_available();
+	unsigned int space_available();
+	unsigned int capacity();
+
+	/**
+	 * @brief Consumer: sleeps until at least len items are readable.
+	 *
+	 * Also returns early after notify() or when timeout_ms expires, so
+	 * the caller must re-check its own exit conditions.
+	 *
+	 * @return true if len items are readable.
+	 */
+	bool wait(unsigned int len, unsigned int timeout_ms);
+
+	/** @brief Wakes a consumer sleeping in wait() (e.g. on stop). */
+	void notify();
+
+	/** @brief Aligned allocation for the cache-line separated indices. */
+	static void* operator new(size_t size) {
+		void* ptr = aligned_malloc(size, DEFAULT_ALIGNMENT);
+		if (!ptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+
+	/** @brief Aligned deallocation. */
+	static void operator delete(void* ptr) noexcept {
+		aligned_free(ptr);
+	}
+
+private:
+	mirrored_memory *m_mem;
+	char *m_buf;
+	unsigned int m_buf_size;
+	unsigned int m_item_size;
+
+	/*
+	 * Byte offsets in [0, m_buf_size). Kept on separate cache lines so
+	 * the two threads do not false-share.
+	 */
+	alignas(64) std::atomic<unsigned int> m_w;
+	alignas(64) std::atomic<unsigned int> m_r;
+
+	/** @brief Bumped on every publish; futex word on Linux. */
+	alignas(64) std::atomic<uint32_t> m_seq;
+
+	/** @brief Set while the consumer is (about to be) asleep. */
+	std::atomic<int> m_waiting;
+
+#ifndef __linux__
+	std::mutex m_wait_mutex;
+	std::condition_variable m_wait_cv;
+#endif
+
+	unsigned int used_bytes(unsigned int r, unsigned int w) const {
+		return (w >= r) ? w - r : w + m_buf_size - r;
+	}
+
+	void wake();
+};
+
+#endif // __SPSC_BUFFER_H__
@@ -0,0 +1,98 @@
+/**
+ * @file thread_util.cc
+ * @brief Implementation of the thread affinity and priority helpers.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#ifdef _WIN32
+#include "win_compat.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "thread_util.h"
+
+int thread_pin_current(int cpu)
+{
+	if (cpu < 0)
+		return 0;
+
+#if defined(_WIN32)
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8) ||
+	    !SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu)) {
+		fprintf(stderr, "Warning: failed to pin thread to CPU %d\n", cpu);
+		return -1;
+	}
+	return 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	int r;
+
+	if (cpu >= CPU_SETSIZE) {
+		fprintf(stderr, "Warning: CPU %d out of range\n", cpu);
+		return -1;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (r != 0) {
+		fprintf(stderr, "Warning: failed to pin thread to CPU %d: %s\n", cpu, strerror(r));
+		return -1;
+	}
+	return 0;
+#else
+	fprintf(stderr, "Warning: CPU pinning is not supported on this platform\n");
+	return -1;
+#endif
+}
+
+int thread_set_priority_current(int priority)
+{
+	if (priority <= 0)
+		return 0;
+
+#if defined(_WIN32)
+	int level = (priority >= 50) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+
+	if (!SetThreadPriority(GetCurrentThread(), level)) {
+		fprintf(stderr, "Warning: failed to set thread priority %d\n", priority);
+		return -1;
+	}
+	return 0;
+#else
+	struct sched_param param;
+	int lo = sched_get_priority_min(SCHED_FIFO);
+	int hi = sched_get_priority_max(SCHED_FIFO);
+	int r;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = (priority < lo) ? lo : (priority > hi) ? hi : priority;
+
+	r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (r != 0) {
+		fprintf(stderr, "Warning: failed to set SCHED_FIFO priority %d: %s\n",
+			param.sched_priority, strerror(r));
+		return -1;
+	}
+	return 0;
+#endif
+}
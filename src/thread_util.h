@@ -0,0 +1,40 @@
+/**
+ * @file thread_util.h
+ * @brief Portable CPU affinity and scheduling priority helpers.
+ *
+ * Both functions act on the calling thread, so they are meant to be
+ * called first thing inside a worker thread body.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __THREAD_UTIL_H__
+#define __THREAD_UTIL_H__
+
+/**
+ * @brief Pins the calling thread to one CPU core.
+ * @param cpu Zero-based core index (negative = leave affinity unchanged).
+ * @return 0 on success, -1 on failure (error printed to stderr).
+ */
+int thread_pin_current(int cpu);
+
+/**
+ * @brief Raises the scheduling priority of the calling thread.
+ *
+ * POSIX: SCHED_FIFO with the given priority (clamped to the valid range,
+ * usually needs CAP_SYS_NICE or root). Windows: 1-49 maps to
+ * THREAD_PRIORITY_HIGHEST, 50 and above to THREAD_PRIORITY_TIME_CRITICAL.
+ *
+ * @param priority Priority level (0 = leave unchanged).
+ * @return 0 on success, -1 on failure (error printed to stderr).
+ */
+int thread_set_priority_current(int priority);
+
+#endif /* __THREAD_UTIL_H__ */
@@ -21,6 +21,7 @@
 
 // Need FFTW for the visualization
 #include <fftw3.h>
+#include "fft_plan_cache.h"
 
 #ifdef _WIN32
 #include "win_compat.h"
@@ -47,7 +48,7 @@ void draw_ascii_fft(const std::complex<float> *data, int len, int width, float s
 
 	// Re-allocate only if length changes
 	if (len != last_len) {
-		if (p) { fftw_destroy_plan(p); p = nullptr; }
+		if (p) { fft_plan_release(p); p = nullptr; }
 		if (in) { fftw_free(in); in = nullptr; }
 		if (out) { fftw_free(out); out = nullptr; }
 
@@ -56,7 +57,7 @@ void draw_ascii_fft(const std::complex<float> *data, int len, int width, float s
 		out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * len);
 		
 		if (in && out) {
-			p = fftw_plan_dft_1d(len, in, out, FFTW_FORWARD, FFTW_ESTIMATE);
+			p = fft_plan_acquire(len, in, out);
 			if (p) {
 				last_len = len;
 				// CALIBRATION:
@@ -85,7 +86,7 @@ void draw_ascii_fft(const std::complex<float> *data, int len, int width, float s
 		in[i][1] = data[i].imag() * window;
 	}
 
-	fftw_execute(p);
+	fftw_execute_dft(p, in, out);
 
 	// 3. Compute Power Spectrum (dBFS) and Find Peak
 	std::vector<float> mag_db(len);
@@ -0,0 +1,191 @@
+/**
+ * @file warm_start.cc
+ * @brief Implementation of the warm start from the state file.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "sample_source.h"
+#include "arfcn_freq.h"
+#include "wideband_scan.h"
+#include "kal_state.h"
+#include "kal_globals.h"
+#include "warm_start.h"
+
+/*
+ * Strongest carrier of c0 the source can receive; expected offset from
+ * the last ppm when there is one, else from the scan. Returns false if
+ * there is none.
+ */
+static bool pick_strongest(sample_source *u, int bi, const std::vector<kal_c0> &c0,
+			   const kal_result *last, double *best, warm_start_result *out,
+			   float *expected)
+{
+	bool found = false;
+
+	for (size_t i = 0; i < c0.size(); i++) {
+		int cb = bi;
+		const double freq = arfcn_to_freq(c0[i].chan, &cb);
+
+		if (freq <= 0.0 || c0[i].dbfs <= *best || !u->covers(freq, WB_CHAN_HALF_BW))
+			continue;
+		*best = c0[i].dbfs;
+		out->bi = bi;
+		out->chan = c0[i].chan;
+		*expected = last ? (float)(last->ppm * freq / 1e6) : c0[i].offset;
+		found = true;
+	}
+	return found;
+}
+
+/*
+ * Carrier measured first: the channel of the last result of the device
+ * (last, may be NULL), else the strongest carrier the last scan found in
+ * band bi (any band for BI_NOT_DEFINED). Returns -1 if nothing is known.
+ */
+static int pick_known(sample_source *u, int bi, const kal_result *last, warm_start_result *out,
+		      float *expected)
+{
+	std::vector<kal_c0> c0;
+	double best = -1e9;
+	bool found = false;
+
+	if (last && (bi == BI_NOT_DEFINED || last->bi == bi)) {
+		int cb = last->bi;
+		const double freq = arfcn_to_freq(last->chan, &cb);
+
+		if (freq > 0.0 && u->covers(freq, WB_CHAN_HALF_BW)) {
+			out->bi = last->bi;
+			out->chan = last->chan;
+			*expected = (float)last->offset;
+			return 0;
+		}
+	}
+
+	for (int b = GSM_850; b <= PCS_1900; b++) {
+		if (bi != BI_NOT_DEFINED && b != bi)
+			continue;
+		kal_state_load_c0(b, &c0);
+		found |= pick_strongest(u, b, c0, last, &best, out, expected);
+	}
+	return found ? 0 : -1;
+}
+
+/*
+ * Measures on one carrier.
+ * Returns 0 with bursts, 1 if the carrier gave none, -1 on error.
+ */
+static int measure(sample_source *u, warm_start_result *out, float expected,
+		   unsigned int probe_windows, bool quiet)
+{
+	int bi = out->bi;
+	const double freq = arfcn_to_freq(out->chan, &bi);
+	offset_seed seed;
+
+	seed.offset = expected;
+	seed.tolerance = (float)(WARM_START_SEED_PPM * freq / 1e6);
+	seed.probe_windows = probe_windows;
+
+	if (u->tune(freq) == -1) {
+		out->error = "tune failed";
+		return -1;
+	}
+	if (!quiet)
+		fprintf(stderr, "Using %s channel %d (%.1fMHz), expecting %.0f Hz\n", bi_to_str(bi),
+			out->chan, freq / 1e6, expected);
+	if (offset_measure(u, 0, 0.0f, quiet, &out->res, &seed)) {
+		out->error = g_kal_exit_req ? NULL : "measurement failed";
+		return -1;
+	}
+	return out->res.bursts ? 0 : 1;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------------
+ */
+
+void warm_start_save(uint64_t serial, int bi, int chan, const offset_result &res)
+{
+	kal_result r;
+
+	if (bi == BI_NOT_DEFINED || chan < 0 || res.bursts == 0)
+		return;
+
+	r.serial = serial;
+	r.bi = bi;
+	r.chan = chan;
+	r.ppm = res.ppm;
+	r.offset = res.offset;
+	r.time = (long long)time(NULL);
+	if (kal_state_save_result(r) && g_verbosity > 0)
+		fprintf(stderr, "warning: cannot save the result to '%s'\n", kal_state_path());
+}
+
+int warm_start_run(sample_source *u, uint64_t serial, int bi, unsigned int workers,
+		   c0_scan_mode mode, bool quiet, warm_start_result *out)
+{
+	std::vector<kal_c0> found;
+	kal_result last;
+	float expected = 0.0f;
+	double best = -1e9;
+	int r;
+
+	memset(out, 0, sizeof(*out));
+	out->bi = bi;
+	out->chan = -1;
+
+	const bool have_last = !kal_state_load_result(serial, &last);
+
+	if (!pick_known(u, bi, have_last ? &last : NULL, out, &expected)) {
+		r = measure(u, out, expected, WARM_START_PROBE_WINDOWS, quiet);
+		if (r <= 0 || g_kal_exit_req)
+			goto done;
+		if (!quiet)
+			fprintf(stderr, "\nNo FCCH on %s channel %d any more, scanning the band.\n",
+				bi_to_str(out->bi), out->chan);
+		if (bi == BI_NOT_DEFINED)
+			bi = out->bi;
+	} else if (bi == BI_NOT_DEFINED) {
+		out->error = "nothing known about this device in the state file, give a band";
+		return -1;
+	}
+
+	if (!quiet)
+		fprintf(stderr, "Scanning for %s base stations.\n", bi_to_str(bi));
+	out->scanned = true;
+	out->chan = -1;
+	if (c0_detect(&u, 1, bi, workers, mode, &found)) {
+		out->error = "band scan failed";
+		return -1;
+	}
+	if (g_kal_exit_req)
+		return -1;
+
+	memset(&out->res, 0, sizeof(out->res));
+	if (!pick_strongest(u, bi, found, NULL, &best, out, &expected)) {
+		out->error = "no base station found";
+		return -1;
+	}
+	r = measure(u, out, expected, 0, quiet);
+
+done:
+	if (r < 0)
+		return -1;
+	if (!g_kal_exit_req)
+		warm_start_save(serial, out->bi, out->chan, out->res);
+	return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file warm_start.h
+ * @brief Offset measurement started from the state file (-a).
+ *
+ * A calibration run that already knows its neighbourhood does not need
+ * a band scan: the channel of the device's last result, or else the
+ * strongest carrier the last scan of the band found, is measured
+ * straight away. The expected offset (from the last ppm, or the scan)
+ * seeds the measurement, see offset_seed. The band is scanned only when
+ * that carrier gives no burst, or when nothing is known yet; then the
+ * strongest carrier found is measured.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __WARM_START_H__
+#define __WARM_START_H__
+
+#include <stdint.h>
+
+#include "c0_detect.h"
+#include "offset.h"
+
+/** @brief Largest clock drift accepted since the last result (ppm). */
+#define WARM_START_SEED_PPM 2.0
+
+/** @brief Search windows without a burst before a cached carrier is given up. */
+#define WARM_START_PROBE_WINDOWS 40
+
+/** @brief Outcome of warm_start_run(). */
+struct warm_start_result {
+	int bi;               /**< Band of the measured channel */
+	int chan;             /**< Measured channel, -1 if none */
+	bool scanned;         /**< The band had to be scanned */
+	offset_result res;    /**< Measurement (res.bursts may be 0) */
+	const char *error;    /**< Why it failed, NULL on success */
+};
+
+/**
+ * @brief Records the result of a single device measurement in the
+ *        state file, for the next warm start.
+ *
+ * Nothing is saved without bursts or outside a GSM channel.
+ *
+ * @param serial Device serial, 0 for a replayed recording.
+ */
+void warm_start_save(uint64_t serial, int bi, int chan, const offset_result &res);
+
+/**
+ * @brief Measures from the state file, scanning the band only if needed.
+ *
+ * Saves the result with warm_start_save() when bursts were found.
+ *
+ * @param u       Opened source.
+ * @param serial  Device serial, 0 for a replayed recording.
+ * @param bi      Band, or BI_NOT_DEFINED for any band in the state file.
+ * @param workers Band scan FCCH threads.
+ * @param mode    Band scan method.
+ * @param quiet   No progress output (the scan still prints its results).
+ * @param out     Output: the measurement.
+ * @return 0 if a channel was measured (out->res.bursts may still be 0),
+ *         -1 on error (out->error says why, NULL on exit request).
+ */
+int warm_start_run(sample_source *u, uint64_t serial, int bi, unsigned int workers,
+		   c0_scan_mode mode, bool quiet, warm_start_result *out);
+
+#endif /* __WARM_START_H__ */
@@ -0,0 +1,112 @@
+/**
+ * @file wideband_scan.cc
+ * @brief Implementation of the wideband per-channel power estimator.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "wideband_scan.h"
+#include "fft_plan_cache.h"
+
+#define WB_HOP (WB_FFT_SIZE / 2)
+
+wideband_scan::wideband_scan(double sample_rate)
+{
+	double w2 = 0.0;
+
+	m_sample_rate = sample_rate;
+	m_window.resize(WB_FFT_SIZE);
+	m_psd.assign(WB_FFT_SIZE, 0.0);
+
+	/* 4-term Blackman-Harris: -92 dB sidelobes keep strong neighbours out */
+	for (unsigned int i = 0; i < WB_FFT_SIZE; i++) {
+		double x = 2.0 * M_PI * i / WB_FFT_SIZE;
+		double w = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+		m_window[i] = (float)w;
+		w2 += w * w;
+	}
+	m_norm = 1.0 / ((double)WB_FFT_SIZE * w2);
+
+	m_fft = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * WB_FFT_SIZE);
+	if (!m_fft)
+		throw std::runtime_error("wideband_scan: fftwf_malloc failed!");
+
+	m_plan = fft_plan_acquire(WB_FFT_SIZE, m_fft, m_fft);
+	if (!m_plan) {
+		fftwf_free(m_fft);
+		throw std::runtime_error("wideband_scan: fftw plan failed!");
+	}
+}
+
+wideband_scan::~wideband_scan()
+{
+	if (m_plan)
+		fft_plan_release(m_plan);
+	if (m_fft)
+		fftwf_free(m_fft);
+}
+
+unsigned int wideband_scan::capture_len(unsigned int min_len)
+{
+	unsigned int segments = 1;
+
+	if (min_len > WB_FFT_SIZE)
+		segments += (min_len - WB_FFT_SIZE + WB_HOP - 1) / WB_HOP;
+	return WB_FFT_SIZE + (segments - 1) * WB_HOP;
+}
+
+unsigned int wideband_scan::process(const complex *s, unsigned int s_len)
+{
+	unsigned int segments = 0;
+
+	std::fill(m_psd.begin(), m_psd.end(), 0.0);
+
+	for (unsigned int pos = 0; pos + WB_FFT_SIZE <= s_len; pos += WB_HOP) {
+		const complex *x = s + pos;
+
+		for (unsigned int i = 0; i < WB_FFT_SIZE; i++) {
+			m_fft[i][0] = x[i].real() * m_window[i];
+			m_fft[i][1] = x[i].imag() * m_window[i];
+		}
+		fftwf_execute_dft(m_plan, m_fft, m_fft);
+
+		for (unsigned int i = 0; i < WB_FFT_SIZE; i++)
+			m_psd[i] += (double)m_fft[i][0] * m_fft[i][0] + (double)m_fft[i][1] * m_fft[i][1];
+		segments++;
+	}
+
+	if (segments) {
+		const double scale = m_norm / segments;
+		for (unsigned int i = 0; i < WB_FFT_SIZE; i++)
+			m_psd[i] *= scale;
+	}
+	return segments;
+}
+
+double wideband_scan::band_power(double offset, double half_bw) const
+{
+	const double bin_hz = m_sample_rate / WB_FFT_SIZE;
+	int lo = (int)ceil((offset - half_bw) / bin_hz);
+	int hi = (int)floor((offset + half_bw) / bin_hz);
+	double p = 0.0;
+
+	/* Negative frequencies sit in the upper half (FFT bin order) */
+	for (int k = lo; k <= hi; k++) {
+		if (k <= -WB_FFT_SIZE / 2 || k >= WB_FFT_SIZE / 2)
+			continue;
+		p += m_psd[k < 0 ? k + WB_FFT_SIZE : k];
+	}
+	return p;
+}
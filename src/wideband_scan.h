@@ -0,0 +1,82 @@
+/**
+ * @file wideband_scan.h
+ * @brief Per-channel power from one wideband (native rate) capture.
+ *
+ * The narrowband power scan retunes and resamples once per ARFCN. Here a
+ * single capture at the native 2.5 MSPS rate covers about 2 MHz (ten
+ * 200 kHz channels): it is cut into 50% overlapped Blackman-Harris
+ * windowed segments, each segment is transformed with a shared in-place
+ * fftwf plan (fft_plan_cache) and the bin powers are averaged (Welch).
+ * band_power() then sums the bins covering one channel.
+ *
+ * @author Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * @copyright 2025 Benjamin Vernoux
+ * @license BSD-2-Clause
+ */
+
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef __WIDEBAND_SCAN_H__
+#define __WIDEBAND_SCAN_H__
+
+#include <fftw3.h>
+#include <vector>
+#include "kal_types.h"
+
+/** @brief Segment FFT size (610 Hz bins at 2.5 MSPS). */
+#define WB_FFT_SIZE 4096
+
+/** @brief Largest channel offset from the tuned frequency (Hz). */
+#define WB_SPAN_HZ 900e3
+
+/** @brief Half bandwidth summed per channel (Hz). */
+#define WB_CHAN_HALF_BW 90e3
+
+class wideband_scan {
+public:
+	/**
+	 * @param sample_rate Capture sample rate (Hz).
+	 * @throws std::runtime_error if the FFT buffer or plan cannot be created.
+	 */
+	wideband_scan(double sample_rate);
+	~wideband_scan();
+
+	/**
+	 * @brief Estimates the power spectrum of a capture.
+	 *
+	 * Replaces the previous estimate.
+	 *
+	 * @param s     Samples at sample_rate.
+	 * @param s_len Number of samples (at least WB_FFT_SIZE).
+	 * @return Number of averaged segments, 0 if s_len is too short.
+	 */
+	unsigned int process(const complex *s, unsigned int s_len);
+
+	/**
+	 * @brief Mean power per sample inside one band of the last capture.
+	 *
+	 * Window-compensated so that a signal entirely inside the band
+	 * reports the same value as vectornorm2() / len on the signal alone.
+	 *
+	 * @param offset  Band centre relative to the tuned frequency (Hz).
+	 * @param half_bw Half bandwidth (Hz).
+	 */
+	double band_power(double offset, double half_bw) const;
+
+	/** @brief Capture length giving segments covering s_len samples. */
+	static unsigned int capture_len(unsigned int min_len);
+
+private:
+	double m_sample_rate;
+	std::vector<float> m_window;
+	std::vector<double> m_psd;      // Averaged |X|^2, FFT bin order
+	double m_norm;                  // 1 / (N * sum(w^2) * segments)
+
+	fftwf_complex *m_fft;
+	fftwf_plan m_plan;
+};
+
+#endif /* __WIDEBAND_SCAN_H__ */
@@ -26,7 +26,7 @@
 #ifndef isatty
 #define isatty _isatty
 #endif
-/* Note: do NOT #define write _write -- it breaks circular_buffer::write().
+/* Note: do NOT #define write _write -- it breaks spsc_buffer::write().
  * Use _write() directly in the few places that need POSIX write(). */
 #ifndef fileno
 #define fileno _fileno